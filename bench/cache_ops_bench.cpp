@@ -0,0 +1,113 @@
+// bench/cache_ops_bench.cpp
+// Cost of each LRUCache operation type on a full cache with random keys:
+// get (hit), get (miss), put (update), put (insert, evicting) and remove.
+// Reports ns/op and, with --perf, cycles, instructions, L1d/LLC/dTLB misses
+// and branch misses per op, so a change to the Node layout or the hash
+// index can be judged by cache misses per op rather than wall time alone.
+//
+// Usage: cache_ops_bench [--perf] [entries] [ops]
+#include "lru_cache.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+struct OpResult {
+    const char* op;
+    std::size_t ops = 0;
+    double ns_per_op = 0;
+    PerfSample counters;
+};
+
+// Runs fn on every key, timed and counted as one interval
+template <typename Fn>
+static OpResult measure(const char* op, PerfCounters& counters, const std::vector<std::string>& keys, Fn&& fn) {
+    counters.start();
+    auto begin = std::chrono::steady_clock::now();
+    for (const auto& key : keys) {
+        fn(key);
+    }
+    auto end = std::chrono::steady_clock::now();
+    OpResult result;
+    result.counters = counters.stop();
+    result.op = op;
+    result.ops = keys.size();
+    result.ns_per_op = std::chrono::duration<double, std::nano>(end - begin).count() / keys.size();
+    return result;
+}
+
+static std::vector<std::string> randomKeys(const char* prefix, std::size_t range, std::size_t count,
+                                           std::mt19937_64& rng) {
+    std::uniform_int_distribution<std::size_t> pick(0, range - 1);
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        keys.push_back(prefix + std::to_string(pick(rng)));
+    }
+    return keys;
+}
+
+int main(int argc, char** argv) {
+    std::vector<PerfEvent> events = takePerfFlag(argc, argv) ? PerfCounters::all() : std::vector<PerfEvent>{};
+    std::size_t entries = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::size_t ops = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    ops = std::min(ops, entries); // Inserts and removes use distinct keys, at most one cache's worth
+
+    std::cout << "Entries: " << entries << ", ops per type: " << ops << std::endl;
+    LRUCache cache(entries, /*ttl=*/0);
+    const std::string value(64, 'v');
+    const std::string updated(64, 'u');
+    for (std::size_t i = 0; i < entries; ++i) {
+        cache.put("key:" + std::to_string(i), value);
+    }
+
+    // Keys are built before timing so only the cache call is measured
+    std::mt19937_64 rng(42);
+    std::vector<std::string> hits = randomKeys("key:", entries, ops, rng);
+    std::vector<std::string> misses = randomKeys("absent:", entries, ops, rng);
+    std::vector<std::string> updates = randomKeys("key:", entries, ops, rng);
+    std::vector<std::string> inserts;
+    inserts.reserve(ops);
+    for (std::size_t i = 0; i < ops; ++i) {
+        inserts.push_back("new:" + std::to_string(i));
+    }
+    std::vector<std::string> removes = inserts; // Still cached: the inserts evicted older keys
+    std::shuffle(removes.begin(), removes.end(), rng);
+
+    PerfCounters counters(events);
+    std::size_t found = 0;
+    std::vector<OpResult> results;
+    results.push_back(measure("get (hit)", counters, hits, [&](const std::string& key) {
+        if (cache.get(key)) found++;
+    }));
+    results.push_back(measure("get (miss)", counters, misses, [&](const std::string& key) {
+        if (cache.get(key)) found++;
+    }));
+    results.push_back(measure("put (update)", counters, updates, [&](const std::string& key) {
+        cache.put(key, updated);
+    }));
+    results.push_back(measure("put (insert, evicting)", counters, inserts, [&](const std::string& key) {
+        cache.put(key, value);
+    }));
+    results.push_back(measure("remove", counters, removes, [&](const std::string& key) {
+        cache.remove(key);
+    }));
+    if (found != ops) {
+        std::cerr << "Warning: " << found << " gets found a value; expected " << ops << "." << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(26) << "op" << std::setw(12) << "ns/op";
+    for (PerfEvent event : events) std::cout << std::setw(18) << perfColumnHeader(event);
+    std::cout << std::endl;
+    for (const OpResult& result : results) {
+        std::cout << std::setw(26) << result.op << std::setw(12) << result.ns_per_op;
+        for (PerfEvent event : events) std::cout << std::setw(18) << perfPerOp(result.counters, event, result.ops);
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// bench/key_memory_bench.cpp
+// Measures heap bytes per entry for hierarchical keys such as
+// "tenant:12:user:3456:profile", with and without key prefix interning.
+// Also compares the index alone: the 64-bit hash index the cache uses
+// against a string-keyed one, which holds a second copy of every key.
+// Heap usage is read from glibc's allocator statistics (mallinfo2).
+//
+// Usage: key_memory_bench [entries]
+#include "lru_cache.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <malloc.h>
+
+static std::size_t heapInUse() {
+    return mallinfo2().uordblks;
+}
+
+// Four fields per user, 1000 users per tenant
+static std::string makeKey(std::size_t i) {
+    static const char* const kFields[] = {"profile", "settings", "cart", "session"};
+    std::size_t user = i / 4;
+    return "tenant:" + std::to_string(user / 1000) + ":user:" + std::to_string(user) + ":" + kFields[i % 4];
+}
+
+static double cacheBytesPerEntry(bool interning, const std::vector<std::string>& keys) {
+    std::size_t before = heapInUse();
+    double per_entry = 0;
+    {
+        LRUCache cache(keys.size(), /*ttl=*/0);
+        if (interning) cache.enableKeyInterning(':');
+        for (const auto& key : keys) {
+            cache.put(key, "v");
+        }
+        per_entry = static_cast<double>(heapInUse() - before) / keys.size();
+        if (interning) {
+            std::cout << "Interned prefixes: " << cache.keyPrefixCount() << ", prefix bytes saved: "
+                      << cache.keyPrefixSavedBytes() << std::endl;
+        }
+    }
+    return per_entry;
+}
+
+static double stringIndexBytesPerEntry(const std::vector<std::string>& keys) {
+    std::size_t before = heapInUse();
+    std::unordered_map<std::string, void*> index;
+    for (const auto& key : keys) {
+        index.emplace(key, nullptr);
+    }
+    return static_cast<double>(heapInUse() - before) / keys.size();
+}
+
+static double hashIndexBytesPerEntry(const std::vector<std::string>& keys) {
+    std::size_t before = heapInUse();
+    std::unordered_multimap<std::uint64_t, void*> index;
+    for (const auto& key : keys) {
+        index.emplace(std::hash<std::string>{}(key), nullptr);
+    }
+    return static_cast<double>(heapInUse() - before) / keys.size();
+}
+
+int main(int argc, char** argv) {
+    std::size_t entries = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::vector<std::string> keys;
+    keys.reserve(entries);
+    for (std::size_t i = 0; i < entries; ++i) {
+        keys.push_back(makeKey(i));
+    }
+    std::cout << "Entries: " << entries << ", e.g. " << keys[entries / 2] << std::endl;
+
+    double plain = cacheBytesPerEntry(false, keys);
+    double interned = cacheBytesPerEntry(true, keys);
+    double string_index = stringIndexBytesPerEntry(keys);
+    double hash_index = hashIndexBytesPerEntry(keys);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(34) << "layout" << "heap bytes/entry" << std::endl;
+    std::cout << std::setw(34) << "cache, whole keys" << plain << std::endl;
+    std::cout << std::setw(34) << "cache, interned prefixes" << interned << std::endl;
+    std::cout << std::setw(34) << "index only: 64-bit hash" << hash_index << std::endl;
+    std::cout << std::setw(34) << "index only: string keys" << string_index << std::endl;
+    return 0;
+}
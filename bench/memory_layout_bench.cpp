@@ -0,0 +1,85 @@
+// bench/memory_layout_bench.cpp
+// Compares get() cost with the default heap layout against the node pool and
+// value arena backed by 2 MB huge pages. Reports ns/op and dTLB load misses
+// per op (via perf_event_open) so layout changes can be judged by TLB
+// behaviour, not wall time alone. --perf adds cycles, instructions, L1d,
+// LLC and branch misses per op.
+//
+// Usage: memory_layout_bench [--perf] [entries] [lookups]
+#include "lru_cache.h"
+#include "perf_counters.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+
+struct RunResult {
+    double ns_per_op = 0;
+    PerfSample counters;
+};
+
+static RunResult runLayout(PerfCounters& counters, bool huge_pages, std::size_t entries, std::size_t lookups) {
+    LRUCache cache(entries, /*ttl=*/0);
+    if (huge_pages) {
+        cache.enableNodePool(/*huge_pages=*/true);
+        cache.enableArena(kHugePageBytes, /*huge_pages=*/true);
+    }
+    const std::string value(64, 'v');
+    for (std::size_t i = 0; i < entries; ++i) {
+        cache.put("key:" + std::to_string(i), value);
+    }
+
+    // Uniform random lookups defeat the CPU caches, so TLB reach dominates
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::size_t> pick(0, entries - 1);
+    std::vector<std::string> keys;
+    keys.reserve(lookups);
+    for (std::size_t i = 0; i < lookups; ++i) {
+        keys.push_back("key:" + std::to_string(pick(rng)));
+    }
+
+    std::size_t hits = 0;
+    counters.start();
+    auto begin = std::chrono::steady_clock::now();
+    for (const auto& key : keys) {
+        if (cache.get(key)) hits++;
+    }
+    auto end = std::chrono::steady_clock::now();
+    PerfSample sample = counters.stop();
+
+    if (hits != lookups) {
+        std::cerr << "Warning: only " << hits << " of " << lookups << " lookups hit." << std::endl;
+    }
+    RunResult result;
+    result.ns_per_op = std::chrono::duration<double, std::nano>(end - begin).count() / lookups;
+    result.counters = sample;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::vector<PerfEvent> events = takePerfFlag(argc, argv) ? PerfCounters::all()
+                                                              : std::vector<PerfEvent>{PerfEvent::DtlbMisses};
+    std::size_t entries = argc > 1 ? std::stoul(argv[1]) : 2000000;
+    std::size_t lookups = argc > 2 ? std::stoul(argv[2]) : 2000000;
+
+    std::cout << "Entries: " << entries << ", lookups: " << lookups << std::endl;
+    PerfCounters counters(events);
+    RunResult heap = runLayout(counters, false, entries, lookups);
+    RunResult huge = runLayout(counters, true, entries, lookups);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(26) << "layout" << std::setw(12) << "ns/op";
+    for (PerfEvent event : events) std::cout << std::setw(18) << perfColumnHeader(event);
+    std::cout << std::endl;
+    auto printRow = [&](const char* layout, const RunResult& result) {
+        std::cout << std::setw(26) << layout << std::setw(12) << result.ns_per_op;
+        for (PerfEvent event : events) std::cout << std::setw(18) << perfPerOp(result.counters, event, lookups);
+        std::cout << std::endl;
+    };
+    printRow("heap (default)", heap);
+    printRow("node pool + arena (2MB)", huge);
+    return 0;
+}
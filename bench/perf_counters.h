@@ -0,0 +1,158 @@
+// bench/perf_counters.h
+// Hardware performance counters for the benchmarks (perf_event_open).
+// Each event is opened on its own for the calling thread, counting user
+// space only, so it works at the default kernel.perf_event_paranoid=2. When
+// the PMU has fewer counters than events, the kernel multiplexes them and
+// readings are scaled by time enabled over time running. Events the CPU or
+// hypervisor does not expose are reported as unavailable, not as zero.
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+enum class PerfEvent : std::size_t { Cycles, Instructions, L1dMisses, LlcMisses, BranchMisses, DtlbMisses, Count };
+
+constexpr std::size_t kPerfEventCount = static_cast<std::size_t>(PerfEvent::Count);
+
+// Counts of one measured interval. valid is false for events that were
+// not opened or never got scheduled on the PMU.
+struct PerfSample {
+    std::array<bool, kPerfEventCount> valid{};
+    std::array<double, kPerfEventCount> counts{};
+
+    bool has(PerfEvent event) const { return valid[static_cast<std::size_t>(event)]; }
+    double count(PerfEvent event) const { return counts[static_cast<std::size_t>(event)]; }
+};
+
+class PerfCounters {
+public:
+    // Opens events for the calling thread, warning about each that fails.
+    explicit PerfCounters(const std::vector<PerfEvent>& events) {
+        fds_.fill(-1);
+        for (PerfEvent event : events) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            describe(event, &attr);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fd < 0) {
+                std::cerr << "Warning: perf_event_open(" << name(event) << ") failed (" << std::strerror(errno)
+                          << "); it will not be reported." << std::endl;
+                continue;
+            }
+            fds_[static_cast<std::size_t>(event)] = fd;
+        }
+    }
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Every supported event, in report order
+    static std::vector<PerfEvent> all() {
+        return {PerfEvent::Cycles,       PerfEvent::Instructions, PerfEvent::L1dMisses,
+                PerfEvent::LlcMisses,    PerfEvent::BranchMisses, PerfEvent::DtlbMisses};
+    }
+
+    static const char* name(PerfEvent event) {
+        static const char* const kNames[kPerfEventCount] = {"cycles",     "instructions",  "L1d-misses",
+                                                            "LLC-misses", "branch-misses", "dTLB-misses"};
+        return kNames[static_cast<std::size_t>(event)];
+    }
+
+    bool available(PerfEvent event) const { return fds_[static_cast<std::size_t>(event)] >= 0; }
+
+    void start() {
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    PerfSample stop() {
+        for (int fd : fds_) {
+            if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        PerfSample sample;
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+            std::uint64_t values[3] = {}; // count, time enabled, time running
+            if (fds_[i] < 0 || ::read(fds_[i], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+                continue;
+            }
+            sample.valid[i] = true;
+            sample.counts[i] = static_cast<double>(values[0]) * values[1] / values[2];
+        }
+        return sample;
+    }
+
+private:
+    std::array<int, kPerfEventCount> fds_;
+
+    static void describe(PerfEvent event, perf_event_attr* attr) {
+        auto cacheMiss = [attr](std::uint64_t cache) {
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        attr->type = PERF_TYPE_HARDWARE;
+        switch (event) {
+            case PerfEvent::Cycles: attr->config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case PerfEvent::Instructions: attr->config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case PerfEvent::L1dMisses: cacheMiss(PERF_COUNT_HW_CACHE_L1D); break;
+            case PerfEvent::LlcMisses: cacheMiss(PERF_COUNT_HW_CACHE_LL); break;
+            case PerfEvent::BranchMisses: attr->config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            case PerfEvent::DtlbMisses: cacheMiss(PERF_COUNT_HW_CACHE_DTLB); break;
+            case PerfEvent::Count: break;
+        }
+    }
+};
+
+// Removes "--perf" from the arguments; true if it was there.
+inline bool takePerfFlag(int& argc, char** argv) {
+    bool found = false;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--perf") {
+            found = true;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    return found;
+}
+
+// Per-op columns for a result table: "<event>/op", or "n/a".
+inline std::string perfColumnHeader(PerfEvent event) {
+    return std::string(PerfCounters::name(event)) + "/op";
+}
+
+inline std::string perfPerOp(const PerfSample& sample, PerfEvent event, std::size_t ops) {
+    if (!sample.has(event) || ops == 0) {
+        return "n/a";
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.2f", sample.count(event) / ops);
+    return buffer;
+}
+
+#endif // PERF_COUNTERS_H
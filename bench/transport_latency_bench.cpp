@@ -0,0 +1,70 @@
+// bench/transport_latency_bench.cpp
+// Measures Get round-trip latency through the shared-memory transport
+// (ShmTransportServer + ShmCacheClient) with and without the spin window
+// before sleeping on the eventfd. Server and client run in one process on
+// separate threads, which exercises the same rings and wakeups as two
+// processes would.
+//
+// Usage: transport_latency_bench [requests] [value_bytes]
+#include "sharded_cache.h"
+#include "shm_transport_server.h"
+#include "shm_cache_client.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+
+struct LatencyResult {
+    double p50_us = 0;
+    double p99_us = 0;
+    double mean_us = 0;
+};
+
+static LatencyResult runTransport(std::chrono::microseconds spin, std::size_t requests, std::size_t value_bytes) {
+    ShardedCache cache(1, 1024, /*ttl=*/0);
+    cache.put("bench-key", std::string(value_bytes, 'v'));
+    std::string path = "/tmp/lru_cache_bench_" + std::to_string(::getpid()) + ".sock";
+    ShmTransportServer server(cache, nullptr, 1 << 20, spin);
+    if (!server.start(path)) return {};
+
+    ShmCacheClient client(spin);
+    if (!client.connect(path)) return {};
+    for (std::size_t i = 0; i < 1000; ++i) client.get("bench-key"); // Warm up
+
+    std::vector<double> samples;
+    samples.reserve(requests);
+    for (std::size_t i = 0; i < requests; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        client.get("bench-key");
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    client.close();
+    server.stop();
+
+    std::sort(samples.begin(), samples.end());
+    LatencyResult result;
+    result.p50_us = samples[samples.size() / 2];
+    result.p99_us = samples[samples.size() * 99 / 100];
+    double total = 0;
+    for (double s : samples) total += s;
+    result.mean_us = total / static_cast<double>(samples.size());
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::size_t requests = argc > 1 ? std::stoul(argv[1]) : 200000;
+    std::size_t value_bytes = argc > 2 ? std::stoul(argv[2]) : 64;
+
+    std::cout << "Get round trips: " << requests << ", value size: " << value_bytes << " bytes" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto spin : {std::chrono::microseconds(0), std::chrono::microseconds(50)}) {
+        LatencyResult r = runTransport(spin, requests, value_bytes);
+        std::cout << "shm, spin " << std::setw(3) << spin.count() << "us: p50 " << r.p50_us << " us, p99 "
+                  << r.p99_us << " us, mean " << r.mean_us << " us" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+// include/bloom_filter.h
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Blocked Bloom filter over 64-bit key hashes. All probes for a key fall
+// into one 64-byte block, so a lookup costs a single cache miss. Keys can
+// only be added; to forget keys, reset and re-add the ones still wanted.
+class BloomFilter {
+public:
+    explicit BloomFilter(std::size_t expected_keys = 0, std::size_t bits_per_key = 10);
+
+    // Clears the filter and resizes it for expected_keys.
+    void reset(std::size_t expected_keys);
+    void add(std::uint64_t hash);
+    // False means the key was definitely never added.
+    bool mayContain(std::uint64_t hash) const;
+
+    std::size_t bytes() const { return blocks_.size() * sizeof(Block); }
+
+private:
+    struct alignas(64) Block {
+        std::uint64_t words[8];
+    };
+    static constexpr unsigned kProbes = 6; // Bits set per key
+
+    std::size_t bits_per_key_;
+    std::vector<Block> blocks_;
+
+    std::size_t blockIndex(std::uint64_t hash) const;
+};
+
+#endif // BLOOM_FILTER_H
@@ -0,0 +1,97 @@
+// include/core_runtime.h
+#ifndef CORE_RUNTIME_H
+#define CORE_RUNTIME_H
+
+#include "spsc_queue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Thread-per-core executor: one pinned thread per core runs an event loop
+// that executes work for the state it owns (one cache shard each). Other
+// threads never touch that state; they hand work to the owning core through
+// SPSC rings, one ring per (producer thread, core) pair, so no locks are
+// taken on the request path. The submitting thread waits for completion.
+class CoreRuntime {
+public:
+    // Core i is pinned to cpus[i % cpus.size()] (no pinning if empty).
+    CoreRuntime(std::size_t cores, const std::vector<int>& cpus);
+    ~CoreRuntime();
+
+    std::size_t coreCount() const { return cores_.size(); }
+    // Index of the core the calling thread runs, or -1 for other threads.
+    static int currentCore();
+
+    // Runs fn on `core` and returns its result. Runs inline when called from
+    // that core. A core waiting on another core keeps serving its own rings,
+    // so cross-core calls cannot deadlock. An exception thrown by fn on the
+    // core is rethrown here.
+    template <typename Fn>
+    auto execute(std::size_t core, Fn&& fn) -> decltype(fn()) {
+        using Result = decltype(fn());
+        if (currentCore() == static_cast<int>(core)) {
+            return fn();
+        }
+        if constexpr (std::is_void_v<Result>) {
+            Task task;
+            task.invoke = [](void* ctx) { (*static_cast<std::remove_reference_t<Fn>*>(ctx))(); };
+            task.ctx = &fn;
+            submit(core, &task);
+        } else {
+            std::optional<Result> result;
+            auto body = [&] { result.emplace(fn()); };
+            Task task;
+            task.invoke = [](void* ctx) { (*static_cast<decltype(body)*>(ctx))(); };
+            task.ctx = &body;
+            submit(core, &task);
+            return std::move(*result);
+        }
+    }
+
+    CoreRuntime(const CoreRuntime&) = delete;
+    CoreRuntime& operator=(const CoreRuntime&) = delete;
+
+private:
+    // Lives on the submitter's stack until `done` is set by the core.
+    struct Task {
+        void (*invoke)(void*) = nullptr;
+        void* ctx = nullptr;
+        std::exception_ptr error; // Set by the core if invoke threw
+        std::atomic<bool> done{false};
+    };
+    // Rings from one producer slot to every core. A slot normally belongs to
+    // one thread; the flag only matters if more threads than slots exist.
+    struct ProducerSlot {
+        std::atomic_flag busy = ATOMIC_FLAG_INIT;
+        std::vector<std::unique_ptr<SpscQueue<Task*>>> rings; // Indexed by core
+    };
+    struct Core {
+        std::thread thread;
+        int wake_fd = -1;                  // eventfd the core blocks on when idle
+        std::atomic<bool> sleeping{false}; // Set before blocking; submitters then signal wake_fd
+    };
+
+    static constexpr std::size_t kMaxProducers = 256;
+    static constexpr std::size_t kRingCapacity = 64;
+
+    std::uint64_t id_; // Distinguishes runtimes in the per-thread slot cache
+    std::vector<Core> cores_;
+    std::vector<std::atomic<ProducerSlot*>> slots_;
+    std::atomic<std::size_t> next_slot_{0};
+    std::atomic<bool> stop_{false};
+
+    ProducerSlot& producerSlot();
+    void submit(std::size_t core, Task* task);
+    bool pollOnce(std::size_t core);
+    void wake(std::size_t core);
+    void coreLoop(std::size_t core, int cpu);
+};
+
+#endif // CORE_RUNTIME_H
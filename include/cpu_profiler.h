@@ -0,0 +1,45 @@
+// include/cpu_profiler.h
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Why CpuProfiler::profile did or did not sample.
+enum class ProfileResult {
+    Ok,
+    Busy,       // Another profile is running
+    TimerFailed // The SIGPROF handler or ITIMER_PROF could not be set up
+};
+
+// Stacks sampled by one CpuProfiler::profile run.
+struct CpuProfile {
+    std::string folded;        // "outer;...;inner count" per distinct stack, most sampled first
+    std::uint64_t samples = 0; // Stacks captured
+    std::uint64_t dropped = 0; // Samples past the buffer's capacity
+};
+
+// On-demand sampling profiler for the whole process. While profile() runs,
+// ITIMER_PROF sends SIGPROF every 1/frequency_hz seconds of CPU time the
+// process consumes, to a thread that is using the CPU. The handler claims
+// a slot of a preallocated buffer with an atomic increment and walks the
+// interrupted thread's frame-pointer chain into it, checking each frame
+// record's bounds and that its page is mapped; it takes no locks and does
+// not allocate. Code built without frame pointers (the library is built
+// with -fno-omit-frame-pointer) shortens the stacks. Idle threads cost
+// nothing and are never sampled. Afterwards the stacks are symbolized (see
+// symbolizer.h) and folded into the text format flamegraph.pl, speedscope
+// and Perfetto read.
+//
+// The SIGPROF handler is installed (SA_RESTART) on the first run and kept,
+// so a late signal can never hit the default action, which would kill the
+// process. Only one profile runs at a time.
+class CpuProfiler {
+public:
+    // Blocks the caller for duration. Anything but Ok leaves result
+    // untouched and samples nothing.
+    static ProfileResult profile(std::chrono::milliseconds duration, unsigned frequency_hz, CpuProfile* result);
+};
+
+#endif // CPU_PROFILER_H
@@ -0,0 +1,66 @@
+// include/epoll_server.h
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Minimal non-blocking TCP / Unix-socket server built on epoll, used by the
+// raw-protocol front-ends. Each loop thread owns an epoll instance and its
+// own listening socket (SO_REUSEPORT spreads TCP connections across them),
+// so connections are never shared between threads. Subclasses only parse
+// requests out of a connection's input buffer and append replies.
+class EpollServer {
+public:
+    explicit EpollServer(std::string name);
+    virtual ~EpollServer();
+
+    // address is "host:port" or "unix:/path/to/socket". Unix sockets always
+    // use a single loop thread. Returns false if the address cannot be bound.
+    bool start(const std::string& address, std::size_t threads = 1);
+    void stop();
+
+    EpollServer(const EpollServer&) = delete;
+    EpollServer& operator=(const EpollServer&) = delete;
+
+protected:
+    struct Connection {
+        int fd = -1;
+        std::string in;                 // Bytes received but not yet consumed
+        std::string out;                // Replies waiting to be written
+        bool close_after_write = false; // Set by the protocol to hang up
+        bool peer_closed = false;       // Peer shut down its side; only flushing remains
+        unsigned watched_events = 0;    // epoll events currently registered
+        int protocol_state = 0;         // Free for the protocol (e.g. negotiated version)
+    };
+
+    // Parses as many complete requests from conn.in as possible, appends the
+    // replies to conn.out and returns the number of input bytes consumed.
+    // Called on the connection's loop thread.
+    virtual std::size_t onData(Connection& conn) = 0;
+
+    const std::string& name() const { return name_; }
+
+private:
+    struct Loop {
+        int epoll_fd = -1;
+        int listen_fd = -1;
+        int wake_fd = -1; // eventfd used to interrupt epoll_wait on stop()
+        std::thread thread;
+    };
+
+    std::string name_;
+    std::string unix_path_; // Unlinked on stop()
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> stopping_{false};
+
+    int openListener(const std::string& address, bool reuse_port);
+    void run(Loop& loop);
+    bool flush(Connection& conn);
+};
+
+#endif // EPOLL_SERVER_H
@@ -0,0 +1,118 @@
+// include/flash_tier.h
+#ifndef FLASH_TIER_H
+#define FLASH_TIER_H
+
+#include "bloom_filter.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A value read back from the flash tier.
+struct FlashRecord {
+    std::string value;              // As stored by the RAM tier, possibly compressed
+    std::uint32_t raw_length = 0;   // Uncompressed size if value is compressed, 0 otherwise
+    std::int64_t expires_at_ms = 0; // As stored by the RAM tier, 0 = none
+};
+
+// Second-level cache on local flash for entries evicted from RAM. The
+// backing file is split into fixed-size regions used as a circular log:
+// records are appended to an in-memory write buffer for the active region.
+// When it is full, the buffer is swapped with a second one and a writer
+// thread writes it out in one sequential pwrite, off the cache mutex; the
+// next seal waits only if that write has not finished. When the log
+// wraps, the oldest region is reclaimed whole (FIFO), dropping whatever it
+// still indexes, so flash never sees random writes or garbage collection.
+//
+// The index maps a 64-bit key hash to the record's location (12 bytes per
+// entry); the key is stored with the record and checked on read, so a hash
+// collision costs at most one wasted read. A blocked Bloom filter over the
+// indexed hashes sits in front of it: most RAM misses for keys that were
+// never spilled are answered by one cache-line probe. Removed keys stay in
+// the filter until it is rebuilt from the index each time a region is
+// reclaimed, which is also when most keys leave the tier.
+// Not thread-safe: used only under the cache mutex, so reads (not region writes) hit the file inside it.
+class FlashTier {
+public:
+    FlashTier(std::size_t region_bytes, std::size_t region_count);
+    ~FlashTier();
+
+    // Creates (or truncates) the backing file. Contents do not survive a
+    // restart; the WAL rebuilds RAM and evictions refill the tier.
+    bool open(const std::string& path);
+
+    // Appends an evicted entry; value and raw_length are kept as the RAM
+    // tier stored them (see FlashRecord). stale_after_ms (Unix ms, 0 =
+    // never) is when the entry would have expired through inactivity.
+    // False if the record is larger than a region or the write failed.
+    bool append(const std::string& key, const std::string& value, std::uint32_t raw_length,
+                std::int64_t expires_at_ms, std::int64_t stale_after_ms);
+    // Looks up key and, on a hit, removes it from the tier (the caller
+    // promotes it to RAM). Expired or stale records count as misses.
+    std::optional<FlashRecord> take(const std::string& key);
+    // Forgets key's record, e.g. when RAM receives a newer value. Returns
+    // true if a record was indexed.
+    bool erase(const std::string& key);
+    bool contains(const std::string& key) const;
+
+    // --- Stats ---
+    std::size_t entryCount() const { return index_.size(); }
+    std::size_t regionBytes() const { return region_bytes_; }
+    std::size_t regionCount() const { return regions_.size(); }
+    std::uint64_t reads() const { return reads_; }
+    std::uint64_t hits() const { return hits_; }
+    std::uint64_t filteredLookups() const { return filtered_; } // Misses answered by the filter
+    std::size_t filterBytes() const { return filter_.bytes(); }
+
+    FlashTier(const FlashTier&) = delete;
+    FlashTier& operator=(const FlashTier&) = delete;
+
+private:
+    struct Location {
+        std::uint32_t region;
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+    struct Region {
+        std::vector<std::uint64_t> hashes; // Records appended, for reclamation
+    };
+
+    std::size_t region_bytes_;
+    std::vector<Region> regions_;
+    std::unordered_map<std::uint64_t, Location> index_;
+    int fd_ = -1;
+    std::uint32_t active_ = 0;     // Region receiving appends
+    std::vector<char> buffer_;     // Write buffer for the active region
+    std::size_t buffer_used_ = 0;
+    std::vector<char> sealed_;     // Last sealed region, served from here until the next seal
+    std::size_t sealed_used_ = 0;
+    std::uint32_t sealed_region_ = UINT32_MAX;
+
+    // --- Region Writer ---
+    std::thread writer_;
+    std::mutex write_mtx_;
+    std::condition_variable write_cv_;
+    bool write_pending_ = false; // Guarded by write_mtx_
+    bool write_failed_ = false;  // Guarded by write_mtx_
+    bool stopping_ = false;      // Guarded by write_mtx_
+    std::uint64_t reads_ = 0;
+    std::uint64_t hits_ = 0;
+    std::uint64_t filtered_ = 0;
+    BloomFilter filter_;
+    std::size_t region_records_ = 0; // Most records one region has held, for sizing the filter
+
+    static std::uint64_t hashKey(const std::string& key);
+    bool sealActive();             // Hands the buffer to the writer and reclaims the next region
+    bool waitForWrite();           // Waits for the writer; true if its last write failed
+    void writerLoop();
+    void reclaim(std::uint32_t region);
+    void rebuildFilter();
+    bool readRecord(const Location& location, std::string& out);
+};
+
+#endif // FLASH_TIER_H
@@ -0,0 +1,82 @@
+// include/hot_key_replicas.h
+#ifndef HOT_KEY_REPLICAS_H
+#define HOT_KEY_REPLICAS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Version of a replicated hot key. Its shard bumps it, under the shard
+// lock, on every write, removal, eviction or expiry change of the key.
+struct HotKeyVersion {
+    std::atomic<std::uint64_t> value{0};
+};
+
+// Per-core read-only copies of the keys their shards have promoted as hot
+// (see LRUCache::startHotKeyReplication). A read of a promoted key is
+// served from the calling CPU's table under that table's own lock, which
+// no other core normally touches, instead of from the shard. That way one
+// hot key's reads scale across cores instead of queueing on one shard lock.
+//
+// A copy is used only while it was filled at the key's current version
+// and is younger than kRefreshInterval. Writes therefore invalidate every
+// copy at once without touching the tables. The periodic refresh sends a
+// read back to the shard, which keeps the entry's LRU position and
+// inactivity TTL current and honours expiry deadlines.
+class HotKeyReplicas {
+public:
+    static constexpr std::chrono::milliseconds kRefreshInterval{100};
+
+    explicit HotKeyReplicas(std::size_t tables = 0); // 0: one per hardware thread
+
+    enum class Lookup {
+        NotHot, // Not promoted: read the shard as usual
+        Hit,    // value set from the local copy
+        Stale   // Promoted, but the local copy must be refilled from the shard
+    };
+    // Cheap check for the read path: is any key promoted at all?
+    bool active() const { return promoted_.load(std::memory_order_relaxed) != 0; }
+    Lookup get(const std::string& key, std::shared_ptr<const std::string>* value);
+    // Stores value, read from the shard at version, as the calling CPU's
+    // copy. Expires with the entry's deadline (0 = none). Ignored if the key
+    // has been demoted meanwhile.
+    void fill(const std::string& key, std::uint64_t version, std::shared_ptr<const std::string> value,
+              std::int64_t expires_at_ms);
+
+    // --- Promotion (called by the owning shard, under its lock) ---
+    void promote(const std::string& key, std::shared_ptr<HotKeyVersion> version);
+    void demote(const std::string& key);
+    // Copy hits of key on all cores since the last call
+    std::uint64_t takeHits(const std::string& key);
+
+    std::size_t promotedCount() const { return promoted_.load(std::memory_order_relaxed); }
+
+    HotKeyReplicas(const HotKeyReplicas&) = delete;
+    HotKeyReplicas& operator=(const HotKeyReplicas&) = delete;
+
+private:
+    struct Copy {
+        std::shared_ptr<HotKeyVersion> version;
+        std::uint64_t filled_version = 0;
+        std::shared_ptr<const std::string> value; // nullptr until filled
+        std::chrono::steady_clock::time_point valid_until;
+        std::uint64_t hits = 0;
+    };
+    struct alignas(64) Table {
+        std::mutex mtx;
+        std::unordered_map<std::string, Copy> copies;
+    };
+
+    std::unique_ptr<Table[]> tables_;
+    std::size_t table_count_;
+    std::atomic<std::size_t> promoted_{0};
+
+    Table& local();
+};
+
+#endif // HOT_KEY_REPLICAS_H
@@ -0,0 +1,89 @@
+// include/hot_keys.h
+#ifndef HOT_KEYS_H
+#define HOT_KEYS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One of the most accessed keys, as estimated by a HotKeySketch.
+struct HotKeyEstimate {
+    std::string key;
+    std::uint64_t count = 0;  // Estimated accesses (Gets and Puts) over the reported span
+    std::uint64_t error = 0;  // count overestimates by at most this (sampling noise aside)
+    double per_second = 0;    // count over the span
+    std::size_t shard = 0;    // Owning shard (set by ShardedCache)
+};
+
+// Streaming heavy-hitters summary (Metwally et al.'s space-saving) over a
+// sample of accesses. It tracks at most `capacity` keys. A new key takes
+// the slot of the least counted one and inherits its count as its error,
+// so every key accessed more often than 1/capacity of the sampled traffic
+// is guaranteed to be listed. Accesses are sampled 1 in sample_rate
+// (geometric skips, so the fast path is a decrement) and counts are scaled
+// back up when read.
+//
+// Counts cover a sliding span of one to two windows: when a window ends,
+// its summary is kept as the previous one and a new one starts, so rates
+// follow shifts in traffic. Not thread-safe; LRUCache calls it under the
+// shard lock.
+class HotKeySketch {
+public:
+    HotKeySketch(std::size_t capacity, std::uint32_t sample_rate, std::chrono::seconds window);
+
+    // Counts one access to key with probability 1/sample_rate.
+    void record(const std::string& key) {
+        if (--skip_ != 0) {
+            return;
+        }
+        skip_ = nextSkip();
+        offer(key);
+    }
+
+    // Up to limit keys, most accessed first.
+    std::vector<HotKeyEstimate> top(std::size_t limit);
+
+    std::uint32_t sampleRate() const { return sample_rate_; }
+
+private:
+    // Heap entries point into slots_, whose nodes never move, so sifting
+    // moves no strings and hashes nothing
+    struct Entry {
+        const std::string* key;
+        std::size_t* slot; // This entry's index in heap_, kept up to date
+        std::uint64_t count;
+        std::uint64_t error;
+    };
+    struct Counted {
+        std::string key;
+        std::uint64_t count;
+        std::uint64_t error;
+    };
+
+    std::size_t capacity_;
+    std::uint32_t sample_rate_;
+    std::chrono::steady_clock::duration window_;
+    std::uint64_t skip_ = 1;   // Accesses until the next sampled one
+    std::uint64_t rng_;        // xorshift64 state for the skips
+    unsigned until_clock_check_ = 0; // Sampled accesses until the window end is checked
+
+    // Current window: min-heap on count, plus each key's heap slot
+    std::vector<Entry> heap_;
+    std::unordered_map<std::string, std::size_t> slots_;
+    std::chrono::steady_clock::time_point window_start_;
+    // Previous window, kept so rates never start from an empty summary
+    std::vector<Counted> previous_;
+    std::chrono::steady_clock::duration previous_span_{0};
+
+    void offer(const std::string& key);
+    void rotateIfDue(std::chrono::steady_clock::time_point now);
+    std::uint64_t nextSkip();
+    void siftDown(std::size_t index);
+    void siftUp(std::size_t index);
+    void swapSlots(std::size_t a, std::size_t b);
+};
+
+#endif // HOT_KEYS_H
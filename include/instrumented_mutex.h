@@ -0,0 +1,102 @@
+// include/instrumented_mutex.h
+#ifndef INSTRUMENTED_MUTEX_H
+#define INSTRUMENTED_MUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One of the longest critical sections seen for a lock, by call site.
+struct LockHolderSample {
+    std::string site;             // Symbolized frames, innermost first
+    std::uint64_t max_hold_ns = 0;
+    std::uint64_t samples = 0;    // Long holds seen from this site
+};
+
+// Totals for every lock sharing a name (e.g. all shard locks), including
+// locks already destroyed.
+struct LockSnapshot {
+    std::string name;
+    std::size_t instances = 0; // Live locks with this name
+    std::uint64_t acquisitions = 0;
+    std::uint64_t contended = 0; // Acquisitions that found the lock held
+    std::uint64_t wait_ns = 0;   // Spent blocked in contended acquisitions
+    std::uint64_t hold_ns = 0;
+    std::uint64_t max_hold_ns = 0;
+    std::vector<LockHolderSample> longest_holders; // Longest first
+};
+
+// A std::mutex replacement (lock/try_lock/unlock, so it works with
+// std::lock_guard, std::unique_lock and std::condition_variable_any) that
+// profiles itself: acquisitions, contended acquisitions, time spent waiting,
+// time held, and a backtrace of the sites holding it longest.
+//
+// Every statistic is updated by the thread holding the lock, so it needs no
+// synchronisation of its own; an uncontended acquisition costs two clock
+// reads on top of the mutex. Only a hold longer than the shortest one
+// already sampled pays for a backtrace. Frames are symbolized with dladdr
+// when read, so link with -rdynamic (ENABLE_EXPORTS) for function names.
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(const char* name);
+    ~InstrumentedMutex();
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    // All instrumented locks, grouped by name.
+    static std::vector<LockSnapshot> snapshot();
+    // lru_cache_lock_*{lock="<name>"} series in Prometheus text format.
+    static std::string formatPrometheus(const std::vector<LockSnapshot>& locks);
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    // --- Internal (shared with the registry in instrumented_mutex.cpp) ---
+    static constexpr std::size_t kSampledHolders = 8;
+    static constexpr int kSampleDepth = 6;
+    struct HolderSample {
+        void* frames[kSampleDepth] = {};
+        int depth = 0;
+        std::uint64_t max_hold_ns = 0;
+        std::uint64_t samples = 0;
+    };
+    struct Stats {
+        std::atomic<std::uint64_t> acquisitions{0};
+        std::atomic<std::uint64_t> contended{0};
+        std::atomic<std::uint64_t> wait_ns{0};
+        std::atomic<std::uint64_t> hold_ns{0};
+        std::atomic<std::uint64_t> max_hold_ns{0};
+        HolderSample holders[kSampledHolders]; // Guarded by the mutex itself
+        std::uint64_t sample_floor_ns = 0;     // Shortest hold worth a backtrace
+    };
+
+private:
+    std::mutex mtx_;
+    const char* name_;
+    Stats stats_;
+    std::chrono::steady_clock::time_point acquired_at_;
+
+    void onAcquired(std::chrono::steady_clock::time_point now);
+    void sampleHolder(std::uint64_t hold_ns); // Lock held
+    friend struct LockRegistry;
+};
+
+// The mutex type of the cache's hot locks (shard locks, replication queue).
+// Instrumented when built with -DLRU_CACHE_LOCK_PROFILING=ON; otherwise a
+// plain std::mutex that ignores the name.
+#ifdef LRU_CACHE_LOCK_PROFILING
+using CacheMutex = InstrumentedMutex;
+#else
+class CacheMutex : public std::mutex {
+public:
+    explicit CacheMutex(const char* /*name*/) {}
+};
+#endif
+
+#endif // INSTRUMENTED_MUTEX_H
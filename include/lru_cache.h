@@ -2,25 +2,162 @@
 #define LRU_CACHE_H
 
 #include "node.h"
+#include "region_arena.h"
+#include "slab_allocator.h"
+#include "node_pool.h"
+#include "flash_tier.h"
+#include "value_codec.h"
+#include "value_table.h"
+#include "instrumented_mutex.h"
+#include "hot_keys.h"
+#include "hot_key_replicas.h"
 #include <string>
 #include <unordered_map>
 #include <mutex>
 #include <cstddef>
 #include <fstream> // Include for std::ofstream
 #include <optional> // Include for optional return values
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+// Value plus its CAS version, returned by getWithCas. A large object's
+// value is a handle to the stored bytes, copied by nobody (see getShared).
+struct CacheEntry {
+    std::shared_ptr<const std::string> value;
+    std::uint64_t cas = 0;
+};
+
+// Outcome of a compare-and-swap.
+enum class CasResult {
+    Stored,   // Version matched, value replaced
+    Exists,   // Key present but modified since the version was read
+    NotFound, // Key missing or expired
+    TooLarge, // Value exceeds the large-object budget and can never be stored
+    Failed    // WAL write failed
+};
+
+// A value in the form the cache keeps it: possibly compressed, possibly in
+// a shared buffer (large-object store, dedup table). Prepared and decoded
+// outside the shard lock.
+struct StoredValue {
+    std::string bytes;                         // Stored bytes, unless held in shared
+    std::shared_ptr<const std::string> shared; // Set for values kept in a shared buffer
+    bool large = false;                        // Belongs in the large-object store
+    std::uint32_t raw_length = 0;              // Uncompressed size if compressed, 0 otherwise
+    std::size_t storedSize() const { return shared ? shared->size() : bytes.size(); }
+};
+
+// One operation of a pipelined batch (see LRUCache::applyBatch). The caller
+// fills the inputs; the cache fills status and result.
+struct CacheOp {
+    enum class Type { Get, Put, Remove, Expire, Incr };
+    enum class Status { Ok, NotFound, NotInteger, TooLarge, Failed };
+
+    Type type = Type::Get;
+    std::string key;
+    std::string value;              // Put: new value
+    std::int64_t expires_at_ms = 0; // Put/Expire: absolute expiry (Unix ms), 0 = none
+    std::int64_t delta = 0;         // Incr: amount to add
+
+    // --- Results ---
+    // Get/Remove/Expire report NotFound for missing keys; Incr starts them at 0.
+    Status status = Status::Ok;
+    // Get: the value. Incr/Expire: the key's resulting value, with
+    // expires_at_ms updated to its resulting expiry (for replication).
+    std::string result;
+    // Scratch space for applyBatch: a Put's value encoded before locking,
+    // or a Get's value as stored, decoded into result after unlocking.
+    StoredValue stored;
+};
+
+// One record of the WAL (see LRUCache::readWAL). Records are
+// op,key_len,value_len,expires_at_ms,<key><value>\n with op PUT2, DEL2 or
+// EXP2, so keys and values may hold any byte. Older builds wrote
+// PUT,key,value / PUTX,key,expires_at_ms,value / DEL,key / EXP,key,expires_at_ms
+// lines, which are still replayed.
+struct WalRecord {
+    enum class Type { Put, Remove, Expire };
+
+    Type type = Type::Put;
+    std::string key;
+    std::string value;              // Put only
+    std::int64_t expires_at_ms = 0; // PUTX/EXP
+};
 
 class LRUCache {
 private:
     std::size_t capacity;
-    std::unordered_map<std::string, Node*> cache;
+    // Index: stable 64-bit key hash -> node. Keys are stored once, in the
+    // node; the rare entries with equal hashes are told apart by key.
+    std::unordered_multimap<std::uint64_t, Node*> cache;
     Node* head;
     Node* tail;
-    mutable std::mutex mtx; // Made mutable for locking in const print()
+    mutable CacheMutex mtx{"shard"}; // Made mutable for locking in const print(); profiled with LRU_CACHE_LOCK_PROFILING
     int ttl_seconds;
+    std::uint64_t next_cas_ = 0; // Source of Node::cas versions
 
     // --- WAL Member ---
     std::ofstream* wal_stream_ = nullptr; // Pointer to the WAL output stream (optional)
 
+    int numa_node_ = -1; // Preferred NUMA node for this cache's mappings
+
+    // --- Node Pool (optional, see enableNodePool) ---
+    std::unique_ptr<NodePool> node_pool_;
+
+    // --- Arena Members (optional, see enableArena) ---
+    std::unique_ptr<RegionArena> arena_;
+
+    // --- Slab Members (optional, see enableSlabs) ---
+    struct SlabClassState {
+        Node* head = nullptr; // Most recently used value of this class
+        Node* tail = nullptr; // Eviction candidate for this class
+        std::size_t pressure = 0; // Evictions/alloc failures since last rebalance
+    };
+    std::unique_ptr<SlabAllocator> slabs_;
+    std::vector<SlabClassState> slab_classes_;
+
+    // --- Flash Tier (optional, see enableFlashTier) ---
+    std::unique_ptr<FlashTier> flash_;
+
+    // --- Large-object Store (optional, see enableLargeObjects) ---
+    Node* large_head;                  // Sentinels of the store's own LRU list
+    Node* large_tail;
+    std::size_t large_threshold_ = 0;  // Values of at least this many bytes go to the store; 0 = off
+    std::size_t large_budget_ = 0;     // Bytes of values the store may hold
+    std::size_t large_bytes_ = 0;
+    std::size_t large_count_ = 0;      // Entries in the store (not counted against capacity)
+
+    // --- Compression (optional, see enableCompression) ---
+    std::unique_ptr<ValueCodec> codec_;
+    std::size_t compress_min_bytes_ = 0;
+    std::size_t compressed_raw_bytes_ = 0;    // Uncompressed size of the compressed values held
+    std::size_t compressed_stored_bytes_ = 0; // Their stored size
+
+    // --- Key Interning (optional, see enableKeyInterning) ---
+    std::unique_ptr<ValueTable> key_table_; // Interned key prefixes
+    char key_delimiter_ = ':';
+
+    // --- Deduplication (optional, see enableDedup) ---
+    std::unique_ptr<ValueTable> value_table_;
+    std::size_t dedup_min_bytes_ = 0;
+
+    // --- Hot-key Detection (optional, see enableHotKeys) ---
+    std::unique_ptr<HotKeySketch> hot_keys_;
+    // Keys promoted to per-core copies (see startHotKeyReplication)
+    HotKeyReplicas* hot_replicas_ = nullptr; // Owned by the ShardedCache
+    std::unordered_map<std::string, std::shared_ptr<HotKeyVersion>> hot_versions_;
+
+    // --- Background Maintenance (compactor, slab rebalancer) ---
+    std::vector<std::thread> background_threads_;
+    std::mutex background_mtx_;
+    std::condition_variable background_cv_;
+    std::atomic<bool> stop_background_{false};
+
     // --- Internal methods (assume lock is held by caller) ---
     void addNodeToHead(Node* node);
     void removeNodeFromList(Node* node);
@@ -29,14 +166,88 @@ private:
     void removeInternal(Node* node); // Removes from map/list and deletes node
     bool isExpired(const Node* node) const;
 
+    PageOptions pageOptions(bool huge_pages) const;
+
+    // --- Node allocation helpers (assume lock is held) ---
+    Node* createNode(const std::string& key); // Interns the key's prefix when enabled
+    std::size_t internSplit(const std::string& key) const; // Index of the interned prefix's delimiter
+    void destroyNode(Node* node);
+
+    // --- Key index helpers (assume lock is held) ---
+    static bool keyEquals(const Node* node, const std::string& key);
+    static std::string keyOf(const Node* node); // Reassembles an interned key
+    Node* lookup(const std::string& key) const;
+    void indexInsert(Node* node, const std::string& key);
+    void indexErase(Node* node);
+
+    // --- Value storage helpers (assume lock is held) ---
+    // Route value bytes to the arena when enabled, otherwise to Node::value.
+    // Moves an encoded value into node's storage. False if the value
+    // belongs in the slabs and no chunk could be freed for it.
+    bool storeValue(Node* node, StoredValue& stored);
+    bool isLarge(std::size_t value_bytes) const;
+    bool isDeduplicated(std::size_t stored_bytes) const;
+    std::string loadValue(const Node* node) const;  // Decoded value
+    std::string loadStored(const Node* node) const; // Stored (possibly compressed) bytes
+    std::size_t storedLength(const Node* node) const; // Size of loadStored() without copying
+    std::size_t valueLength(const Node* node) const;  // Size of loadValue() without decoding
+    // Node's value as stored, to be decoded once the lock is released
+    void captureStored(const Node* node, StoredValue* stored) const;
+    void releaseValue(Node* node);
+    bool storeInSlab(Node* node, const std::string& value);
+    bool takeSlabPage(std::uint16_t cls);
+    void evacuateSlabPage(std::uint16_t cls, std::uint32_t page);
+    void linkClassHead(Node* node);
+    void unlinkClass(Node* node);
+    void runPeriodically(std::chrono::seconds interval, std::function<void()> task);
+
+    // --- Hot-key replication helpers (assume lock is held) ---
+    void invalidateHot(const std::string& key); // Outdates every core's copy of key
+    void refreshHotReplicas(double min_rate, std::size_t max_keys, double interval_seconds);
+
+    // --- Flash tier helpers (assume lock is held) ---
+    void spillToFlash(const Node* node); // Called for every eviction
+    Node* promoteFromFlash(const std::string& key);
+
+    // --- Encoding (needs no lock; codec and thresholds are fixed before serving) ---
+    // Compresses the value if that pays off and moves it into a shared
+    // buffer if it is large or will be deduplicated.
+    StoredValue encodeValue(const std::string& value) const;
+    // Moves already stored bytes into a shared buffer if they are large or
+    // will be deduplicated (the second half of encodeValue).
+    void shareIfNeeded(StoredValue& stored) const;
+    std::string decodeValue(StoredValue&& stored) const;
+
+    // --- Large-object helpers ---
+    void evictLargeObjects(const Node* keep); // Trims the store to its budget; assumes lock is held
+    // True if the value could never fit in the large-object store. Needs no
+    // lock (the budget is fixed before serving), so puts reject it early.
+    bool exceedsLargeBudget(const StoredValue& stored) const;
+
     // --- Internal logging helper (assumes lock is held) ---
     bool writeLogEntry(const std::string& entry);
+    bool defer_wal_flush_ = false; // Set by applyBatch: one flush per batch
 
     // --- Internal sync methods (now return bool for WAL success) ---
     // is_recovery flag prevents writing WAL during recovery phase
     std::optional<std::string> get_sync(const std::string& key); // Return optional string
-    bool put_sync(const std::string& key, const std::string& value, bool is_recovery = false);
-    bool remove_sync(const std::string& key, bool is_recovery = false);
+    bool put_sync(const std::string& key, const std::string& value, std::int64_t expires_at_ms = 0,
+                  bool is_recovery = false, bool* too_large = nullptr, std::uint64_t* cas = nullptr);
+    bool remove_sync(const std::string& key, bool is_recovery = false, bool* existed = nullptr);
+
+    // --- Lock-held variants (shared by the sync methods and applyBatch) ---
+    // With `stored`, the value is returned through it in stored form (to be
+    // decoded after unlocking) and the optional holds an empty string.
+    std::optional<std::string> get_locked(const std::string& key, StoredValue* stored = nullptr);
+    // `encoded` (moved from) is value already encoded by the caller; `cas`
+    // (optional) receives the version of the stored entry.
+    bool put_locked(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                    bool is_recovery, StoredValue* encoded = nullptr, std::uint64_t* cas = nullptr);
+    bool remove_locked(const std::string& key, bool is_recovery, bool* existed);
+    bool slabStoreFailed(const std::string& key, bool is_recovery);
+    CacheOp::Status expire_locked(const std::string& key, std::int64_t expires_at_ms, bool is_recovery);
+    void applyOp(CacheOp& op);
+    Node* findLive(const std::string& key); // Drops the entry if expired
 
 
 public:
@@ -47,22 +258,175 @@ public:
     // --- Method to attach WAL stream after construction ---
     void setWalStream(std::ofstream* stream);
 
+    // Hash the index uses: FNV-1a over prefix then suffix, so an interned
+    // key hashes like the whole key. Also how the slow-op log names keys.
+    static std::uint64_t hashKey(std::string_view prefix, std::string_view suffix = {});
+
+    // --- NUMA Placement ---
+    // Node pool, arena and slab mappings created afterwards are bound to
+    // numa_node. Call before enabling them.
+    void setNumaNode(int numa_node);
+    int numaNode() const { return numa_node_; }
+
+    // --- Node Pool ---
+    // Allocates nodes from pooled extents, optionally backed by 2 MB huge
+    // pages. Only possible while the cache is empty; returns false otherwise.
+    bool enableNodePool(bool huge_pages);
+
+    // --- Arena (per-cache region storage for value bytes) ---
+    // Moves value bytes into mmap'd regions of region_bytes each. Existing
+    // values are migrated. Call before serving traffic.
+    void enableArena(std::size_t region_bytes, bool huge_pages = false);
+    // Relocates live values out of regions whose live ratio is at or below
+    // max_live_ratio and unmaps regions left empty. Returns bytes released.
+    std::size_t compactArena(double max_live_ratio);
+    // Runs compactArena on a background thread every `interval`.
+    void startArenaCompactor(std::chrono::seconds interval, double max_live_ratio);
+
+    // --- Slabs (size-class value storage with per-class LRU) ---
+    // Stores values in slab chunks, with at most memory_limit_bytes of pages.
+    // When a class is full its own LRU tail is evicted, so the put path stays
+    // O(1). Takes precedence over the arena. Call before serving traffic.
+    void enableSlabs(std::size_t page_bytes, std::size_t memory_limit_bytes, double growth_factor,
+                     bool huge_pages = false);
+    // Moves one page from the class under the least pressure to the class
+    // under the most, evicting the page's values. Returns true if moved.
+    bool rebalanceSlabs();
+    void startSlabRebalancer(std::chrono::seconds interval);
+
+    // --- Flash Tier (second-level cache for evicted entries) ---
+    // Evicted entries are appended to a log-structured file at path, split
+    // into region_count regions of region_bytes, instead of being dropped.
+    // A RAM miss that hits the tier promotes the entry back into RAM. Call
+    // before WAL recovery.
+    bool enableFlashTier(const std::string& path, std::size_t region_bytes, std::size_t region_count);
+
+    // --- Large-object Store (separate LRU for big values) ---
+    // Values of at least threshold_bytes are kept apart from the main LRU
+    // list, in a list of their own limited to budget_bytes, and do not
+    // count against the entry capacity. A large put therefore only evicts
+    // other large objects, and its bytes are copied before the lock is
+    // taken. Reads share the stored bytes (see getShared) or copy them
+    // after unlocking. Call before WAL recovery.
+    // Only possible while the cache is empty; returns false otherwise.
+    bool enableLargeObjects(std::size_t threshold_bytes, std::size_t budget_bytes);
+    std::size_t largeObjectBytes() const;
+
+    // --- Compression ---
+    // Values of at least min_bytes are stored compressed with codec when
+    // that makes them smaller. Compression runs before the shard lock is
+    // taken and decompression after it is released; slab, arena and
+    // large-object budgets are charged the compressed size. Only possible
+    // while the cache is empty; returns false otherwise.
+    bool enableCompression(std::unique_ptr<ValueCodec> codec, std::size_t min_bytes);
+    // Uncompressed and stored size of the values held compressed.
+    std::pair<std::size_t, std::size_t> compressionBytes() const;
+
+    // --- Key Interning ---
+    // Stores a prefix of each long key, ending in a delimiter, once per
+    // shard in a refcounted table; nodes keep only the suffix. The prefix
+    // is the shortest one that leaves a suffix short enough to be stored
+    // inline in the node (e.g. "tenant:1234:user:" of
+    // "tenant:1234:user:5678:profile"), so it is widely shared and the
+    // key needs no allocation of its own. Only possible while the cache is
+    // empty; returns false otherwise.
+    bool enableKeyInterning(char delimiter = ':');
+    // Bytes not held thanks to interning, and the distinct prefixes kept.
+    std::size_t keyPrefixSavedBytes() const;
+    std::size_t keyPrefixCount() const;
+
+    // --- Deduplication ---
+    // Values whose stored form (after compression) is at least min_bytes
+    // are kept once per shard in a refcounted, content-addressed table;
+    // entries with equal values point at the same buffer. Suits many keys
+    // holding the same flags or default configs. Only possible while the
+    // cache is empty; returns false otherwise.
+    bool enableDedup(std::size_t min_bytes);
+    // Bytes not held thanks to deduplication, and the distinct values kept.
+    std::size_t dedupSavedBytes() const;
+    std::size_t dedupUniqueValues() const;
+
+    // --- Hot-key Detection ---
+    // Feeds a sample of Gets and Puts (1 in sample_rate, client traffic
+    // only) to a space-saving sketch of `capacity` keys, updated under the
+    // shard lock. Counts and rates cover the last one to two windows.
+    void enableHotKeys(std::size_t capacity, std::uint32_t sample_rate, std::chrono::seconds window);
+    // Up to limit of the shard's most accessed keys; empty when disabled.
+    std::vector<HotKeyEstimate> hotKeys(std::size_t limit);
+    std::uint32_t hotKeySampleRate() const; // 0 when disabled
+
+    // --- Hot-key Replication ---
+    // Every interval, promotes the keys the sketch rates at min_rate ops/s
+    // or more (at most max_keys) to per-core copies in replicas, and demotes
+    // those whose traffic, copies included, fell below half of it. Writes
+    // to a promoted key outdate its copies. Needs enableHotKeys; replicas
+    // must outlive this cache.
+    void startHotKeyReplication(HotKeyReplicas* replicas, std::chrono::seconds interval, double min_rate,
+                                std::size_t max_keys);
+    // A read for refilling a copy. version is the key's version at the time
+    // of the read (nullptr value if missing); promoted is false once the key
+    // has been demoted.
+    struct HotRead {
+        std::shared_ptr<const std::string> value;
+        bool promoted = false;
+        std::uint64_t version = 0;
+        std::int64_t expires_at_ms = 0;
+    };
+    HotRead readHot(const std::string& key);
+
+    // Stops the compactor/rebalancer threads (also done by the destructor).
+    void stopBackgroundTasks();
+
     // --- Public API (will call internal sync methods) ---
     // These might change slightly if we want to expose WAL failure
     std::optional<std::string> get(const std::string& key);
-    bool put(const std::string& key, const std::string& value);
-    bool remove(const std::string& key);
+    // expires_at_ms: absolute expiry in Unix ms. 0 leaves the entry under
+    // the cache-wide inactivity TTL; otherwise only the deadline applies.
+    // too_large (optional) reports a value rejected before locking because
+    // it exceeds the large-object budget, as opposed to a WAL failure.
+    // cas (optional) receives the CAS version of the stored entry.
+    bool put(const std::string& key, const std::string& value, std::int64_t expires_at_ms = 0,
+             bool* too_large = nullptr, std::uint64_t* cas = nullptr);
+    // existed (optional) reports whether a live entry was actually removed.
+    bool remove(const std::string& key, bool* existed = nullptr);
+    // Zero-copy read: large objects are returned as a handle to the stored
+    // bytes, which stay valid after the entry is replaced or evicted. Small
+    // values are copied into a new handle. nullptr if missing.
+    std::shared_ptr<const std::string> getShared(const std::string& key);
+
+    // --- Versioned Access (memcached gets/cas) ---
+    // The value is decoded after unlocking; large objects are shared, not copied.
+    std::optional<CacheEntry> getWithCas(const std::string& key);
+    // new_cas (optional) receives the entry's new version when Stored.
+    CasResult compareAndSwap(const std::string& key, const std::string& value, std::uint64_t expected_cas,
+                             std::int64_t expires_at_ms = 0, std::uint64_t* new_cas = nullptr);
+
+    // --- Batched Access (pipelined front-ends) ---
+    // Applies ops in order under a single lock acquisition, with one WAL
+    // flush for the whole batch.
+    void applyBatch(const std::vector<CacheOp*>& ops);
+
+    // Wall clock in Unix milliseconds, the time base of expires_at_ms.
+    static std::int64_t nowUnixMs();
 
     // --- Public Replication API (Replica-facing) --- ADD THESE ---
-    bool applyReplicatedPut(const std::string& key, const std::string& value);
+    bool applyReplicatedPut(const std::string& key, const std::string& value, std::int64_t expires_at_ms = 0);
     bool applyReplicatedRemove(const std::string& key);
     // --- END ADD ---
 
     // --- Recovery Method ---
     // Static method to load state from WAL into a cache instance
     static bool loadFromWAL(const std::string& wal_filename, LRUCache& cache_instance);
+    // Parses the WAL and hands each well-formed record to apply, which
+    // returns whether it took effect. A missing file counts as empty.
+    static bool readWAL(const std::string& wal_filename, const std::function<bool(const WalRecord&)>& apply);
+    // Serialised WAL records, without the trailing newline writeLogEntry adds.
+    static std::string walPutRecord(const std::string& key, const std::string& value, std::int64_t expires_at_ms);
+    static std::string walRemoveRecord(const std::string& key);
+    static std::string walExpireRecord(const std::string& key, std::int64_t expires_at_ms);
 
     // --- Other Methods ---
+    std::size_t size() const; // Entries held, large objects included
     void print() const;
 
     // Disable copy/assignment
@@ -0,0 +1,37 @@
+// include/memcache_frontend.h
+#ifndef MEMCACHE_FRONTEND_H
+#define MEMCACHE_FRONTEND_H
+
+#include "epoll_server.h"
+#include "sharded_cache.h"
+#include <string>
+
+// Raw-TCP listener speaking the memcached text and binary protocols
+// (get/gets/set/cas/delete, multi-get, plus version/noop/quit) against the
+// server's cache, so existing memcached clients and load generators can
+// drive it without gRPC/HTTP2 framing. The protocol is detected per
+// connection from the first byte (0x80 = binary).
+// Client flags are not stored and are always returned as 0. Writes go
+// through the cache (and so the WAL); on_mutation lets the server replicate
+// them.
+class MemcacheFrontend : public EpollServer {
+public:
+    MemcacheFrontend(ShardedCache& cache, MutationHook on_mutation);
+    ~MemcacheFrontend() override;
+
+protected:
+    std::size_t onData(Connection& conn) override;
+
+private:
+    ShardedCache& cache_;
+    MutationHook on_mutation_;
+
+    std::size_t processText(Connection& conn);
+    std::size_t processBinary(Connection& conn);
+    // Handles one text command line; returns false if the data block of a
+    // storage command has not fully arrived yet.
+    bool handleTextCommand(Connection& conn, const std::string& line, std::size_t line_end,
+                           std::size_t& consumed);
+};
+
+#endif // MEMCACHE_FRONTEND_H
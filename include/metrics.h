@@ -0,0 +1,199 @@
+// include/metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class RequestTrace;
+
+// Process-wide event counters. Names are in metrics.cpp.
+enum class Metric : std::size_t {
+    // --- Cache (LRUCache shards and the shared segment) ---
+    CacheHits,
+    CacheMisses,
+    CachePuts,
+    CacheDeletes,
+    CacheEvictions,
+    CacheExpirations, // Entries dropped on access after their TTL or deadline
+    HotReplicaHits,   // Reads served from a per-core copy of a hot key (also counted as hits)
+    // --- WAL writer ---
+    WalRecords,
+    WalBytes,
+    WalFlushes,
+    WalErrors,
+    // --- Replication queue (primary only) ---
+    ReplicationEnqueued,
+    ReplicationSent,   // Operations acknowledged by a replica (one per replica)
+    ReplicationErrors, // Failed RPCs and operations a replica rejected
+    // --- Request tracing ---
+    TracesWritten,
+    TracesDropped,     // Sampled traces discarded because the writer fell behind
+    SlowOps,           // Ops recorded by the slow-op log
+    Count
+};
+
+constexpr std::size_t kMetricCount = static_cast<std::size_t>(Metric::Count);
+
+// --- Latency Histograms ---
+// Operations and the stages of each that are timed (see OpTimer).
+enum class LatencyOp : std::size_t { Get, Put, Delete, Count };
+enum class LatencyStage : std::size_t {
+    LockWait,        // Waiting to acquire the shard mutex
+    CriticalSection, // Holding it, WAL write included
+    WalWrite,        // Appending (and flushing) the WAL record
+    Total,           // Whole gRPC handler
+    Count
+};
+
+constexpr std::size_t kLatencyOpCount = static_cast<std::size_t>(LatencyOp::Count);
+constexpr std::size_t kLatencyStageCount = static_cast<std::size_t>(LatencyStage::Count);
+constexpr std::size_t kLatencySeriesCount = kLatencyOpCount * kLatencyStageCount;
+
+// Log-linear (HDR-style) buckets over nanoseconds: values below 16 get a
+// bucket each, then every power of two is split into 16 equal sub-buckets,
+// so a bucket is never wider than 1/16 of its lower bound. Values from
+// 2^36 ns (about 69 s) up share the last bucket.
+constexpr std::size_t kLatencySubBuckets = 16;
+constexpr unsigned kLatencyMaxExponent = 36;
+constexpr std::size_t kLatencyBuckets = (kLatencyMaxExponent - 3) * kLatencySubBuckets;
+
+// One series merged over all threads.
+struct HistogramSnapshot {
+    std::string op;    // "get", "put", "delete"
+    std::string stage; // "lock_wait", "critical_section", "wal_write", "total"
+    std::vector<std::uint64_t> buckets; // kLatencyBuckets counts
+    std::uint64_t count = 0;
+    std::uint64_t sum_ns = 0;
+
+    // Upper bound of the bucket holding the q-th quantile (0 < q <= 1),
+    // i.e. within 1/16 above the true value. 0 if empty.
+    std::uint64_t quantileNs(double q) const;
+};
+
+// Named values for the Stats RPC and the Prometheus endpoint. Gauges are
+// point-in-time values (entries, queue depth) supplied by their owner.
+struct MetricsSnapshot {
+    std::vector<std::pair<std::string, std::uint64_t>> counters;
+    std::vector<std::pair<std::string, std::int64_t>> gauges;
+    std::vector<HistogramSnapshot> histograms; // Only while latency tracking is on
+};
+
+// One thread's counters, aligned so no two threads share a cache line.
+struct alignas(64) MetricCounters {
+    std::atomic<std::uint64_t> values[kMetricCount] = {};
+};
+
+// One thread's latency histograms, allocated on its first recording.
+struct alignas(64) LatencyCounters {
+    std::atomic<std::uint64_t> buckets[kLatencySeriesCount][kLatencyBuckets] = {};
+    std::atomic<std::uint64_t> sum_ns[kLatencySeriesCount] = {};
+};
+
+// Counters cheap enough for the cache's hot paths. Every thread increments
+// its own MetricCounters block with a relaxed load and store (it is the only
+// writer, so no locked instruction and no contended line), and readers sum
+// the blocks of all threads on demand. A thread registers its block on its
+// first increment; when it exits, its counts are folded into a retired
+// total so nothing is lost. Latency histograms work the same way.
+class Metrics {
+public:
+    static void add(Metric metric, std::uint64_t amount = 1) {
+        MetricCounters* counters = local_ ? local_ : registerThread();
+        std::atomic<std::uint64_t>& slot = counters->values[static_cast<std::size_t>(metric)];
+        slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // --- Latency ---
+    // Off by default: timing costs a few clock reads per operation.
+    static void setLatencyTracking(bool enabled) { latency_enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool latencyTracking() { return latency_enabled_.load(std::memory_order_relaxed); }
+    static void recordLatency(LatencyOp op, LatencyStage stage, std::uint64_t ns);
+    static std::size_t latencyBucket(std::uint64_t ns);
+    static std::uint64_t latencyBucketLowerBound(std::size_t bucket);
+
+    // Sum over all threads, past and present.
+    static std::uint64_t read(Metric metric);
+    // Every counter under its name, and the latency histograms while
+    // tracking is on (gauges left empty).
+    static MetricsSnapshot snapshot();
+
+    static const char* name(Metric metric); // e.g. "hits"
+
+    // Prometheus text exposition format (version 0.0.4). Counters are named
+    // lru_cache_<name>_total, gauges lru_cache_<name>, and histograms
+    // lru_cache_op_latency_seconds{op,stage} with power-of-two buckets.
+    static std::string formatPrometheus(const MetricsSnapshot& snapshot);
+    // Nanoseconds as seconds, the base unit Prometheus expects.
+    static std::string formatSeconds(std::uint64_t ns);
+
+private:
+    struct ThreadRegistration; // Owns a thread's blocks until the thread exits
+    static thread_local MetricCounters* local_;
+    static thread_local LatencyCounters* local_latency_;
+    static std::atomic<bool> latency_enabled_;
+    static MetricCounters* registerThread();
+    static LatencyCounters* registerLatency();
+};
+
+// Times the stages of one operation on the calling thread while latency
+// tracking is on or the request is being traced (see RequestTrace), which
+// gets each stage as a span; otherwise does nothing. mark(stage) records the time
+// since construction or the previous mark. The innermost live timer is the
+// thread's current one, so code deeper in the call (the WAL writer) can
+// attribute its own stage to the operation being served. With
+// record_total, the destructor records the whole lifetime as Total.
+class OpTimer {
+public:
+    explicit OpTimer(LatencyOp op, bool record_total = false);
+    ~OpTimer();
+
+    void mark(LatencyStage stage);
+    // Records stage as the time since start (for stages nested in others).
+    void record(LatencyStage stage, std::chrono::steady_clock::time_point start);
+    bool active() const { return active_; }
+
+    static OpTimer* current() { return current_; }
+
+    OpTimer(const OpTimer&) = delete;
+    OpTimer& operator=(const OpTimer&) = delete;
+
+private:
+    LatencyOp op_;
+    bool latency_;
+    RequestTrace* trace_;
+    bool active_;
+    bool record_total_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_;
+    OpTimer* previous_ = nullptr;
+
+    static thread_local OpTimer* current_;
+};
+
+// Records the enclosing scope as one stage of the thread's current OpTimer;
+// does nothing outside a timed operation.
+class ScopedStage {
+public:
+    explicit ScopedStage(LatencyStage stage) : stage_(stage), timer_(OpTimer::current()) {
+        if (timer_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedStage() {
+        if (timer_) timer_->record(stage_, start_);
+    }
+
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+private:
+    LatencyStage stage_;
+    OpTimer* timer_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // METRICS_H
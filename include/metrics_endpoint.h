@@ -0,0 +1,24 @@
+// include/metrics_endpoint.h
+#ifndef METRICS_ENDPOINT_H
+#define METRICS_ENDPOINT_H
+
+#include "epoll_server.h"
+#include <functional>
+#include <string>
+
+// Minimal HTTP/1.x listener for Prometheus scrapes. GET /metrics answers
+// with the text produced by render (Prometheus exposition format); any
+// other path gets a 404. One request per connection, then it is closed.
+class MetricsEndpoint : public EpollServer {
+public:
+    explicit MetricsEndpoint(std::function<std::string()> render);
+    ~MetricsEndpoint() override;
+
+protected:
+    std::size_t onData(Connection& conn) override;
+
+private:
+    std::function<std::string()> render_;
+};
+
+#endif // METRICS_ENDPOINT_H
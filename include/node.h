@@ -4,23 +4,46 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
 #include <utility> // Needed for std::move
+#include <memory>
+#include "region_arena.h" // ArenaSpan
+#include "slab_allocator.h" // SlabRef
 
 // Node structure used by LRUCache
 struct Node {
-    std::string key;
-    std::string value;
+    std::string key;       // Whole key, or only the part after key_prefix
+    const std::string* key_prefix; // Interned prefix owned by the cache's key table, or nullptr
+    std::string value;     // Empty when the value lives in the arena, a slab or the large-object store
+    ArenaSpan value_span;  // Valid only when the value bytes live in the arena
+    SlabRef slab_ref;      // Valid only when the value bytes live in a slab chunk
+    std::shared_ptr<const std::string> shared_value; // Set for large-object and deduplicated values
     Node* prev;
     Node* next;
+    Node* class_prev;      // Per-slab-class LRU links (unused outside slab mode)
+    Node* class_next;
     std::chrono::steady_clock::time_point timestamp;
+    std::uint64_t cas;     // Version stamp, changes on every write (memcached CAS)
+    std::int64_t expires_at_ms; // Absolute expiry (Unix ms); 0 = cache-wide inactivity TTL
+    std::uint32_t raw_length;   // Uncompressed size when the stored value is compressed, 0 otherwise
+    bool large;                 // In the large-object store (and its LRU list)
+    bool deduplicated;          // shared_value is referenced through the cache's value table
 
     // Constructor DEFINED inline within the struct
     Node(std::string k, std::string v)
         : key(std::move(k)),
+          key_prefix(nullptr),
           value(std::move(v)),
           prev(nullptr),
           next(nullptr),
-          timestamp(std::chrono::steady_clock::now())
+          class_prev(nullptr),
+          class_next(nullptr),
+          timestamp(std::chrono::steady_clock::now()),
+          cas(0),
+          expires_at_ms(0),
+          raw_length(0),
+          large(false),
+          deduplicated(false)
     {} // Empty body is fine
 
     // Prevent copying/assignment
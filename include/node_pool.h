@@ -0,0 +1,44 @@
+// include/node_pool.h
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include "node.h"
+#include "page_mapper.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Fixed-size slot allocator for Node objects. Slots are carved from large
+// mappings (2 MB huge pages when requested), so hash probes and list walks
+// touch far fewer TLB entries than nodes scattered across the general heap.
+// Freed slots are recycled through an intrusive free list; extents are only
+// unmapped when the pool is destroyed.
+// Not thread-safe: used only under the cache mutex; nodes go back to the pool that made them.
+class NodePool {
+public:
+    explicit NodePool(const PageOptions& options, std::size_t extent_bytes = kHugePageBytes);
+    ~NodePool();
+
+    Node* create(const std::string& key);
+    void destroy(Node* node);
+
+    std::size_t mappedBytes() const { return mapped_bytes_; }
+    bool usesHugePages() const { return !extents_.empty() && extents_.front().huge; }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+private:
+    struct FreeSlot { FreeSlot* next; };
+    static constexpr std::size_t kSlotBytes =
+        (sizeof(Node) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+
+    PageOptions page_options_;
+    std::size_t extent_bytes_;
+    std::vector<MappedPages> extents_;
+    std::size_t extent_used_ = 0;
+    std::size_t mapped_bytes_ = 0;
+    FreeSlot* free_list_ = nullptr;
+};
+
+#endif // NODE_POOL_H
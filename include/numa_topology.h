@@ -0,0 +1,51 @@
+// include/numa_topology.h
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+// One NUMA node and the CPUs attached to it.
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+// Host NUMA layout read from /sys/devices/system/node. Hosts without that
+// tree (or non-NUMA kernels) are reported as a single node holding every
+// online CPU, so callers never need a special case.
+class NumaTopology {
+public:
+    static NumaTopology detect();
+
+    std::size_t nodeCount() const { return nodes_.size(); }
+    const std::vector<NumaNode>& nodes() const { return nodes_; }
+    // Node id of the node at position `index` (ids can be sparse).
+    int nodeId(std::size_t index) const { return nodes_[index % nodes_.size()].id; }
+    const NumaNode* findNode(int id) const;
+
+private:
+    std::vector<NumaNode> nodes_;
+};
+
+// Asks the kernel to place [addr, addr+len) on `node` (preferred, so the
+// allocation still succeeds if the node is full). Must be called before
+// the pages are first touched.
+bool bindMemoryToNode(void* addr, std::size_t len, int node);
+
+// Sets a preferred-node memory policy for the calling thread and restores
+// the default policy on destruction. Heap memory first touched inside the
+// scope (e.g. a shard's index and sentinel nodes) lands on that node.
+class ScopedMemoryPolicy {
+public:
+    explicit ScopedMemoryPolicy(int node);
+    ~ScopedMemoryPolicy();
+
+    ScopedMemoryPolicy(const ScopedMemoryPolicy&) = delete;
+    ScopedMemoryPolicy& operator=(const ScopedMemoryPolicy&) = delete;
+
+private:
+    bool active_ = false;
+};
+
+#endif // NUMA_TOPOLOGY_H
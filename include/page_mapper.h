@@ -0,0 +1,31 @@
+// include/page_mapper.h
+#ifndef PAGE_MAPPER_H
+#define PAGE_MAPPER_H
+
+#include <cstddef>
+
+// Anonymous memory mapping shared by the cache's arenas (value regions,
+// slab pages, node pool).
+struct MappedPages {
+    char* base = nullptr;    // nullptr if the mapping failed
+    std::size_t bytes = 0;   // Actual mapped length (rounded up for huge pages)
+    bool huge = false;       // Backed by explicit hugetlb pages
+};
+
+// How a cache arena wants its memory mapped.
+struct PageOptions {
+    bool huge_pages = false; // Back with 2 MB pages
+    int numa_node = -1;      // Preferred NUMA node, -1 for the default policy
+};
+
+constexpr std::size_t kHugePageBytes = 2 * 1024 * 1024;
+
+// Maps at least `bytes` of zeroed memory. With huge_pages set, first tries
+// MAP_HUGETLB 2 MB pages (needs vm.nr_hugepages reserved) and otherwise
+// falls back to a normal 2 MB-aligned mapping advised with MADV_HUGEPAGE so
+// transparent huge pages can back it. With numa_node set, the range is bound to that
+// node before it is first touched.
+MappedPages mapPages(std::size_t bytes, const PageOptions& options);
+void unmapPages(const MappedPages& pages);
+
+#endif // PAGE_MAPPER_H
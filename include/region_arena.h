@@ -0,0 +1,78 @@
+// include/region_arena.h
+#ifndef REGION_ARENA_H
+#define REGION_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "page_mapper.h"
+
+// Location of a byte range stored inside a RegionArena.
+struct ArenaSpan {
+    static constexpr std::uint32_t kNoRegion = UINT32_MAX;
+
+    std::uint32_t region = kNoRegion;
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+
+    bool valid() const { return region != kNoRegion; }
+};
+
+// Bump allocator that packs variable-size byte strings into large mmap'd
+// regions instead of individual heap blocks. Freed bytes are only counted,
+// never reused in place; a compactor (see LRUCache::compactArena) relocates
+// the live spans out of sparse regions so whole regions can be unmapped and
+// handed back to the OS.
+// Not thread-safe: used only under the cache mutex, compactor included; data() is valid while held.
+class RegionArena {
+public:
+    // options control huge page backing and NUMA placement (see mapPages).
+    explicit RegionArena(std::size_t region_bytes, const PageOptions& options = PageOptions{});
+    ~RegionArena();
+
+    // Copies `len` bytes into the arena. Returns an invalid span if the
+    // backing memory could not be mapped.
+    ArenaSpan allocate(const char* data, std::size_t len);
+    void release(const ArenaSpan& span);
+
+    const char* data(const ArenaSpan& span) const;
+    std::string read(const ArenaSpan& span) const;
+
+    // --- Compaction Support ---
+    // Flags sealed regions whose live/used ratio is at or below
+    // max_live_ratio for evacuation. The region currently receiving
+    // allocations is never flagged. Returns the number of flagged regions.
+    std::size_t markSparseRegions(double max_live_ratio);
+    bool isSparse(std::uint32_t region) const;
+    // Unmaps every sealed region without live bytes. Returns bytes released.
+    std::size_t releaseEmptyRegions();
+
+    // --- Stats ---
+    std::size_t regionCount() const;
+    std::size_t mappedBytes() const { return mapped_bytes_; }
+    std::size_t liveBytes() const { return live_bytes_; }
+
+    RegionArena(const RegionArena&) = delete;
+    RegionArena& operator=(const RegionArena&) = delete;
+
+private:
+    struct Region {
+        MappedPages pages;         // pages.base is nullptr once unmapped (slot can be reused)
+        std::size_t used = 0;      // bump pointer
+        std::size_t live = 0;      // bytes still referenced
+        bool sparse = false;       // flagged by markSparseRegions()
+    };
+
+    std::size_t region_bytes_;
+    PageOptions page_options_;
+    std::vector<Region> regions_;
+    std::vector<std::uint32_t> free_slots_;
+    std::uint32_t active_ = ArenaSpan::kNoRegion;
+    std::size_t mapped_bytes_ = 0;
+    std::size_t live_bytes_ = 0;
+
+    std::uint32_t openRegion(std::size_t min_bytes);
+};
+
+#endif // REGION_ARENA_H
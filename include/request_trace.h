@@ -0,0 +1,134 @@
+// include/request_trace.h
+#ifndef REQUEST_TRACE_H
+#define REQUEST_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Settings for request tracing (see RequestTracer::start).
+struct TraceConfig {
+    std::string path;                            // Current file; rotated files are path.1, path.2, ...
+    std::uint32_t sample_rate = 1000;            // Trace 1 in N requests of each thread
+    std::chrono::microseconds min_duration{0};   // Drop sampled traces shorter than this
+    std::size_t max_file_bytes = 64 << 20;       // Rotate once the current file reaches this size
+    std::size_t max_files = 3;                   // Rotated files kept besides the current one
+};
+
+// One timed step of a traced request. Names are string literals.
+struct TraceSpan {
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+// Trace of the request the calling thread is serving, when it is sampled
+// or the slow-op log is on; otherwise every call is a no-op. While it lives
+// it is the thread's current trace, so the layers below (ShardedCache
+// routing, OpTimer stages, the WAL writer) add their spans to it without
+// being passed anything. Spans and arguments go to fixed arrays, so a trace
+// that ends up discarded costs its clock reads and no allocation. On
+// destruction a request over the slow-op threshold is recorded in the
+// SlowOpLog, and a sampled one is handed to the RequestTracer's writer
+// thread, which does all formatting and file I/O. key must outlive the trace.
+class RequestTrace {
+public:
+    static constexpr std::size_t kMaxSpans = 16; // Further spans are dropped
+    static constexpr std::size_t kMaxArgs = 6;
+
+    RequestTrace(const char* name, const std::string& key);
+    RequestTrace(const char* name, std::string&& key) = delete; // Would dangle
+    ~RequestTrace();
+
+    bool active() const { return active_; }
+    // Records name as the time since the previous mark (or the start).
+    void mark(const char* name) {
+        if (active_) markSlow(name);
+    }
+    void addSpan(const char* name, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end);
+    // Adds a numeric argument to the request's span (shard, value bytes, ...).
+    void annotate(const char* name, std::int64_t value) {
+        if (active_ && arg_count_ < kMaxArgs) args_[arg_count_++] = {name, value};
+    }
+
+    // --- Recorded Data (for the slow-op log) ---
+    const char* name() const { return name_; }
+    const std::string& key() const { return *key_; }
+    std::size_t spanCount() const { return span_count_; }
+    const TraceSpan& span(std::size_t index) const { return spans_[index]; }
+    // Value of the last annotation called name, or fallback.
+    std::int64_t arg(const char* name, std::int64_t fallback) const;
+
+    static RequestTrace* current() { return current_; }
+
+    RequestTrace(const RequestTrace&) = delete;
+    RequestTrace& operator=(const RequestTrace&) = delete;
+
+private:
+    bool active_ = false;
+    bool sampled_ = false; // Goes to the trace file (if long enough)
+    const char* name_;
+    const std::string* key_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_;
+    std::array<TraceSpan, kMaxSpans> spans_;
+    std::size_t span_count_ = 0;
+    std::array<std::pair<const char*, std::int64_t>, kMaxArgs> args_;
+    std::size_t arg_count_ = 0;
+
+    static thread_local RequestTrace* current_;
+
+    void markSlow(const char* name);
+};
+
+// Records the enclosing scope as a span of the thread's current trace;
+// does nothing outside a traced request.
+class ScopedSpan {
+public:
+    explicit ScopedSpan(const char* name) : name_(name), trace_(RequestTrace::current()) {
+        if (trace_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedSpan() {
+        if (trace_) trace_->addSpan(name_, start_, std::chrono::steady_clock::now());
+    }
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+private:
+    const char* name_;
+    RequestTrace* trace_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Process-wide switch and writer for request traces. Finished traces are
+// queued (up to a bound; excess ones are counted as traces_dropped) and
+// written by one background thread as Chrome trace events (JSON array
+// format, complete "X" events nested by time), which chrome://tracing and
+// the Perfetto UI load directly. The file is rotated by size.
+class RequestTracer {
+public:
+    // Moves an existing trace file aside, opens a new one and starts the
+    // writer. False if the file cannot be opened or tracing is running.
+    static bool start(const TraceConfig& config);
+    // Writes the queued traces and closes the file.
+    static void stop();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+private:
+    friend class RequestTrace;
+    static std::atomic<bool> enabled_;
+    static std::atomic<std::uint32_t> sample_rate_;
+    static std::atomic<std::int64_t> min_duration_ns_;
+
+    static bool sampleThisRequest();
+};
+
+#endif // REQUEST_TRACE_H
@@ -0,0 +1,44 @@
+// include/resp_frontend.h
+#ifndef RESP_FRONTEND_H
+#define RESP_FRONTEND_H
+
+#include "epoll_server.h"
+#include "sharded_cache.h"
+#include <string>
+#include <vector>
+
+// Raw-TCP listener speaking the Redis protocol (RESP2, or RESP3 after
+// HELLO 3) for GET, SET (EX/PX/EXAT/PXAT), DEL, MGET, MSET, INCR/DECR(BY)
+// and EXPIRE, plus PING/ECHO/HELLO/QUIT. Everything a client has pipelined
+// is parsed in one pass and executed as a single batch, so each shard's lock
+// is taken once per batch rather than once per command. MSET is not atomic
+// across shards.
+class RespFrontend : public EpollServer {
+public:
+    RespFrontend(ShardedCache& cache, MutationHook on_mutation);
+    ~RespFrontend() override;
+
+protected:
+    std::size_t onData(Connection& conn) override;
+
+private:
+    // A parsed command and the slice of the batch's ops it owns.
+    struct Command {
+        std::vector<std::string> args;
+        std::string name;        // Upper-cased args[0]
+        std::string error;       // Set when the command was rejected before execution
+        std::size_t first_op = 0;
+        std::size_t op_count = 0;
+    };
+
+    ShardedCache& cache_;
+    MutationHook on_mutation_;
+
+    // Validates a command and appends the cache ops it needs (none for
+    // PING/HELLO/...). Rejected commands get command.error instead.
+    void planCommand(Command& command, std::vector<CacheOp>& ops) const;
+    void writeReply(Connection& conn, const Command& command, const std::vector<CacheOp>& ops) const;
+    void notifyMutations(const std::vector<CacheOp>& ops) const;
+};
+
+#endif // RESP_FRONTEND_H
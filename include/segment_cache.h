@@ -0,0 +1,134 @@
+// include/segment_cache.h
+#ifndef SEGMENT_CACHE_H
+#define SEGMENT_CACHE_H
+
+#include "lru_cache.h" // CacheEntry, CasResult, CacheOp
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// An LRU cache whose index, list and value storage all live in one named
+// shared-memory segment (shm_open + mmap), so several processes on a host
+// can read and write the same cache without any IPC round trip.
+//
+// Nothing inside the segment holds a raw pointer: entries, hash chains and
+// list links are byte offsets from the segment base, which differs between
+// processes. Each entry (header, key and value) occupies one power-of-two
+// block from a buddy allocator over the rest of the segment. A robust,
+// process-shared mutex in the segment header serialises all access; if a
+// process dies while holding it, the next locker resets the segment to
+// empty rather than trusting half-applied updates.
+//
+// The same layout can also be mapped from a regular file (openFile), so a
+// restarted server picks up its cache without replaying the WAL.
+class SegmentCache {
+public:
+    // Attaches to segment `name` (e.g. "/lru_cache"), creating and
+    // formatting it with `bytes`, `capacity` entries and the inactivity TTL
+    // if it does not exist yet. An existing segment keeps its own layout.
+    // Returns nullptr on failure.
+    static std::unique_ptr<SegmentCache> openShared(const std::string& name, std::size_t bytes,
+                                                    std::size_t capacity, int ttl_seconds);
+    // Removes the segment name; attached processes keep their mapping.
+    static bool unlinkShared(const std::string& name);
+
+    // --- Persistent Mode ---
+    // Maps the segment from a file instead, for a single owning process.
+    // If the previous owner closed it cleanly, the cache is reused as is,
+    // with no parsing (*restored = true). Otherwise (first start, crash,
+    // different layout) it is formatted empty, and the caller recovers
+    // from the WAL. Destroying the SegmentCache syncs the file and marks it
+    // clean.
+    static std::unique_ptr<SegmentCache> openFile(const std::string& path, std::size_t bytes,
+                                                  std::size_t capacity, int ttl_seconds, bool* restored);
+
+    ~SegmentCache();
+
+    // --- Public API (same semantics as LRUCache) ---
+    std::optional<std::string> get(const std::string& key);
+    // False if the entry cannot fit into the segment even after evicting,
+    // which also sets too_large (optional).
+    bool put(const std::string& key, const std::string& value, std::int64_t expires_at_ms = 0,
+             bool* too_large = nullptr, std::uint64_t* cas = nullptr);
+    bool remove(const std::string& key, bool* existed = nullptr);
+    std::optional<CacheEntry> getWithCas(const std::string& key);
+    CasResult compareAndSwap(const std::string& key, const std::string& value, std::uint64_t expected_cas,
+                             std::int64_t expires_at_ms = 0, std::uint64_t* new_cas = nullptr);
+    // Applies ops in order under a single lock acquisition.
+    void applyBatch(const std::vector<CacheOp*>& ops);
+
+    // --- WAL (same record format as LRUCache) ---
+    void setWalStream(std::ofstream* stream);
+    bool loadFromWAL(const std::string& wal_filename);
+
+    // --- Stats ---
+    std::size_t size();
+    std::size_t capacity() const;
+    std::size_t segmentBytes() const { return bytes_; }
+    std::size_t bytesInUse();
+
+    void print();
+
+    SegmentCache(const SegmentCache&) = delete;
+    SegmentCache& operator=(const SegmentCache&) = delete;
+
+private:
+    struct Header;
+    struct Entry;
+    class Guard;
+
+    char* base_ = nullptr;
+    std::size_t bytes_ = 0;
+    Header* header_ = nullptr;
+    int file_fd_ = -1; // Persistent mode: holds the flock until destruction
+    std::ofstream* wal_stream_ = nullptr;
+    bool defer_wal_flush_ = false; // Set by applyBatch: one flush per batch
+
+    SegmentCache(char* base, std::size_t bytes, int file_fd);
+    bool writeLogEntry(const std::string& entry); // Assumes lock is held
+
+    // --- Offset Helpers ---
+    Entry* entryAt(std::uint64_t offset) const;
+    std::uint64_t offsetOf(const Entry* entry) const;
+    std::uint64_t* bucketFor(std::uint64_t hash) const;
+    // LRUCache::hashKey (FNV-1a): unlike std::hash, stable across processes
+    // built by different toolchains
+    static std::uint64_t hashKey(const std::string& key) { return LRUCache::hashKey(key); }
+
+    // --- Segment Layout ---
+    static void format(char* base, std::size_t bytes, std::size_t capacity, int ttl_seconds);
+    void resetLocked(); // Drops every entry (after a lock owner died mid-update)
+
+    // --- Block Allocation (assume lock is held) ---
+    // Size class of the block an entry needs; false if no block of this
+    // segment is large enough. Reads only the fixed layout, so it is also
+    // used before locking.
+    bool blockClassFor(const std::string& key, const std::string& value, std::uint32_t* size_class) const;
+    std::uint64_t allocateBlock(std::uint32_t size_class);
+    void freeBlock(std::uint64_t offset, std::uint32_t size_class);
+    void pushFree(std::uint64_t offset, std::uint32_t size_class);
+    void unlinkFree(std::uint64_t offset, std::uint32_t size_class);
+
+    // --- Internal methods (assume lock is held) ---
+    Entry* findLocked(const std::string& key, std::uint64_t hash);
+    Entry* findLive(const std::string& key); // Drops the entry if expired
+    bool isExpired(const Entry* entry) const;
+    void linkHead(Entry* entry);
+    void unlinkList(Entry* entry);
+    void unlinkBucket(Entry* entry);
+    void removeEntry(Entry* entry);
+    void touch(Entry* entry);
+    std::string valueOf(const Entry* entry) const;
+    // is_recovery skips the WAL, as in LRUCache
+    bool putLocked(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                   bool is_recovery, std::uint64_t* cas = nullptr);
+    bool removeLocked(const std::string& key, bool is_recovery, bool* existed);
+    CacheOp::Status expireLocked(const std::string& key, std::int64_t expires_at_ms, bool is_recovery);
+    void applyOp(CacheOp& op);
+};
+
+#endif // SEGMENT_CACHE_H
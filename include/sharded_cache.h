@@ -0,0 +1,128 @@
+// include/sharded_cache.h
+#ifndef SHARDED_CACHE_H
+#define SHARDED_CACHE_H
+
+#include "lru_cache.h"
+#include "numa_topology.h"
+#include "core_runtime.h"
+#include "segment_cache.h"
+#include "request_trace.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <optional>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+// Called by the non-gRPC front-ends after every successful write so the
+// server can replicate it: (is_put, key, value, expires_at_ms).
+using MutationHook = std::function<void(bool, const std::string&, const std::string&, std::int64_t)>;
+
+// Splits the key space over independent LRUCache shards, each with its own
+// lock, WAL segment and (optionally) NUMA node. Capacity is divided evenly,
+// so LRU order and eviction are per shard.
+class ShardedCache {
+public:
+    // With a topology, shard i and its mappings are placed on node i % nodes.
+    ShardedCache(std::size_t shard_count, std::size_t capacity, int ttl,
+                 const NumaTopology* numa = nullptr);
+    ~ShardedCache();
+
+    std::size_t shardCount() const { return shards_.size(); }
+    std::size_t shardIndex(const std::string& key) const;
+    LRUCache& shard(std::size_t index) { return *shards_[index]; }
+    LRUCache& shardFor(const std::string& key) { return *shards_[shardIndex(key)]; }
+    void forEachShard(const std::function<void(LRUCache&)>& fn);
+
+    // --- Thread-per-core Mode ---
+    // Gives every shard its own pinned core thread (shard i on cpus[i]).
+    // From then on only that thread runs operations on the shard; callers
+    // forward work to it over SPSC rings instead of contending on the
+    // shard's lock. Start after WAL recovery, before serving traffic.
+    void startThreadPerCore(const std::vector<int>& cpus);
+    bool threadPerCore() const { return runtime_ != nullptr; }
+
+    // --- Segment Mode ---
+    // Serves every operation from a SegmentCache (shared with other processes
+    // or persisted in a file) instead of from the shards. The shards and
+    // thread-per-core mode are then unused, and the WAL is a single file.
+    // Attach before WAL recovery and before serving traffic.
+    void attachSegment(std::unique_ptr<SegmentCache> segment);
+    bool segmentMode() const { return segment_ != nullptr; }
+
+    // --- Public API (routed to the owning shard) ---
+    std::optional<std::string> get(const std::string& key);
+    // Zero-copy for large objects (see LRUCache::getShared).
+    std::shared_ptr<const std::string> getShared(const std::string& key);
+    // too_large and cas (optional): see LRUCache::put.
+    bool put(const std::string& key, const std::string& value, std::int64_t expires_at_ms = 0,
+             bool* too_large = nullptr, std::uint64_t* cas = nullptr);
+    bool remove(const std::string& key, bool* existed = nullptr);
+    std::optional<CacheEntry> getWithCas(const std::string& key);
+    CasResult compareAndSwap(const std::string& key, const std::string& value, std::uint64_t expected_cas,
+                             std::int64_t expires_at_ms = 0, std::uint64_t* new_cas = nullptr);
+    bool applyReplicatedPut(const std::string& key, const std::string& value, std::int64_t expires_at_ms = 0);
+    bool applyReplicatedRemove(const std::string& key);
+
+    // --- Batched Access (pipelined front-ends) ---
+    // Groups ops by owning shard and applies each group with one shard lock
+    // acquisition (one hop to the owning core in thread-per-core mode).
+    // Ops on the same key keep their order; ops on different shards are not
+    // atomic with respect to each other.
+    void executeBatch(std::vector<CacheOp>& ops);
+
+    // --- WAL (one segment per shard) ---
+    // A single shard (or a segment) uses wal_file itself; otherwise shard i
+    // uses "<wal_file>.<i>". Keep shard_count fixed for a given WAL.
+    static std::string walSegmentPath(const std::string& wal_file, std::size_t index,
+                                      std::size_t shard_count);
+    bool loadFromWAL(const std::string& wal_file);
+    // Opens every segment for appending and attaches it to its shard.
+    bool openWal(const std::string& wal_file);
+
+    std::size_t size(); // Entries across all shards (or in the segment)
+    // Hottest keys over all shards (see LRUCache::enableHotKeys); empty in
+    // segment mode.
+    std::vector<HotKeyEstimate> hotKeys(std::size_t limit);
+    std::uint32_t hotKeySampleRate() const; // 0 when detection is off
+
+    // --- Hot-key Replication ---
+    // Lets every shard promote the keys its sketch rates at min_rate ops/s
+    // or more (at most max_keys_per_shard) to per-core read-only copies,
+    // re-evaluated every interval (see LRUCache::startHotKeyReplication).
+    // get and getShared then serve them from the calling CPU's copy, so the
+    // reads of one hot key no longer all queue on its shard's lock. Needs
+    // hot-key detection on every shard; start after WAL recovery.
+    bool enableHotKeyReplication(std::chrono::seconds interval, double min_rate, std::size_t max_keys_per_shard);
+    std::size_t hotKeysReplicated() const; // Keys currently promoted
+    void print() const;
+
+    ShardedCache(const ShardedCache&) = delete;
+    ShardedCache& operator=(const ShardedCache&) = delete;
+
+private:
+    std::vector<std::unique_ptr<std::ofstream>> wal_streams_; // Declared first: outlives the shards
+    std::unique_ptr<HotKeyReplicas> hot_replicas_;            // Outlives the shards' promoter threads
+    std::vector<std::unique_ptr<LRUCache>> shards_;
+    std::unique_ptr<SegmentCache> segment_;
+    std::unique_ptr<CoreRuntime> runtime_; // Declared last: stops before the shards go away
+
+    bool getReplicated(const std::string& key, std::shared_ptr<const std::string>* value);
+
+    // Runs fn on the shard owning key, on that shard's core when one exists.
+    template <typename Fn>
+    auto route(const std::string& key, Fn&& fn) -> decltype(fn(std::declval<LRUCache&>())) {
+        std::size_t index = shardIndex(key);
+        LRUCache& owner = *shards_[index];
+        ScopedSpan span("shard_lookup"); // Includes the hop to the shard's core
+        if (RequestTrace* trace = RequestTrace::current()) trace->annotate("shard", static_cast<std::int64_t>(index));
+        if (runtime_) {
+            return runtime_->execute(index, [&] { return fn(owner); });
+        }
+        return fn(owner);
+    }
+};
+
+#endif // SHARDED_CACHE_H
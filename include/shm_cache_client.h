@@ -0,0 +1,54 @@
+// include/shm_cache_client.h
+#ifndef SHM_CACHE_CLIENT_H
+#define SHM_CACHE_CLIENT_H
+
+#include "shm_ring.h"
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// Client for ShmTransportServer, for processes on the same host as the
+// cache server. Requests and replies travel through shared-memory rings;
+// while waiting for a reply the caller spins for `spin` before sleeping on
+// an eventfd, so round trips stay in the low microseconds under load.
+// Calls are synchronous and serialised; use one client per thread for
+// parallelism.
+class ShmCacheClient {
+public:
+    explicit ShmCacheClient(std::chrono::microseconds spin = std::chrono::microseconds(200));
+    ~ShmCacheClient();
+
+    // Connects to the server's Unix socket and maps the shared rings.
+    bool connect(const std::string& socket_path);
+    void close();
+    bool connected() const { return base_ != nullptr; }
+
+    std::optional<std::string> get(const std::string& key);
+    bool put(const std::string& key, const std::string& value);
+    // existed (optional) reports whether the key was present.
+    bool remove(const std::string& key, bool* existed = nullptr);
+
+    ShmCacheClient(const ShmCacheClient&) = delete;
+    ShmCacheClient& operator=(const ShmCacheClient&) = delete;
+
+private:
+    std::chrono::microseconds spin_;
+    std::mutex mtx_;
+    int socket_fd_ = -1;
+    int request_fd_ = -1;
+    int response_fd_ = -1;
+    void* base_ = nullptr;
+    std::size_t bytes_ = 0;
+    ShmRing requests_;
+    ShmRing responses_;
+    std::string request_;  // Reused buffers
+    std::string response_;
+
+    // Sends one request and waits for its reply. False if the server is gone
+    // or the request does not fit into a ring.
+    bool call(shm_protocol::Op op, const std::string& key, const std::string& value);
+};
+
+#endif // SHM_CACHE_CLIENT_H
@@ -0,0 +1,72 @@
+// include/shm_ring.h
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Control block at the start of each ring's slice of a shared segment.
+// Positions only grow; the byte offset is position % capacity.
+struct ShmRingControl {
+    alignas(64) std::atomic<std::uint64_t> head{0};             // Next byte the consumer reads
+    alignas(64) std::atomic<std::uint64_t> tail{0};             // Next byte the producer writes
+    alignas(64) std::atomic<std::uint32_t> consumer_waiting{0}; // Consumer is blocked on the eventfd
+};
+
+// Single-producer/single-consumer ring of length-prefixed messages living in
+// memory shared by two processes. An empty ring makes the consumer spin for
+// a short window and then sleep on an eventfd. The producer only writes the
+// eventfd once the consumer has announced that it sleeps, so a busy pair
+// exchanges messages without any system call.
+class ShmRing {
+public:
+    ShmRing() = default;
+    // base points at footprint(capacity) bytes of shared memory; event_fd is
+    // the consumer's wakeup eventfd (the same eventfd in both processes).
+    ShmRing(void* base, std::size_t capacity, int event_fd);
+
+    // Bytes of shared memory one ring with `capacity` data bytes occupies.
+    static std::size_t footprint(std::size_t capacity);
+    // Constructs the control block in fresh memory (creating side only).
+    static void initialize(void* base);
+
+    // --- Producer Side ---
+    // Appends one message and wakes a sleeping consumer. Returns false if it
+    // does not fit into the free space right now.
+    bool tryWrite(const char* data, std::size_t len);
+    std::size_t maxMessage() const { return capacity_ - sizeof(std::uint32_t); }
+
+    // --- Consumer Side ---
+    // False if the ring is empty, or if the positions or length prefix the
+    // peer wrote are inconsistent; the latter sets *corrupt (optional) and
+    // leaves the ring untouched, since it can never be read safely again.
+    bool tryRead(std::string& message, bool* corrupt = nullptr);
+    // Waits for a message: spins for `spin`, then blocks on the eventfd.
+    // Returns false without a message if hangup_fd (optional) reports a
+    // hangup, or once *stop (optional) is set and the eventfd is written.
+    bool waitReadable(std::chrono::nanoseconds spin, int hangup_fd = -1,
+                      const std::atomic<bool>* stop = nullptr);
+
+private:
+    ShmRingControl* control_ = nullptr;
+    char* data_ = nullptr;
+    std::size_t capacity_ = 0;
+    int event_fd_ = -1;
+
+    bool empty() const;
+    void copyIn(std::uint64_t position, const char* src, std::size_t len);
+    void copyOut(std::uint64_t position, char* dst, std::size_t len) const;
+};
+
+// --- Wire Format (shared-memory cache transport) ---
+// Request:  [u8 op][u32 key length][key][value]   (value only for Put)
+// Response: [u8 status][value]                     (value only for Get hits)
+namespace shm_protocol {
+enum Op : std::uint8_t { kGet = 1, kPut = 2, kDelete = 3 };
+enum Status : std::uint8_t { kOk = 0, kNotFound = 1, kError = 2 };
+} // namespace shm_protocol
+
+#endif // SHM_RING_H
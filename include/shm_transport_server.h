@@ -0,0 +1,66 @@
+// include/shm_transport_server.h
+#ifndef SHM_TRANSPORT_SERVER_H
+#define SHM_TRANSPORT_SERVER_H
+
+#include "sharded_cache.h"
+#include "shm_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Serves Get/Put/Delete to processes on the same host over shared memory.
+// A client connects to a Unix socket and receives (via SCM_RIGHTS) a memfd
+// holding a request ring and a response ring, plus one eventfd per ring.
+// From then on requests never touch the socket: a dedicated server thread
+// polls the request ring, spinning for `spin` before sleeping on the
+// eventfd. The socket stays open only so either side notices the other
+// going away. See ShmCacheClient for the client side.
+class ShmTransportServer {
+public:
+    ShmTransportServer(ShardedCache& cache, MutationHook on_mutation, std::size_t ring_bytes = 1 << 20,
+                       std::chrono::microseconds spin = std::chrono::microseconds(50));
+    ~ShmTransportServer();
+
+    // Binds the Unix socket clients connect to. Returns false on failure.
+    bool start(const std::string& socket_path);
+    void stop();
+
+    ShmTransportServer(const ShmTransportServer&) = delete;
+    ShmTransportServer& operator=(const ShmTransportServer&) = delete;
+
+private:
+    struct Session {
+        int socket_fd = -1;
+        int request_fd = -1;  // eventfd: client -> server
+        int response_fd = -1; // eventfd: server -> client
+        void* base = nullptr;
+        std::size_t bytes = 0;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+    };
+
+    ShardedCache& cache_;
+    MutationHook on_mutation_;
+    std::size_t ring_bytes_;
+    std::chrono::microseconds spin_;
+    std::string socket_path_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1; // Interrupts the accept loop on stop() and when a session ends
+    std::thread accept_thread_;
+    std::atomic<bool> stopping_{false};
+    std::mutex sessions_mtx_;
+    std::list<std::unique_ptr<Session>> sessions_;
+
+    void acceptLoop();
+    bool openSession(int client_fd);
+    void serve(Session& session);
+    void handleRequest(const std::string& request, std::string& response);
+    static void closeSession(Session& session);
+};
+
+#endif // SHM_TRANSPORT_SERVER_H
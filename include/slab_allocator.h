@@ -0,0 +1,115 @@
+// include/slab_allocator.h
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "page_mapper.h"
+
+// Location of a value stored in a SlabAllocator chunk.
+struct SlabRef {
+    static constexpr std::uint16_t kNoClass = UINT16_MAX;
+
+    std::uint16_t cls = kNoClass;
+    std::uint32_t page = 0;
+    std::uint32_t chunk = 0;
+    std::uint32_t length = 0;
+
+    bool valid() const { return cls != kNoClass; }
+};
+
+// memcached-style slab allocator: fixed-size pages are carved into equal
+// chunks, one chunk size per class, with chunk sizes growing by a constant
+// factor. Allocation and release are O(1): each page keeps its own free
+// list and each class links the pages that still have a free chunk. Pages are
+// only ever handed out up to the memory limit; afterwards a class must make
+// room by evicting its own LRU tail, or get a page moved over from another
+// class (by the rebalancer, see LRUCache::rebalanceSlabs, or right away if
+// the class has nothing to evict, see LRUCache::storeInSlab).
+// Not thread-safe: used only under the cache mutex, rebalancer thread included.
+class SlabAllocator {
+public:
+    // With options.huge_pages, slab pages are carved out of 2 MB-page-backed
+    // extents; options.numa_node places the extents on one node.
+    SlabAllocator(std::size_t page_bytes, std::size_t memory_limit_bytes,
+                  double growth_factor, const PageOptions& options = PageOptions{},
+                  std::size_t min_chunk_bytes = 64);
+    ~SlabAllocator();
+
+    // Class whose chunks fit len bytes, or kNoClass if len exceeds a page.
+    std::uint16_t classFor(std::size_t len) const;
+
+    // Copies the bytes into a chunk of the matching class and records owner
+    // against the chunk. Returns an invalid ref when the class has no free
+    // chunk and no page can be added.
+    SlabRef allocate(const char* data, std::size_t len, void* owner = nullptr);
+    void release(const SlabRef& ref);
+
+    const char* data(const SlabRef& ref) const;
+    std::string read(const SlabRef& ref) const;
+
+    // --- Rebalancing Support ---
+    // Page of cls with the fewest chunks in use (cheapest to evacuate), or
+    // UINT32_MAX if the class owns no pages. O(pages); meant for the rebalancer.
+    std::uint32_t leastUsedPage(std::uint16_t cls) const;
+    // A page of cls with a free chunk, or UINT32_MAX. O(1). When the class has
+    // no chunks in use, the page is empty and can be moved as is.
+    std::uint32_t partialPage(std::uint16_t cls) const { return classes_[cls].partial_head; }
+    // Chunks per page of cls, and the owner passed to allocate() for a chunk
+    // of a page (nullptr if the chunk is free). Evacuating a page walks these.
+    std::uint32_t chunksPerPage(std::uint16_t cls) const { return classes_[cls].chunks_per_page; }
+    void* owner(std::uint32_t page, std::uint32_t chunk) const { return pages_[page].owners[chunk]; }
+    // Reassigns an empty page to another class in O(chunks per page). Fails
+    // if chunks are in use.
+    bool movePage(std::uint32_t page, std::uint16_t to_cls);
+
+    // --- Stats ---
+    std::size_t classCount() const { return classes_.size(); }
+    std::size_t chunkSize(std::uint16_t cls) const { return classes_[cls].chunk_size; }
+    std::size_t pageCount(std::uint16_t cls) const { return classes_[cls].pages; }
+    std::size_t usedChunks(std::uint16_t cls) const { return classes_[cls].used_chunks; }
+    std::size_t mappedBytes() const { return pages_.size() * page_bytes_; }
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+private:
+    static constexpr std::uint32_t kNoPage = UINT32_MAX;
+
+    struct Page {
+        char* base = nullptr;
+        std::uint16_t cls = SlabRef::kNoClass;
+        std::uint32_t used_chunks = 0;
+        std::uint32_t carved = 0;                // Chunks below this were handed out since assignPage
+        std::vector<std::uint32_t> free_chunks;  // Released chunks below carved
+        std::vector<void*> owners;               // Per chunk, from allocate()
+        std::uint32_t prev_partial = kNoPage;    // Class list of pages with a free chunk
+        std::uint32_t next_partial = kNoPage;
+    };
+    struct SlabClass {
+        std::size_t chunk_size = 0;
+        std::uint32_t chunks_per_page = 0;
+        std::size_t pages = 0;
+        std::size_t used_chunks = 0;
+        std::uint32_t partial_head = kNoPage;
+    };
+
+    std::size_t page_bytes_;
+    std::size_t max_pages_;
+    PageOptions page_options_;
+    std::vector<SlabClass> classes_;
+    std::vector<Page> pages_;
+    // Pages are carved from larger extents so huge-page mappings are not
+    // wasted on page sizes below 2 MB. Slab pages are never unmapped.
+    std::vector<MappedPages> extents_;
+    std::size_t extent_used_ = 0;
+
+    bool addPage(std::uint16_t cls);
+    void assignPage(std::uint32_t page, std::uint16_t cls);
+    void linkPartial(std::uint32_t page);
+    void unlinkPartial(std::uint32_t page);
+};
+
+#endif // SLAB_ALLOCATOR_H
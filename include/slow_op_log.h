@@ -0,0 +1,70 @@
+// include/slow_op_log.h
+#ifndef SLOW_OP_LOG_H
+#define SLOW_OP_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class RequestTrace;
+
+// Settings for the slow-op log (see SlowOpLog::start).
+struct SlowOpConfig {
+    std::chrono::microseconds threshold{0};        // Ops at least this long are recorded
+    std::size_t capacity = 256;                    // Most recent slow ops kept in memory
+    std::string path;                              // Also append them to this file (empty = memory only)
+    std::function<std::size_t()> queue_depth;      // Replication queue depth, read when an op is recorded
+};
+
+// One operation that took at least the threshold.
+struct SlowOp {
+    std::uint64_t sequence = 0;     // 1 for the first slow op since start
+    std::string op;                 // "Get", "Put", "Delete", "ApplyPut", "ApplyDelete"
+    std::uint64_t key_hash = 0;     // LRUCache::hashKey of the key; the key itself is not kept
+    std::int64_t shard = -1;        // -1 if the op was not routed to a shard (segment mode)
+    std::uint64_t value_bytes = 0;
+    std::int64_t start_unix_ms = 0;
+    std::uint64_t total_ns = 0;
+    std::vector<std::pair<const char*, std::uint64_t>> phases; // Span name and ns, in completion order
+    std::uint64_t queue_depth = 0;  // Replication queue when the op finished
+};
+
+// Bounded log of the slowest recent operations. Every request the server
+// handles carries a RequestTrace while the log is on, so its phases are
+// timed as it runs; only a request that turns out slower than the
+// threshold takes the log's lock and is copied into the ring. Fast
+// requests therefore pay their clock reads and nothing else. With a file
+// configured, a background thread appends new entries once a second, so
+// a slow disk never adds to the latency it is reporting.
+class SlowOpLog {
+public:
+    // False if the threshold is 0, the file cannot be opened or the log
+    // is already running.
+    static bool start(const SlowOpConfig& config);
+    // Writes the pending entries and closes the file. The ring is kept.
+    static void stop();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static std::chrono::nanoseconds threshold() {
+        return std::chrono::nanoseconds(threshold_ns_.load(std::memory_order_relaxed));
+    }
+
+    // Called by RequestTrace for a request that took total >= threshold().
+    static void record(const RequestTrace& trace, std::chrono::steady_clock::duration total);
+
+    // Up to limit (0 = all) kept slow ops, most recent first.
+    static std::vector<SlowOp> recent(std::size_t limit);
+    // Slow ops since start, including those the ring no longer holds.
+    static std::uint64_t total();
+
+private:
+    static std::atomic<bool> enabled_;
+    static std::atomic<std::int64_t> threshold_ns_;
+};
+
+#endif // SLOW_OP_LOG_H
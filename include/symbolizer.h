@@ -0,0 +1,21 @@
+// include/symbolizer.h
+#ifndef SYMBOLIZER_H
+#define SYMBOLIZER_H
+
+#include <cstddef>
+#include <string>
+
+// Symbolization of code addresses from backtraces (lock holder sites, CPU
+// profiles), via dladdr. Only symbols in the dynamic table resolve, so the
+// server links with -rdynamic; static functions never do.
+
+// Demangled function containing address without its parameter list, e.g.
+// "LRUCache::put_sync". Empty if it does not resolve. offset, when given,
+// receives address minus the function's start.
+std::string functionName(const void* address, std::size_t* offset = nullptr);
+
+// "module+0xoffset" relative to the module's load address, for offline
+// symbolization (addr2line -e module), or the raw address.
+std::string moduleOffset(const void* address);
+
+#endif // SYMBOLIZER_H
@@ -0,0 +1,27 @@
+// include/value_codec.h
+#ifndef VALUE_CODEC_H
+#define VALUE_CODEC_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Compresses cache values. Implementations must be stateless (or
+// internally synchronised): the cache calls them from many threads at
+// once, outside its shard locks.
+class ValueCodec {
+public:
+    virtual ~ValueCodec() = default;
+
+    virtual const char* name() const = 0;
+    // Writes the compressed form of in to out. False if the codec failed.
+    virtual bool compress(const std::string& in, std::string& out) const = 0;
+    // Restores a value of raw_length bytes from its compressed form.
+    virtual bool decompress(const std::string& in, std::size_t raw_length, std::string& out) const = 0;
+};
+
+// Returns the codec registered under name ("zlib"), or nullptr if there
+// is none. "none" and "" also return nullptr.
+std::unique_ptr<ValueCodec> makeValueCodec(const std::string& name, int level = -1);
+
+#endif // VALUE_CODEC_H
@@ -0,0 +1,44 @@
+// include/value_table.h
+#ifndef VALUE_TABLE_H
+#define VALUE_TABLE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Content-addressed table of immutable strings (values, key prefixes)
+// shared by several cache entries. Each distinct value is kept once, with a count of the entries
+// that refer to it, and is dropped when the last one goes away.
+// Not thread-safe: used only under the cache mutex; only shared_ptr copies, not raw pointers, outlive it.
+class ValueTable {
+public:
+    // Returns the table's copy of *value, adding value itself if its
+    // content is new, and takes one reference on it.
+    std::shared_ptr<const std::string> acquire(std::shared_ptr<const std::string> value);
+    // Same, copying value only if its content is new.
+    std::shared_ptr<const std::string> acquire(std::string_view value);
+    // Drops one reference taken by acquire.
+    void release(const std::string& value);
+
+    // --- Stats ---
+    std::size_t uniqueValues() const { return values_.size(); }
+    std::size_t uniqueBytes() const { return unique_bytes_; }
+    // Bytes the referencing entries would hold without deduplication.
+    std::size_t referencedBytes() const { return referenced_bytes_; }
+    std::size_t savedBytes() const { return referenced_bytes_ - unique_bytes_; }
+
+private:
+    struct Entry {
+        std::shared_ptr<const std::string> value;
+        std::size_t refs = 0;
+    };
+
+    // Keys view the bytes of their own entry's value, which never move
+    std::unordered_map<std::string_view, Entry> values_;
+    std::size_t unique_bytes_ = 0;
+    std::size_t referenced_bytes_ = 0;
+};
+
+#endif // VALUE_TABLE_H
@@ -0,0 +1,40 @@
+#include "bloom_filter.h"
+
+BloomFilter::BloomFilter(std::size_t expected_keys, std::size_t bits_per_key)
+    : bits_per_key_(bits_per_key == 0 ? 1 : bits_per_key) {
+    reset(expected_keys);
+}
+
+void BloomFilter::reset(std::size_t expected_keys) {
+    std::size_t bits = expected_keys * bits_per_key_;
+    std::size_t count = bits / (sizeof(Block) * 8) + 1;
+    blocks_.assign(count, Block{});
+}
+
+// The block comes from the high half of the hash. Probe positions are 9-bit
+// slices of a remixed copy, taken from its upper bits, which depend on the
+// whole hash.
+std::size_t BloomFilter::blockIndex(std::uint64_t hash) const {
+    return static_cast<std::size_t>(hash >> 32) % blocks_.size();
+}
+
+void BloomFilter::add(std::uint64_t hash) {
+    Block& block = blocks_[blockIndex(hash)];
+    std::uint64_t bits = hash * 0xC2B2AE3D27D4EB4FULL;
+    for (unsigned i = 0; i < kProbes; ++i) {
+        std::uint32_t bit = static_cast<std::uint32_t>(bits >> (10 + i * 9)) & 511;
+        block.words[bit >> 6] |= std::uint64_t{1} << (bit & 63);
+    }
+}
+
+bool BloomFilter::mayContain(std::uint64_t hash) const {
+    const Block& block = blocks_[blockIndex(hash)];
+    std::uint64_t bits = hash * 0xC2B2AE3D27D4EB4FULL;
+    for (unsigned i = 0; i < kProbes; ++i) {
+        std::uint32_t bit = static_cast<std::uint32_t>(bits >> (10 + i * 9)) & 511;
+        if ((block.words[bit >> 6] & (std::uint64_t{1} << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
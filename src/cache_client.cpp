@@ -10,6 +10,10 @@
 // Generated Proto Headers (adjust path based on generation output)
 #include "cache.grpc.pb.h" // Use "" for local includes
 
+// Shared-memory transport client (same-host servers)
+#include "shm_cache_client.h"
+#include <chrono>
+
 using grpc::Channel;
 using grpc::ClientContext;
 using grpc::Status;
@@ -105,10 +109,46 @@ private:
     std::unique_ptr<CacheService::Stub> stub_;
 };
 
+// --- Shared-memory Demo ---
+// Same put/get/delete sequence over the server's shm_socket_path, timing
+// each round trip.
+int RunShmDemo(const std::string& socket_path) {
+    ShmCacheClient client;
+    if (!client.connect(socket_path)) {
+        return 1;
+    }
+    std::cout << "Cache Client connected over shared memory via " << socket_path << std::endl;
+
+    auto timed = [](const char* label, auto&& call) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = call();
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+        std::cout << "  " << label << " took " << elapsed.count() << " us" << std::endl;
+        return result;
+    };
+
+    std::cout << "\nPutting 'apple' -> 'red_fruit'" << std::endl;
+    bool stored = timed("Put", [&] { return client.put("apple", "red_fruit"); });
+    std::cout << (stored ? "  Put successful." : "  Put failed.") << std::endl;
+
+    std::cout << "\nGetting 'apple'" << std::endl;
+    std::optional<std::string> value = timed("Get", [&] { return client.get("apple"); });
+    std::cout << (value ? "  Got value: " + *value : std::string("  Key 'apple' not found.")) << std::endl;
+
+    std::cout << "\nDeleting 'apple'" << std::endl;
+    bool removed = timed("Delete", [&] { return client.remove("apple"); });
+    std::cout << (removed ? "  Delete successful." : "  Delete failed.") << std::endl;
+    return 0;
+}
+
 int main(int argc, char** argv) {
     // --- Connect to the server ---
-    // This could come from command-line args, config file, etc.
-    std::string target_str = "localhost:50051";
+    // Optional argument: "host:port", "unix:/path" (gRPC over a Unix socket)
+    // or "shm:/path" (shared-memory transport).
+    std::string target_str = argc > 1 ? argv[1] : "localhost:50051";
+    if (target_str.rfind("shm:", 0) == 0) {
+        return RunShmDemo(target_str.substr(4));
+    }
 
     // Create a client connected to the server address.
     // Use InsecureChannelCredentials for simplicity (no encryption/auth)
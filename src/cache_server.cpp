@@ -13,6 +13,8 @@
 #include <sstream>   // For parsing config and splitting strings
 #include <algorithm> // For std::find, std::remove, std::stoi, std::stoul
 #include <cctype>    // For std::isspace
+#include <csignal>   // For graceful shutdown on SIGINT/SIGTERM
+#include <pthread.h> // For pthread_sigmask
 
 // gRPC Headers
 #include <grpcpp/grpcpp.h>
@@ -24,6 +26,17 @@
 
 // Your LRU Cache Header
 #include "lru_cache.h"
+#include "sharded_cache.h"
+#include "numa_topology.h"
+#include "memcache_frontend.h"
+#include "resp_frontend.h"
+#include "shm_transport_server.h"
+#include "metrics.h"
+#include "metrics_endpoint.h"
+#include "instrumented_mutex.h"
+#include "request_trace.h"
+#include "slow_op_log.h"
+#include "cpu_profiler.h"
 
 using grpc::Channel;
 using grpc::ClientContext;
@@ -45,6 +58,21 @@ using cache::PutResponse;
 using cache::ReplicationService;
 using cache::ReplicationRequest;
 using cache::ReplicationResponse;
+// Admin types
+using cache::AdminService;
+using cache::StatsRequest;
+using cache::StatsResponse;
+using cache::LatencyHistogram;
+using cache::LockStats;
+using cache::LockHolder;
+using cache::HotKeysRequest;
+using cache::HotKeysResponse;
+using cache::HotKey;
+using cache::SlowOpsRequest;
+using cache::SlowOpsResponse;
+using cache::OpPhase; // cache::SlowOp is spelled out: ::SlowOp is the log entry
+using cache::ProfileRequest;
+using cache::ProfileResponse;
 
 
 // --- Structure for Replication Task ---
@@ -53,16 +81,20 @@ struct ReplicationTask {
 };
 
 // --- Combined Service Implementation ---
-// Implements BOTH CacheService (for clients) AND ReplicationService (for primary)
-class CacheServiceImpl final : public CacheService::Service, public ReplicationService::Service {
+// Implements CacheService (for clients), ReplicationService (for primary)
+// and AdminService (for operators)
+class CacheServiceImpl final : public CacheService::Service, public ReplicationService::Service,
+                               public AdminService::Service {
 private:
-    LRUCache& lru_cache_; // Reference to the local cache instance
+    ShardedCache& lru_cache_; // Reference to the local (sharded) cache instance
+
+    std::uint32_t profile_max_seconds_ = 0; // Longest Profile RPC (0 disables it)
 
     // --- Replication Members (only used if this server is PRIMARY) ---
     std::vector<std::unique_ptr<ReplicationService::Stub>> replica_stubs_;
     std::queue<ReplicationTask> replication_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
+    CacheMutex queue_mutex_{"replication_queue"};
+    std::condition_variable_any queue_cv_; // Works with CacheMutex, instrumented or not
     std::vector<std::thread> replication_workers_;
     std::atomic<bool> stop_replication_{false};
 
@@ -71,7 +103,7 @@ private:
         while (!stop_replication_) {
             ReplicationTask task;
             { // --- Dequeue Task ---
-                std::unique_lock<std::mutex> lock(queue_mutex_);
+                std::unique_lock<CacheMutex> lock(queue_mutex_);
                 // Wait until queue is not empty OR stop is requested
                 queue_cv_.wait(lock, [this] { return !replication_queue_.empty() || stop_replication_; });
 
@@ -101,11 +133,14 @@ private:
                 if (!status.ok()) {
                     std::cerr << "[Replicator] ERROR replicating key=" << task.request.key()
                               << ": " << status.error_code() << ": " << status.error_message() << std::endl;
+                    Metrics::add(Metric::ReplicationErrors);
                     // TODO: Implement retry logic or mark replica as down?
                 } else if (!reply.success()) {
                      std::cerr << "[Replicator] ERROR: Replica failed to apply key=" << task.request.key() << std::endl;
+                     Metrics::add(Metric::ReplicationErrors);
                 } else {
                      std::cout << "[Replicator] Successfully replicated key=" << task.request.key() << std::endl;
+                     Metrics::add(Metric::ReplicationSent);
                 }
             }
         }
@@ -114,7 +149,7 @@ private:
 
 public:
     // Constructor now takes replica addresses (empty if this is not a primary)
-    explicit CacheServiceImpl(LRUCache& cache, const std::vector<std::string>& replica_addrs)
+    CacheServiceImpl(ShardedCache& cache, const std::vector<std::string>& replica_addrs)
         : lru_cache_(cache)
     {
         if (!replica_addrs.empty()) {
@@ -149,26 +184,75 @@ public:
         }
     }
 
+    // --- Replication Enqueue (shared by gRPC handlers and raw front-ends) ---
+    // No-op unless this server is a primary.
+    void enqueueReplication(ReplicationRequest::OperationType op, const std::string& key, const std::string& value,
+                            std::int64_t expires_at_ms = 0) {
+        if (replica_stubs_.empty()) {
+            return;
+        }
+        ScopedSpan span("replication_enqueue");
+        ReplicationTask task;
+        task.request.set_op_type(op);
+        task.request.set_key(key);
+        task.request.set_value(value); // Empty for DEL
+        task.request.set_expires_at_ms(expires_at_ms);
+
+        { // Enqueue task
+            std::lock_guard<CacheMutex> lock(queue_mutex_);
+            replication_queue_.push(std::move(task));
+            Metrics::add(Metric::ReplicationEnqueued);
+             std::cout << "  Enqueued " << (op == ReplicationRequest::PUT ? "PUT" : "DEL")
+                       << " key=" << key << " for replication." << std::endl;
+        }
+        queue_cv_.notify_one(); // Notify a worker thread
+    }
+
+    void setProfileMaxSeconds(std::uint32_t seconds) { profile_max_seconds_ = seconds; }
+
+    std::size_t replicationQueueDepth() {
+        std::lock_guard<CacheMutex> lock(queue_mutex_);
+        return replication_queue_.size();
+    }
+
+    // --- Metrics (shared by the Stats RPC and the Prometheus endpoint) ---
+    // Counters merged across threads, plus gauges read now.
+    MetricsSnapshot collectMetrics() {
+        MetricsSnapshot snapshot = Metrics::snapshot();
+        snapshot.gauges.emplace_back("entries", static_cast<std::int64_t>(lru_cache_.size()));
+        snapshot.gauges.emplace_back("replication_queue_depth", static_cast<std::int64_t>(replicationQueueDepth()));
+        snapshot.gauges.emplace_back("replicas", static_cast<std::int64_t>(replica_stubs_.size()));
+        snapshot.gauges.emplace_back("hot_keys_replicated", static_cast<std::int64_t>(lru_cache_.hotKeysReplicated()));
+        return snapshot;
+    }
+
     // --- CacheService Implementation (Client-facing) ---
 
     Status Get(ServerContext* context, const GetRequest* request,
         GetResponse* response) override {
+            RequestTrace trace("Get", request->key());
+            OpTimer timer(LatencyOp::Get, /*record_total=*/true);
             std::cout << "[CacheService] Received GET request for key: " << request->key() << std::endl;
-            std::optional<std::string> value_opt = lru_cache_.get(request->key());
+            trace.mark("handler_preamble");
+            // Shares large objects with the cache instead of copying them under its lock
+            std::shared_ptr<const std::string> value_opt = lru_cache_.getShared(request->key());
+            trace.annotate("found", value_opt ? 1 : 0);
+            trace.annotate("value_bytes", value_opt ? static_cast<std::int64_t>(value_opt->size()) : 0);
+            ScopedSpan response_span("response");
 
             // *** ADD EXTRA DEBUG LOGGING ***
-            if (value_opt.has_value()) {
-                std::cout << "  DEBUG: LRUCache::get returned value: '" << value_opt.value() << "'" << std::endl;
+            if (value_opt) {
+                std::cout << "  DEBUG: LRUCache::get returned value: '" << *value_opt << "'" << std::endl;
             } else {
                 std::cout << "  DEBUG: LRUCache::get returned std::nullopt" << std::endl;
             }
             // *** END EXTRA DEBUG LOGGING ***
 
 
-            if (value_opt.has_value()) {
-                response->set_value(value_opt.value());
+            if (value_opt) {
+                response->set_value(*value_opt);
                 response->set_found(true);
-                std::cout << "  Found value: " << value_opt.value() << std::endl;
+                std::cout << "  Found value: " << *value_opt << std::endl;
             } else {
                 response->set_value("");
                 response->set_found(false);
@@ -179,32 +263,30 @@ public:
 
     Status Put(ServerContext* context, const PutRequest* request,
                PutResponse* response) override {
+         RequestTrace trace("Put", request->key());
+         OpTimer timer(LatencyOp::Put, /*record_total=*/true);
          std::cout << "[CacheService] Received PUT request for key: " << request->key()
                    << " value: " << request->value() << std::endl;
+         trace.annotate("value_bytes", static_cast<std::int64_t>(request->value().size()));
+         trace.mark("handler_preamble");
 
         // 1. Apply locally (writes to WAL)
-        if (!lru_cache_.put(request->key(), request->value())) {
+        bool too_large = false;
+        if (!lru_cache_.put(request->key(), request->value(), 0, &too_large)) {
             response->set_success(false);
+            if (too_large) {
+                std::cout << "  Local Put rejected: value exceeds the large-object budget." << std::endl;
+                return Status(StatusCode::RESOURCE_EXHAUSTED, "Value too large for the cache.");
+            }
             std::cout << "  Local Put failed (likely WAL error)." << std::endl;
             return Status(StatusCode::INTERNAL, "Local operation failed, potentially due to WAL error.");
         }
 
         // 2. If primary, enqueue for asynchronous replication
-        if (!replica_stubs_.empty()) {
-            ReplicationTask task;
-            task.request.set_op_type(ReplicationRequest::PUT);
-            task.request.set_key(request->key());
-            task.request.set_value(request->value());
-
-            { // Enqueue task
-                std::lock_guard<std::mutex> lock(queue_mutex_);
-                replication_queue_.push(std::move(task));
-                 std::cout << "  Enqueued PUT key=" << request->key() << " for replication." << std::endl;
-            }
-            queue_cv_.notify_one(); // Notify a worker thread
-        }
+        enqueueReplication(ReplicationRequest::PUT, request->key(), request->value());
 
         // 3. Return success to client immediately
+        ScopedSpan response_span("response");
         response->set_success(true);
         std::cout << "  Local Put successful. Acknowledged client." << std::endl;
         return Status::OK;
@@ -212,7 +294,10 @@ public:
 
      Status Delete(ServerContext* context, const DeleteRequest* request,
                    DeleteResponse* response) override {
+        RequestTrace trace("Delete", request->key());
+        OpTimer timer(LatencyOp::Delete, /*record_total=*/true);
         std::cout << "[CacheService] Received DELETE request for key: " << request->key() << std::endl;
+        trace.mark("handler_preamble");
 
         // 1. Apply locally (writes to WAL)
         if (!lru_cache_.remove(request->key())) {
@@ -222,21 +307,10 @@ public:
         }
 
          // 2. If primary, enqueue for asynchronous replication
-        if (!replica_stubs_.empty()) {
-            ReplicationTask task;
-            task.request.set_op_type(ReplicationRequest::DEL);
-            task.request.set_key(request->key());
-            // Value is not needed for DEL
-
-            { // Enqueue task
-                std::lock_guard<std::mutex> lock(queue_mutex_);
-                replication_queue_.push(std::move(task));
-                 std::cout << "  Enqueued DEL key=" << request->key() << " for replication." << std::endl;
-            }
-            queue_cv_.notify_one(); // Notify a worker thread
-        }
+        enqueueReplication(ReplicationRequest::DEL, request->key(), "");
 
         // 3. Return success to client immediately
+        ScopedSpan response_span("response");
         response->set_success(true);
         std::cout << "  Local Delete successful. Acknowledged client." << std::endl;
         return Status::OK;
@@ -246,6 +320,9 @@ public:
 
     Status ApplyOperation(ServerContext* context, const ReplicationRequest* request,
                           ReplicationResponse* response) override {
+        RequestTrace trace(request->op_type() == ReplicationRequest::PUT ? "ApplyPut" : "ApplyDelete",
+                           request->key());
+        trace.annotate("value_bytes", static_cast<std::int64_t>(request->value().size()));
         std::cout << "[ReplicationService] Received ApplyOperation: "
                   << (request->op_type() == ReplicationRequest::PUT ? "PUT" : "DEL")
                   << " key=" << request->key() << std::endl;
@@ -253,7 +330,7 @@ public:
         bool success = false;
         if (request->op_type() == ReplicationRequest::PUT) {
             // Apply PUT locally, using 'is_recovery=true' to prevent WAL write/re-replication
-            success = lru_cache_.applyReplicatedPut(request->key(), request->value());
+            success = lru_cache_.applyReplicatedPut(request->key(), request->value(), request->expires_at_ms());
         } else if (request->op_type() == ReplicationRequest::DEL) {
             // Apply DEL locally, using 'is_recovery=true'
             success = lru_cache_.applyReplicatedRemove(request->key());
@@ -275,6 +352,116 @@ public:
             return Status::OK;
         }
     }
+
+    // --- AdminService Implementation ---
+
+    Status Stats(ServerContext* context, const StatsRequest* request, StatsResponse* response) override {
+        MetricsSnapshot snapshot = collectMetrics();
+        for (const auto& counter : snapshot.counters) {
+            (*response->mutable_counters())[counter.first] = counter.second;
+        }
+        for (const auto& gauge : snapshot.gauges) {
+            (*response->mutable_gauges())[gauge.first] = gauge.second;
+        }
+        for (const auto& histogram : snapshot.histograms) {
+            LatencyHistogram* latency = response->add_latencies();
+            latency->set_op(histogram.op);
+            latency->set_stage(histogram.stage);
+            latency->set_count(histogram.count);
+            latency->set_sum_ns(histogram.sum_ns);
+            latency->set_p50_ns(histogram.quantileNs(0.5));
+            latency->set_p99_ns(histogram.quantileNs(0.99));
+            latency->set_p999_ns(histogram.quantileNs(0.999));
+            latency->set_max_ns(histogram.quantileNs(1.0));
+            for (std::size_t b = 0; b < histogram.buckets.size(); ++b) {
+                if (histogram.buckets[b] == 0) continue;
+                latency->add_bucket_lower_ns(Metrics::latencyBucketLowerBound(b));
+                latency->add_bucket_counts(histogram.buckets[b]);
+            }
+        }
+        for (const auto& lock : InstrumentedMutex::snapshot()) {
+            LockStats* stats = response->add_locks();
+            stats->set_name(lock.name);
+            stats->set_instances(lock.instances);
+            stats->set_acquisitions(lock.acquisitions);
+            stats->set_contended(lock.contended);
+            stats->set_wait_ns(lock.wait_ns);
+            stats->set_hold_ns(lock.hold_ns);
+            stats->set_max_hold_ns(lock.max_hold_ns);
+            for (const auto& holder : lock.longest_holders) {
+                LockHolder* sample = stats->add_longest_holders();
+                sample->set_site(holder.site);
+                sample->set_max_hold_ns(holder.max_hold_ns);
+                sample->set_samples(holder.samples);
+            }
+        }
+        return Status::OK;
+    }
+
+    Status HotKeys(ServerContext* context, const HotKeysRequest* request, HotKeysResponse* response) override {
+        std::size_t limit = request->limit() == 0 ? 10 : request->limit();
+        for (const auto& estimate : lru_cache_.hotKeys(limit)) {
+            HotKey* key = response->add_keys();
+            key->set_key(estimate.key);
+            key->set_shard(static_cast<std::uint32_t>(estimate.shard));
+            key->set_estimated_count(estimate.count);
+            key->set_error_bound(estimate.error);
+            key->set_ops_per_second(estimate.per_second);
+        }
+        response->set_sample_rate(lru_cache_.hotKeySampleRate());
+        return Status::OK;
+    }
+
+    Status SlowOps(ServerContext* context, const SlowOpsRequest* request, SlowOpsResponse* response) override {
+        for (const SlowOp& op : SlowOpLog::recent(request->limit())) {
+            cache::SlowOp* entry = response->add_ops();
+            entry->set_sequence(op.sequence);
+            entry->set_op(op.op);
+            entry->set_key_hash(op.key_hash);
+            entry->set_shard(static_cast<std::int32_t>(op.shard));
+            entry->set_value_bytes(op.value_bytes);
+            entry->set_start_unix_ms(op.start_unix_ms);
+            entry->set_total_ns(op.total_ns);
+            for (const auto& phase : op.phases) {
+                OpPhase* out = entry->add_phases();
+                out->set_name(phase.first);
+                out->set_ns(phase.second);
+            }
+            entry->set_replication_queue_depth(op.queue_depth);
+        }
+        if (SlowOpLog::enabled()) {
+            response->set_threshold_us(
+                std::chrono::duration_cast<std::chrono::microseconds>(SlowOpLog::threshold()).count());
+        }
+        response->set_total_slow(SlowOpLog::total());
+        return Status::OK;
+    }
+
+    // Holds this gRPC thread for the whole duration; only one runs at a time
+    Status Profile(ServerContext* context, const ProfileRequest* request, ProfileResponse* response) override {
+        if (profile_max_seconds_ == 0) {
+            return Status(StatusCode::FAILED_PRECONDITION, "Profiling is disabled (profile_max_seconds=0)");
+        }
+        std::uint32_t seconds = std::min(request->duration_seconds() == 0 ? 10u : request->duration_seconds(),
+                                         profile_max_seconds_);
+        std::uint32_t frequency_hz = std::min(request->frequency_hz() == 0 ? 99u : request->frequency_hz(), 1000u);
+        std::cout << "Profiling CPU for " << seconds << " s at " << frequency_hz << " Hz." << std::endl;
+        CpuProfile profile;
+        switch (CpuProfiler::profile(std::chrono::seconds(seconds), frequency_hz, &profile)) {
+            case ProfileResult::Ok:
+                break;
+            case ProfileResult::Busy:
+                return Status(StatusCode::UNAVAILABLE, "Another profile is running");
+            case ProfileResult::TimerFailed:
+                return Status(StatusCode::INTERNAL, "Could not arm the profiling timer");
+        }
+        response->set_folded(profile.folded);
+        response->set_samples(profile.samples);
+        response->set_dropped(profile.dropped);
+        response->set_frequency_hz(frequency_hz);
+        response->set_duration_seconds(seconds);
+        return Status::OK;
+    }
 };
 
 // --- Helper function to trim whitespace ---
@@ -294,6 +481,56 @@ struct ServerConfig {
     int ttl_seconds = 60;
     std::string wal_file = "cache.wal";
     std::vector<std::string> replica_addresses; // Empty means replica mode
+    std::size_t arena_region_kb = 0;               // 0 keeps values on the general heap
+    int arena_compact_interval_seconds = 60;
+    double arena_compact_live_ratio = 0.5;         // Evacuate regions at or below this live ratio
+    std::size_t slab_memory_mb = 0;                // 0 disables slab value storage
+    std::size_t slab_page_kb = 1024;
+    double slab_growth_factor = 1.25;
+    int slab_rebalance_interval_seconds = 10;
+    bool huge_pages = false;                       // Back node pool/arena/slabs with 2 MB pages
+    std::size_t shard_count = 1;                   // Independent LRU shards (each with a WAL segment)
+    bool numa_aware = false;                       // Place shards on NUMA nodes
+    bool thread_per_core = false;                  // One shard + pinned event loop per CPU
+    std::string memcache_listen_address;           // Empty disables the memcached-protocol listener
+    std::size_t memcache_threads = 1;              // epoll loops for the memcached listener
+    std::string resp_listen_address;               // Empty disables the Redis-protocol listener
+    std::size_t resp_threads = 1;                  // epoll loops for the Redis listener
+    std::string grpc_unix_socket;                  // Extra gRPC listener on a Unix socket (empty = off)
+    std::string shm_socket_path;                   // Shared-memory transport handshake socket (empty = off)
+    std::size_t shm_ring_kb = 1024;                // Per-direction ring size for shared-memory clients
+    int shm_spin_us = 50;                          // Server spin before sleeping on the eventfd
+    std::string metrics_listen_address;            // Prometheus HTTP endpoint, e.g. "0.0.0.0:9100" (empty = off)
+    bool latency_histograms = false;               // Time lock wait, critical section, WAL and handler per op
+    std::string trace_file;                        // Chrome trace JSON of sampled requests (empty = off)
+    std::uint32_t trace_sample_rate = 1000;        // Trace 1 in N requests per handler thread
+    std::uint64_t trace_min_duration_us = 0;       // Only write traced requests at least this slow
+    std::size_t trace_max_file_mb = 64;            // Rotate the trace file at this size
+    std::size_t trace_max_files = 3;               // Rotated trace files kept
+    std::uint64_t slow_op_threshold_us = 0;        // Record ops at least this slow (0 = off)
+    std::size_t slow_op_capacity = 256;            // Slow ops kept for the SlowOps RPC
+    std::string slow_op_file;                      // Also append slow ops to this file (empty = off)
+    std::uint32_t profile_max_seconds = 0;         // Longest Profile RPC (0 = RPC disabled)
+    std::string shared_segment_name;               // Serve from a multi-process shm segment (empty = off)
+    std::size_t shared_segment_mb = 64;            // Size of the segment when this server creates it
+    std::string segment_file;                      // Persist the cache in an mmap'd file (empty = off)
+    std::string flash_path;                        // Spill evictions to this file on flash (empty = off)
+    std::size_t flash_size_mb = 1024;              // Flash tier size, split across shards
+    std::size_t flash_region_mb = 16;              // Unit of sequential writes and FIFO reclamation
+    std::size_t large_value_threshold_kb = 0;      // Values this big use the large-object store (0 = off)
+    std::size_t large_value_memory_mb = 256;       // Large-object store budget, split across shards
+    std::string compression_codec = "none";        // Value compression codec ("none" or "zlib")
+    std::size_t compression_min_bytes = 256;       // Smaller values are stored as is
+    std::size_t dedup_min_bytes = 0;               // Share equal values of at least this size (0 = off)
+    bool key_interning = false;                    // Store shared key prefixes once per shard
+    char key_delimiter = ':';                      // Separator of key segments, e.g. "tenant:12:user:3"
+    std::uint32_t hot_key_sample_rate = 0;         // Count 1 in N Gets/Puts for hot-key detection (0 = off)
+    std::size_t hot_key_capacity = 64;             // Keys tracked per shard
+    int hot_key_window_seconds = 60;               // Rates cover the last one to two windows
+    bool hot_key_replication = false;              // Serve hot keys from per-core copies (needs the sketch)
+    double hot_key_replica_min_rate = 10000;       // Ops/s at which a key is promoted
+    std::size_t hot_key_replica_max_keys = 4;      // Promoted keys per shard
+    int hot_key_replica_interval_seconds = 1;      // How often shards re-evaluate their hot keys
 };
 
 // --- Configuration Parsing Function ---
@@ -344,6 +581,180 @@ bool loadConfig(const std::string& filename, ServerConfig& config) {
             } catch (const std::exception& e) { /* handle error */ }
         } else if (key == "wal_file") {
             config.wal_file = value;
+        } else if (key == "arena_region_kb") {
+            try {
+                config.arena_region_kb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "arena_compact_interval_seconds") {
+            try {
+                config.arena_compact_interval_seconds = std::stoi(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "arena_compact_live_ratio") {
+            try {
+                config.arena_compact_live_ratio = std::stod(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "slab_memory_mb") {
+            try {
+                config.slab_memory_mb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "slab_page_kb") {
+            try {
+                config.slab_page_kb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "slab_growth_factor") {
+            try {
+                config.slab_growth_factor = std::stod(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "shard_count") {
+            try {
+                config.shard_count = std::stoul(value);
+                if (config.shard_count == 0) config.shard_count = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "numa_aware") {
+            config.numa_aware = (value == "true" || value == "1");
+        } else if (key == "thread_per_core") {
+            config.thread_per_core = (value == "true" || value == "1");
+        } else if (key == "memcache_listen_address") {
+            config.memcache_listen_address = value;
+        } else if (key == "memcache_threads") {
+            try {
+                config.memcache_threads = std::stoul(value);
+                if (config.memcache_threads == 0) config.memcache_threads = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "resp_listen_address") {
+            config.resp_listen_address = value;
+        } else if (key == "resp_threads") {
+            try {
+                config.resp_threads = std::stoul(value);
+                if (config.resp_threads == 0) config.resp_threads = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "grpc_unix_socket") {
+            config.grpc_unix_socket = value;
+        } else if (key == "shm_socket_path") {
+            config.shm_socket_path = value;
+        } else if (key == "shm_ring_kb") {
+            try {
+                config.shm_ring_kb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "shm_spin_us") {
+            try {
+                config.shm_spin_us = std::stoi(value);
+                if (config.shm_spin_us < 0) config.shm_spin_us = 0;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "metrics_listen_address") {
+            config.metrics_listen_address = value;
+        } else if (key == "latency_histograms") {
+            config.latency_histograms = (value == "true" || value == "1");
+        } else if (key == "trace_file") {
+            config.trace_file = value;
+        } else if (key == "trace_sample_rate") {
+            try {
+                config.trace_sample_rate = static_cast<std::uint32_t>(std::stoul(value));
+                if (config.trace_sample_rate == 0) config.trace_sample_rate = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "trace_min_duration_us") {
+            try {
+                config.trace_min_duration_us = std::stoull(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "trace_max_file_mb") {
+            try {
+                config.trace_max_file_mb = std::stoul(value);
+                if (config.trace_max_file_mb == 0) config.trace_max_file_mb = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "trace_max_files") {
+            try {
+                config.trace_max_files = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "slow_op_threshold_us") {
+            try {
+                config.slow_op_threshold_us = std::stoull(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "slow_op_capacity") {
+            try {
+                config.slow_op_capacity = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "slow_op_file") {
+            config.slow_op_file = value;
+        } else if (key == "profile_max_seconds") {
+            try {
+                config.profile_max_seconds = static_cast<std::uint32_t>(std::stoul(value));
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "shared_segment_name") {
+            config.shared_segment_name = value;
+        } else if (key == "segment_file") {
+            config.segment_file = value;
+        } else if (key == "flash_path") {
+            config.flash_path = value;
+        } else if (key == "flash_size_mb") {
+            try {
+                config.flash_size_mb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "flash_region_mb") {
+            try {
+                config.flash_region_mb = std::stoul(value);
+                if (config.flash_region_mb == 0) config.flash_region_mb = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "large_value_threshold_kb") {
+            try {
+                config.large_value_threshold_kb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "large_value_memory_mb") {
+            try {
+                config.large_value_memory_mb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "compression_codec") {
+            config.compression_codec = value;
+        } else if (key == "compression_min_bytes") {
+            try {
+                config.compression_min_bytes = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "dedup_min_bytes") {
+            try {
+                config.dedup_min_bytes = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "key_interning") {
+            config.key_interning = (value == "true" || value == "1");
+        } else if (key == "key_delimiter") {
+            if (!value.empty()) config.key_delimiter = value[0];
+        } else if (key == "hot_key_sample_rate") {
+            try {
+                config.hot_key_sample_rate = static_cast<std::uint32_t>(std::stoul(value));
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "hot_key_capacity") {
+            try {
+                config.hot_key_capacity = std::stoul(value);
+                if (config.hot_key_capacity == 0) config.hot_key_capacity = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "hot_key_window_seconds") {
+            try {
+                config.hot_key_window_seconds = std::stoi(value);
+                if (config.hot_key_window_seconds < 1) config.hot_key_window_seconds = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "hot_key_replication") {
+            config.hot_key_replication = (value == "true" || value == "1");
+        } else if (key == "hot_key_replica_min_rate") {
+            try {
+                config.hot_key_replica_min_rate = std::stod(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "hot_key_replica_max_keys") {
+            try {
+                config.hot_key_replica_max_keys = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "hot_key_replica_interval_seconds") {
+            try {
+                config.hot_key_replica_interval_seconds = std::stoi(value);
+                if (config.hot_key_replica_interval_seconds < 1) config.hot_key_replica_interval_seconds = 1;
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "shared_segment_mb") {
+            try {
+                config.shared_segment_mb = std::stoul(value);
+            } catch (const std::exception& e) { /* handle error */ }
+        } else if (key == "huge_pages") {
+            config.huge_pages = (value == "true" || value == "1");
+        } else if (key == "slab_rebalance_interval_seconds") {
+            try {
+                config.slab_rebalance_interval_seconds = std::stoi(value);
+            } catch (const std::exception& e) { /* handle error */ }
         } else if (key == "replica_addresses") {
             config.replica_addresses.clear(); // Clear previous entries if key is found again
             if (!value.empty()) {
@@ -366,19 +777,100 @@ bool loadConfig(const std::string& filename, ServerConfig& config) {
 
 // --- Server Runner (Modified) ---
 // No longer takes config parameters directly, uses the global config struct implicitly or explicitly
-void RunServer(LRUCache& cache_instance, const ServerConfig& config) { // Pass config struct
+void RunServer(ShardedCache& cache_instance, const ServerConfig& config) {
     CacheServiceImpl service(cache_instance, config.replica_addresses); // Pass replicas to service
+    service.setProfileMaxSeconds(config.profile_max_seconds);
 
     grpc::EnableDefaultHealthCheckService(true);
     grpc::reflection::InitProtoReflectionServerBuilderPlugin();
     ServerBuilder builder;
     builder.AddListeningPort(config.listen_address, grpc::InsecureServerCredentials()); // Use config listen address
+    if (!config.grpc_unix_socket.empty()) {
+        // Co-located clients skip the TCP stack (target "unix:<path>")
+        builder.AddListeningPort("unix:" + config.grpc_unix_socket, grpc::InsecureServerCredentials());
+    }
 
     builder.RegisterService(static_cast<CacheService::Service*>(&service));
     builder.RegisterService(static_cast<ReplicationService::Service*>(&service));
+    builder.RegisterService(static_cast<AdminService::Service*>(&service));
 
     std::unique_ptr<Server> server(builder.BuildAndStart());
     std::cout << "Server listening on " << config.listen_address << std::endl; // Log configured address
+    if (!config.grpc_unix_socket.empty()) {
+        std::cout << "Server also listening on unix:" << config.grpc_unix_socket << std::endl;
+    }
+
+    // --- Optional memcached / Redis protocol listeners ---
+    // Writes made through them are replicated like gRPC Put/Delete.
+    MutationHook replicate = [&service](bool is_put, const std::string& key, const std::string& value,
+                                        std::int64_t expires_at_ms) {
+        service.enqueueReplication(is_put ? ReplicationRequest::PUT : ReplicationRequest::DEL, key, value,
+                                   expires_at_ms);
+    };
+    std::unique_ptr<MemcacheFrontend> memcache;
+    if (!config.memcache_listen_address.empty()) {
+        memcache = std::make_unique<MemcacheFrontend>(cache_instance, replicate);
+        if (!memcache->start(config.memcache_listen_address, config.memcache_threads)) {
+            std::cerr << "ERROR: Could not start memcached listener on " << config.memcache_listen_address << std::endl;
+            memcache.reset();
+        }
+    }
+    std::unique_ptr<RespFrontend> resp;
+    if (!config.resp_listen_address.empty()) {
+        resp = std::make_unique<RespFrontend>(cache_instance, replicate);
+        if (!resp->start(config.resp_listen_address, config.resp_threads)) {
+            std::cerr << "ERROR: Could not start Redis listener on " << config.resp_listen_address << std::endl;
+            resp.reset();
+        }
+    }
+    std::unique_ptr<ShmTransportServer> shm;
+    if (!config.shm_socket_path.empty()) {
+        shm = std::make_unique<ShmTransportServer>(cache_instance, replicate, config.shm_ring_kb * 1024,
+                                                   std::chrono::microseconds(config.shm_spin_us));
+        if (!shm->start(config.shm_socket_path)) {
+            std::cerr << "ERROR: Could not start shared-memory transport on " << config.shm_socket_path << std::endl;
+            shm.reset();
+        }
+    }
+    if (config.slow_op_threshold_us > 0) {
+        SlowOpConfig slow_ops;
+        slow_ops.threshold = std::chrono::microseconds(config.slow_op_threshold_us);
+        slow_ops.capacity = config.slow_op_capacity;
+        slow_ops.path = config.slow_op_file;
+        slow_ops.queue_depth = [&service] { return service.replicationQueueDepth(); };
+        if (SlowOpLog::start(slow_ops)) {
+            std::cout << "Logging ops slower than " << config.slow_op_threshold_us << " us." << std::endl;
+        }
+    }
+    std::unique_ptr<MetricsEndpoint> metrics_endpoint;
+    if (!config.metrics_listen_address.empty()) {
+        metrics_endpoint = std::make_unique<MetricsEndpoint>(
+            [&service] {
+                return Metrics::formatPrometheus(service.collectMetrics()) +
+                       InstrumentedMutex::formatPrometheus(InstrumentedMutex::snapshot());
+            });
+        if (!metrics_endpoint->start(config.metrics_listen_address)) {
+            std::cerr << "ERROR: Could not start metrics endpoint on " << config.metrics_listen_address << std::endl;
+            metrics_endpoint.reset();
+        } else {
+            std::cout << "Prometheus metrics at http://" << config.metrics_listen_address << "/metrics" << std::endl;
+        }
+    }
+    // --- Graceful Shutdown ---
+    // main() blocks SIGINT/SIGTERM in every thread; this one waits for them
+    // so the server can unwind (flushing the WAL and marking a segment file
+    // clean) instead of dying mid-write.
+    std::thread signal_watcher([&server] {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        int received = 0;
+        sigwait(&signals, &received);
+        std::cout << "Received signal " << received << ", shutting down." << std::endl;
+        server->Shutdown();
+    });
+
     std::cout << "Using WAL file: " << config.wal_file << std::endl;
     if (!config.replica_addresses.empty()) {
          std::cout << "Operating in PRIMARY mode." << std::endl;
@@ -390,10 +882,19 @@ void RunServer(LRUCache& cache_instance, const ServerConfig& config) { // Pass c
     }
 
     server->Wait();
+    signal_watcher.join();
+    SlowOpLog::stop(); // Before service, which reports the queue depth, goes away
 }
 
 // --- Main Server Entry Point (Modified) ---
 int main(int argc, char** argv) {
+    // Block before any thread starts so only RunServer's watcher sees them
+    sigset_t shutdown_signals;
+    sigemptyset(&shutdown_signals);
+    sigaddset(&shutdown_signals, SIGINT);
+    sigaddset(&shutdown_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdown_signals, nullptr);
+
     // --- Load Configuration ---
     ServerConfig config;
     std::string config_filename = "cache_config.cfg"; // Default config file name
@@ -407,29 +908,262 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // --- Segment modes: the segment has its own layout, so shard features do not apply ---
+    if (!config.shared_segment_name.empty() && !config.segment_file.empty()) {
+        std::cout << "Warning: shared_segment_name and segment_file are exclusive. Using the shared segment."
+                  << std::endl;
+        config.segment_file.clear();
+    }
+    bool segment_mode = !config.shared_segment_name.empty() || !config.segment_file.empty();
+    if (segment_mode && (config.thread_per_core || config.arena_region_kb > 0 || config.slab_memory_mb > 0 ||
+                         !config.flash_path.empty() || config.large_value_threshold_kb > 0 ||
+                         config.compression_codec != "none" || config.dedup_min_bytes > 0 || config.key_interning)) {
+        std::cout << "Warning: thread_per_core, arenas, slabs, the flash tier, the large-object store, "
+                  << "compression, deduplication and key interning are ignored in segment mode." << std::endl;
+        config.thread_per_core = false;
+        config.arena_region_kb = 0;
+        config.slab_memory_mb = 0;
+        config.flash_path.clear();
+        config.large_value_threshold_kb = 0;
+        config.compression_codec = "none";
+        config.dedup_min_bytes = 0;
+        config.key_interning = false;
+    }
+
+    // --- Thread-per-core: one shard per CPU ---
+    // CPUs are interleaved across NUMA nodes (n0c0, n1c0, n0c1, ...) to match
+    // the round-robin shard placement, so with evenly sized nodes each
+    // shard's core sits on the node holding its memory.
+    NumaTopology topology = NumaTopology::detect();
+    std::vector<int> core_cpus;
+    if (config.thread_per_core) {
+        std::size_t max_cpus = 0;
+        for (const auto& node : topology.nodes()) max_cpus = std::max(max_cpus, node.cpus.size());
+        for (std::size_t round = 0; round < max_cpus; ++round) {
+            for (const auto& node : topology.nodes()) {
+                if (round < node.cpus.size()) core_cpus.push_back(node.cpus[round]);
+            }
+        }
+        config.shard_count = core_cpus.size();
+        std::cout << "Thread-per-core mode: " << config.shard_count << " cores, one shard each." << std::endl;
+    }
+
+    // --- NUMA Topology (optional) ---
+    std::unique_ptr<NumaTopology> numa;
+    if (config.numa_aware) {
+        numa = std::make_unique<NumaTopology>(topology);
+        std::cout << "NUMA aware: " << numa->nodeCount() << " node(s) detected." << std::endl;
+        if (config.shard_count < numa->nodeCount()) {
+            std::cout << "Warning: shard_count " << config.shard_count << " is below the node count; "
+                      << "some nodes will hold no shards." << std::endl;
+        }
+    }
+
+    // --- Latency Histograms (optional) ---
+    if (config.latency_histograms) {
+        Metrics::setLatencyTracking(true);
+        std::cout << "Latency histograms enabled." << std::endl;
+    }
+
+    // --- Request Tracing (optional) ---
+    if (!config.trace_file.empty()) {
+        TraceConfig trace;
+        trace.path = config.trace_file;
+        trace.sample_rate = config.trace_sample_rate;
+        trace.min_duration = std::chrono::microseconds(config.trace_min_duration_us);
+        trace.max_file_bytes = config.trace_max_file_mb << 20;
+        trace.max_files = config.trace_max_files;
+        if (RequestTracer::start(trace)) {
+            std::cout << "Tracing 1 in " << config.trace_sample_rate << " requests to " << config.trace_file
+                      << std::endl;
+        }
+    }
+
     // --- Create Cache Instance using loaded config ---
-    LRUCache shared_cache(config.capacity, config.ttl_seconds);
-    std::cout << "LRU Cache initialized (Capacity: " << config.capacity << ", TTL: " << config.ttl_seconds << "s)" << std::endl;
+    ShardedCache shared_cache(config.shard_count, config.capacity, config.ttl_seconds, numa.get());
+    std::cout << "LRU Cache initialized (Capacity: " << config.capacity << ", TTL: " << config.ttl_seconds
+              << "s, Shards: " << shared_cache.shardCount() << ")" << std::endl;
 
-    // --- Load State from WAL using loaded config ---
-    if (!LRUCache::loadFromWAL(config.wal_file, shared_cache)) {
-         std::cerr << "FATAL: Failed to load state from WAL '" << config.wal_file << "'. Exiting." << std::endl;
-         return 1;
+    // --- Enable Arenas before recovery so replayed entries land in them ---
+    // NUMA placement needs pooled nodes; heap nodes would land wherever the
+    // allocating handler thread happens to run.
+    if (config.huge_pages || numa) {
+        shared_cache.forEachShard([&](LRUCache& shard) { shard.enableNodePool(config.huge_pages); });
+        std::cout << "Node pool enabled" << (config.huge_pages ? " on huge pages." : ".") << std::endl;
+    }
+    if (config.arena_region_kb > 0) {
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            shard.enableArena(config.arena_region_kb * 1024, config.huge_pages);
+        });
+        std::cout << "Value arena enabled (" << config.arena_region_kb << " KB regions)." << std::endl;
+    }
+    if (config.slab_memory_mb > 0) {
+        // The memory budget is split evenly across shards
+        std::size_t per_shard_bytes = config.slab_memory_mb * 1024 * 1024 / shared_cache.shardCount();
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            shard.enableSlabs(config.slab_page_kb * 1024, per_shard_bytes, config.slab_growth_factor,
+                              config.huge_pages);
+        });
+        std::cout << "Slab value storage enabled (" << config.slab_memory_mb << " MB, growth factor "
+                  << config.slab_growth_factor << ")." << std::endl;
     }
-    std::cout << "Cache state after WAL recovery: ";
-    shared_cache.print();
 
-    // --- Open WAL File for Appending using loaded config ---
-    std::ofstream wal_file_stream(config.wal_file, std::ios::app);
-    if (!wal_file_stream.is_open()) {
-        std::cerr << "FATAL: Could not open WAL file '" << config.wal_file << "' for appending." << std::endl;
-        return 1;
+    // --- Large-object Store before recovery so replayed large values land in it ---
+    if (config.large_value_threshold_kb > 0) {
+        std::size_t per_shard_bytes = config.large_value_memory_mb * 1024 * 1024 / shared_cache.shardCount();
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            shard.enableLargeObjects(config.large_value_threshold_kb * 1024, per_shard_bytes);
+        });
+        std::cout << "Large-object store enabled (values of " << config.large_value_threshold_kb << " KB and up, "
+                  << config.large_value_memory_mb << " MB)." << std::endl;
+    }
+
+    // --- Compression before recovery so replayed values are stored compressed ---
+    if (config.compression_codec != "none") {
+        bool enabled = true;
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            std::unique_ptr<ValueCodec> codec = makeValueCodec(config.compression_codec);
+            enabled = codec != nullptr && shard.enableCompression(std::move(codec), config.compression_min_bytes);
+        });
+        if (enabled) {
+            std::cout << "Value compression enabled (" << config.compression_codec << ", values of "
+                      << config.compression_min_bytes << " bytes and up)." << std::endl;
+        }
+    }
+
+    // --- Deduplication before recovery so replayed duplicates are shared ---
+    if (config.dedup_min_bytes > 0) {
+        shared_cache.forEachShard([&](LRUCache& shard) { shard.enableDedup(config.dedup_min_bytes); });
+        std::cout << "Value deduplication enabled (values of " << config.dedup_min_bytes << " bytes and up)."
+                  << std::endl;
+    }
+
+    // --- Key Interning before recovery so replayed keys share their prefixes ---
+    if (config.key_interning) {
+        shared_cache.forEachShard([&](LRUCache& shard) { shard.enableKeyInterning(config.key_delimiter); });
+        std::cout << "Key prefix interning enabled (delimiter '" << config.key_delimiter << "')." << std::endl;
+    }
+
+    // --- Flash Tier before recovery so entries evicted during replay spill to it ---
+    if (!config.flash_path.empty()) {
+        // Each shard's file needs a few regions for FIFO reclamation to leave
+        // most of it usable; shrink the regions rather than the file
+        constexpr std::size_t kMinRegionsPerShard = 4;
+        constexpr std::size_t kMinRegionBytes = 64 * 1024; // FlashTier's smallest region
+        std::size_t shard_bytes = config.flash_size_mb * 1024 * 1024 / shared_cache.shardCount();
+        std::size_t region_bytes = config.flash_region_mb * 1024 * 1024;
+        if (shard_bytes / region_bytes < kMinRegionsPerShard) {
+            region_bytes = shard_bytes / kMinRegionsPerShard / kMinRegionBytes * kMinRegionBytes;
+            if (region_bytes < kMinRegionBytes) {
+                std::cerr << "FATAL: flash_size_mb=" << config.flash_size_mb << " is too small for "
+                          << shared_cache.shardCount() << " shards; each needs at least "
+                          << kMinRegionsPerShard * kMinRegionBytes / 1024 << " KB. Exiting." << std::endl;
+                return 1;
+            }
+            std::cerr << "Warning: flash_region_mb=" << config.flash_region_mb << " leaves fewer than "
+                      << kMinRegionsPerShard << " regions per shard. Using " << region_bytes / 1024
+                      << " KB regions." << std::endl;
+        }
+        std::size_t per_shard_regions = shard_bytes / region_bytes;
+        for (std::size_t i = 0; i < shared_cache.shardCount(); ++i) {
+            // Same naming as WAL segments: one file per shard
+            std::string path = ShardedCache::walSegmentPath(config.flash_path, i, shared_cache.shardCount());
+            if (!shared_cache.shard(i).enableFlashTier(path, region_bytes, per_shard_regions)) {
+                std::cerr << "FATAL: Could not open flash tier file '" << path << "'. Exiting." << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "Flash tier enabled (" << config.flash_size_mb << " MB at " << config.flash_path << ", "
+                  << per_shard_regions << " regions of " << region_bytes / 1024 << " KB per shard)." << std::endl;
+    }
+
+    // --- Shared Segment (optional) ---
+    // The segment outlives server restarts until it is unlinked or the host
+    // reboots, and other processes write to it without going through this
+    // server, so it has no WAL.
+    if (!config.shared_segment_name.empty()) {
+        auto segment = SegmentCache::openShared(config.shared_segment_name, config.shared_segment_mb * 1024 * 1024,
+                                                config.capacity, config.ttl_seconds);
+        if (!segment) {
+            std::cerr << "FATAL: Could not open shared segment '" << config.shared_segment_name << "'. Exiting."
+                      << std::endl;
+            return 1;
+        }
+        shared_cache.attachSegment(std::move(segment));
+        std::cout << "Serving from shared segment " << config.shared_segment_name << "; WAL disabled." << std::endl;
+    } else {
+        // --- Persistent Segment File (optional) ---
+        // After a clean shutdown the file already holds the cache; after a
+        // crash it comes back empty and the WAL is replayed into it.
+        bool restored = false;
+        if (!config.segment_file.empty()) {
+            auto segment = SegmentCache::openFile(config.segment_file, config.shared_segment_mb * 1024 * 1024,
+                                                  config.capacity, config.ttl_seconds, &restored);
+            if (!segment) {
+                std::cerr << "FATAL: Could not open segment file '" << config.segment_file << "'. Exiting."
+                          << std::endl;
+                return 1;
+            }
+            shared_cache.attachSegment(std::move(segment));
+        }
+
+        // --- Load State from WAL using loaded config ---
+        if (restored) {
+            std::cout << "Segment file closed cleanly; skipping WAL replay." << std::endl;
+        } else if (!shared_cache.loadFromWAL(config.wal_file)) {
+             std::cerr << "FATAL: Failed to load state from WAL '" << config.wal_file << "'. Exiting." << std::endl;
+             return 1;
+        } else {
+            std::cout << "Cache state after WAL recovery: ";
+            shared_cache.print();
+        }
+
+        // --- Open WAL Segments for Appending using loaded config ---
+        if (!shared_cache.openWal(config.wal_file)) {
+            std::cerr << "FATAL: Could not open WAL file '" << config.wal_file << "' for appending." << std::endl;
+            return 1;
+        }
+        std::cout << "WAL stream attached to cache instance." << std::endl;
+    }
+
+    // --- Hot-key Detection (after recovery; replayed writes are never counted) ---
+    if (config.hot_key_sample_rate > 0 && !shared_cache.segmentMode()) {
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            shard.enableHotKeys(config.hot_key_capacity, config.hot_key_sample_rate,
+                                std::chrono::seconds(config.hot_key_window_seconds));
+        });
+        std::cout << "Hot-key detection enabled (1 in " << config.hot_key_sample_rate << " ops, "
+                  << config.hot_key_capacity << " keys per shard)." << std::endl;
+    }
+    if (config.hot_key_replication &&
+        shared_cache.enableHotKeyReplication(std::chrono::seconds(config.hot_key_replica_interval_seconds),
+                                             config.hot_key_replica_min_rate, config.hot_key_replica_max_keys)) {
+        std::cout << "Hot-key replication enabled (keys at " << config.hot_key_replica_min_rate
+                  << " ops/s and up, " << config.hot_key_replica_max_keys << " per shard)." << std::endl;
+    }
+
+    if (config.thread_per_core) {
+        shared_cache.startThreadPerCore(core_cpus);
+        std::cout << "Core event loops started." << std::endl;
+    }
+
+    if (config.arena_region_kb > 0 && config.arena_compact_interval_seconds > 0) {
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            shard.startArenaCompactor(std::chrono::seconds(config.arena_compact_interval_seconds),
+                                      config.arena_compact_live_ratio);
+        });
+        std::cout << "Arena compactor running every " << config.arena_compact_interval_seconds << "s." << std::endl;
+    }
+    if (config.slab_memory_mb > 0 && config.slab_rebalance_interval_seconds > 0) {
+        shared_cache.forEachShard([&](LRUCache& shard) {
+            shard.startSlabRebalancer(std::chrono::seconds(config.slab_rebalance_interval_seconds));
+        });
+        std::cout << "Slab rebalancer running every " << config.slab_rebalance_interval_seconds << "s." << std::endl;
     }
-    shared_cache.setWalStream(&wal_file_stream);
-    std::cout << "WAL stream attached to cache instance." << std::endl;
 
     // --- Run the gRPC server using loaded config ---
     RunServer(shared_cache, config); // Pass the config struct
+    RequestTracer::stop(); // Writes the traces still queued
 
     std::cout << "Server shutting down." << std::endl;
     return 0;
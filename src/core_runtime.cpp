@@ -0,0 +1,173 @@
+#include "core_runtime.h"
+#include <iostream>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+static thread_local int tls_current_core = -1;
+static std::atomic<std::uint64_t> next_runtime_id{1};
+
+// --- Constructor / Destructor ---
+CoreRuntime::CoreRuntime(std::size_t cores, const std::vector<int>& cpus)
+    : id_(next_runtime_id++), cores_(cores == 0 ? 1 : cores), slots_(kMaxProducers) {
+    for (auto& slot : slots_) {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+    for (auto& core : cores_) {
+        core.wake_fd = ::eventfd(0, EFD_CLOEXEC);
+        if (core.wake_fd < 0) {
+            std::cerr << "Warning: eventfd failed; idle cores will keep polling." << std::endl;
+        }
+    }
+    for (std::size_t i = 0; i < cores_.size(); ++i) {
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        cores_[i].thread = std::thread(&CoreRuntime::coreLoop, this, i, cpu);
+    }
+}
+
+CoreRuntime::~CoreRuntime() {
+    stop_ = true;
+    for (std::size_t i = 0; i < cores_.size(); ++i) {
+        wake(i);
+    }
+    for (auto& core : cores_) {
+        if (core.thread.joinable()) {
+            core.thread.join();
+        }
+        if (core.wake_fd >= 0) {
+            ::close(core.wake_fd);
+        }
+    }
+    for (auto& slot : slots_) {
+        delete slot.load();
+    }
+}
+
+int CoreRuntime::currentCore() {
+    return tls_current_core;
+}
+
+// --- Producer Side ---
+// Each submitting thread claims its own slot on first use; threads beyond
+// kMaxProducers share slots under the slot's busy flag.
+CoreRuntime::ProducerSlot& CoreRuntime::producerSlot() {
+    thread_local std::uint64_t owner = 0;
+    thread_local ProducerSlot* slot = nullptr;
+    if (owner != id_) {
+        std::size_t index = next_slot_.fetch_add(1) % kMaxProducers;
+        ProducerSlot* existing = slots_[index].load(std::memory_order_acquire);
+        if (existing == nullptr) {
+            auto fresh = std::make_unique<ProducerSlot>();
+            for (std::size_t c = 0; c < cores_.size(); ++c) {
+                fresh->rings.push_back(std::make_unique<SpscQueue<Task*>>(kRingCapacity));
+            }
+            if (slots_[index].compare_exchange_strong(existing, fresh.get(), std::memory_order_acq_rel)) {
+                existing = fresh.release();
+            }
+        }
+        owner = id_;
+        slot = existing;
+    }
+    return *slot;
+}
+
+void CoreRuntime::submit(std::size_t core, Task* task) {
+    ProducerSlot& slot = producerSlot();
+    while (slot.busy.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield(); // Only contended when threads outnumber slots
+    }
+    while (!slot.rings[core]->tryPush(task)) {
+        std::this_thread::yield(); // Ring full: the core is behind
+    }
+    slot.busy.clear(std::memory_order_release);
+    // Pairs with the fence in coreLoop: either the core sees the task before
+    // it blocks, or this thread sees it sleeping and signals it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (cores_[core].sleeping.load(std::memory_order_relaxed)) {
+        wake(core);
+    }
+
+    // Wait for the owning core. A core thread keeps draining its own rings
+    // meanwhile so two cores calling each other make progress.
+    int self = currentCore();
+    unsigned spins = 0;
+    while (!task->done.load(std::memory_order_acquire)) {
+        if (self >= 0) {
+            pollOnce(static_cast<std::size_t>(self));
+        } else if (++spins > 64) {
+            std::this_thread::yield();
+        }
+    }
+    if (task->error) {
+        std::rethrow_exception(task->error);
+    }
+}
+
+void CoreRuntime::wake(std::size_t core) {
+    std::uint64_t one = 1;
+    if (cores_[core].wake_fd >= 0 && ::write(cores_[core].wake_fd, &one, sizeof(one)) < 0) {
+        // Counter is saturated, so the core is already due to wake
+    }
+}
+
+// --- Core Side ---
+// Executes everything currently queued for `core`. Returns true if any
+// task ran. Exceptions are handed back to the submitter through the task.
+bool CoreRuntime::pollOnce(std::size_t core) {
+    bool ran = false;
+    std::size_t producers = std::min(next_slot_.load(std::memory_order_acquire), kMaxProducers);
+    for (std::size_t s = 0; s < producers; ++s) {
+        ProducerSlot* slot = slots_[s].load(std::memory_order_acquire);
+        if (slot == nullptr) continue; // Claimed but not yet published
+        Task* task = nullptr;
+        while (slot->rings[core]->tryPop(task)) {
+            try {
+                task->invoke(task->ctx);
+            } catch (...) {
+                task->error = std::current_exception();
+            }
+            task->done.store(true, std::memory_order_release);
+            ran = true;
+        }
+    }
+    return ran;
+}
+
+void CoreRuntime::coreLoop(std::size_t core, int cpu) {
+    tls_current_core = static_cast<int>(core);
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) != 0) {
+            std::cerr << "Warning: Failed to pin core " << core << " to CPU " << cpu << "." << std::endl;
+        }
+    }
+
+    // Busy-poll while there is traffic; block on the eventfd once idle
+    Core& self = cores_[core];
+    unsigned idle_rounds = 0;
+    while (!stop_.load(std::memory_order_relaxed)) {
+        if (pollOnce(core)) {
+            idle_rounds = 0;
+        } else if (++idle_rounds < 1000 || self.wake_fd < 0) {
+            std::this_thread::yield();
+        } else {
+            self.sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // Re-check after announcing the sleep so a task pushed just
+            // before it is not left waiting for the next submit
+            if (!pollOnce(core) && !stop_.load(std::memory_order_relaxed)) {
+                std::uint64_t count = 0;
+                if (::read(self.wake_fd, &count, sizeof(count)) < 0) {
+                    // EINTR; the loop polls again either way
+                }
+            }
+            self.sleeping.store(false, std::memory_order_relaxed);
+            idle_rounds = 0;
+        }
+    }
+    pollOnce(core); // Drain anything submitted during shutdown
+}
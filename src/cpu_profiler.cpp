@@ -0,0 +1,205 @@
+#include "cpu_profiler.h"
+#include "symbolizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace {
+constexpr int kMaxDepth = 48;
+constexpr std::size_t kMaxSamples = 1 << 16;   // About 25 MB of stacks at most
+constexpr unsigned kMaxFrequencyHz = 1000;
+constexpr std::uintptr_t kMaxFrameBytes = 256 * 1024; // Larger gaps between frame records end the walk
+constexpr std::uintptr_t kPageBytes = 4096;
+
+struct StackSample {
+    int depth;
+    void* frames[kMaxDepth]; // Interrupted instruction, then return addresses
+};
+
+// --- State Shared with the Signal Handler (lock-free atomics only) ---
+std::atomic<StackSample*> g_buffer{nullptr};
+std::atomic<std::size_t> g_capacity{0};
+std::atomic<std::size_t> g_next{0};
+std::atomic<int> g_in_handler{0}; // Handlers that may still touch g_buffer
+std::atomic<bool> g_running{false};
+
+// True if the page holding address can be read. rt_sigprocmask copies the
+// new mask in before it rejects the invalid `how`, so it fails with EFAULT
+// for an unmapped page instead of faulting. A plain syscall, safe in a
+// signal handler.
+bool readablePage(std::uintptr_t address) {
+    return ::syscall(SYS_rt_sigprocmask, ~0, reinterpret_cast<void*>(address), nullptr, sizeof(std::uint64_t)) == -1 &&
+           errno == EINVAL;
+}
+
+// Walks the frame-pointer chain of the interrupted thread. backtrace() is
+// not async-signal-safe (the unwinder takes locks and may allocate), so
+// the handler follows the saved frame pointers itself: each record must
+// lie above the previous one, within kMaxFrameBytes, aligned, and on a
+// readable page. Frames compiled without frame pointers end the walk early.
+int walkStack(const ucontext_t* uc, void** frames) {
+#if defined(__x86_64__)
+    std::uintptr_t pc = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+    std::uintptr_t fp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+    std::uintptr_t sp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__aarch64__)
+    std::uintptr_t pc = uc->uc_mcontext.pc;
+    std::uintptr_t fp = uc->uc_mcontext.regs[29];
+    std::uintptr_t sp = uc->uc_mcontext.sp;
+#else
+    std::uintptr_t pc = 0, fp = 0, sp = 0;
+    (void)uc;
+#endif
+    if (pc == 0) return 0;
+    int depth = 0;
+    frames[depth++] = reinterpret_cast<void*>(pc);
+    std::uintptr_t lower = sp;
+    std::uintptr_t checked_page = 0; // Last page found readable
+    while (depth < kMaxDepth) {
+        // A frame record is {saved frame pointer, return address}
+        if (fp < lower || fp - lower > kMaxFrameBytes || fp % sizeof(void*) != 0) break;
+        std::uintptr_t first_page = fp & ~(kPageBytes - 1);
+        std::uintptr_t last_page = (fp + 2 * sizeof(void*) - 1) & ~(kPageBytes - 1);
+        if (first_page != checked_page && !readablePage(first_page)) break;
+        if (last_page != first_page && !readablePage(last_page)) break;
+        checked_page = last_page;
+        const std::uintptr_t* record = reinterpret_cast<const std::uintptr_t*>(fp);
+        std::uintptr_t return_address = record[1];
+        if (return_address == 0) break;
+        frames[depth++] = reinterpret_cast<void*>(return_address);
+        lower = fp + 2 * sizeof(void*);
+        fp = record[0];
+    }
+    return depth;
+}
+
+void onSigprof(int, siginfo_t*, void* context) {
+    int saved_errno = errno;
+    g_in_handler.fetch_add(1); // Sequentially consistent with profile()'s g_buffer reset
+    StackSample* buffer = g_buffer.load();
+    if (buffer) {
+        std::size_t index = g_next.fetch_add(1, std::memory_order_relaxed);
+        if (index < g_capacity.load(std::memory_order_relaxed)) {
+            buffer[index].depth = walkStack(static_cast<const ucontext_t*>(context), buffer[index].frames);
+        }
+    }
+    g_in_handler.fetch_sub(1);
+    errno = saved_errno;
+}
+
+bool installHandler() {
+    static const bool installed = [] {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = onSigprof;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        return sigaction(SIGPROF, &action, nullptr) == 0;
+    }();
+    return installed;
+}
+
+// --- Folding ---
+class FrameNames {
+public:
+    // Return addresses point after their call, which may be past the end of
+    // the calling function, so callers are looked up one byte earlier
+    const std::string& name(void* address, bool is_return_address) {
+        void* lookup = is_return_address ? static_cast<char*>(address) - 1 : address;
+        auto it = names_.find(lookup);
+        if (it == names_.end()) {
+            std::string name = functionName(lookup);
+            it = names_.emplace(lookup, name.empty() ? moduleOffset(lookup) : std::move(name)).first;
+        }
+        return it->second;
+    }
+
+private:
+    std::unordered_map<void*, std::string> names_;
+};
+
+// Outermost frame first, joined with ';'
+std::string foldStack(const StackSample& sample, FrameNames& names) {
+    std::string stack;
+    for (int i = 0; i < sample.depth; ++i) {
+        const std::string& frame = names.name(sample.frames[i], i != 0);
+        stack = stack.empty() ? frame : frame + ";" + stack;
+    }
+    return stack;
+}
+} // namespace
+
+ProfileResult CpuProfiler::profile(std::chrono::milliseconds duration, unsigned frequency_hz, CpuProfile* result) {
+    bool expected = false;
+    if (!g_running.compare_exchange_strong(expected, true)) {
+        return ProfileResult::Busy;
+    }
+    if (!installHandler()) {
+        g_running.store(false);
+        return ProfileResult::TimerFailed;
+    }
+    frequency_hz = std::min(std::max(frequency_hz, 1u), kMaxFrequencyHz);
+
+    // At most every CPU busy for the whole run; zeroed now so the handler
+    // never faults a page in
+    double expected_samples = static_cast<double>(frequency_hz) * std::max(1u, std::thread::hardware_concurrency()) *
+                              std::chrono::duration<double>(duration).count();
+    std::size_t capacity = std::min(kMaxSamples, static_cast<std::size_t>(expected_samples) + 64);
+    std::vector<StackSample> buffer(capacity);
+    g_capacity.store(capacity);
+    g_next.store(0);
+    g_buffer.store(buffer.data());
+
+    long interval_us = 1000000L / frequency_hz;
+    itimerval timer;
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+    bool armed = setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+    if (armed) {
+        std::this_thread::sleep_for(duration); // This thread sleeps, so it is never sampled itself
+        itimerval off;
+        std::memset(&off, 0, sizeof(off));
+        setitimer(ITIMER_PROF, &off, nullptr);
+    }
+    // A signal already in flight finds the buffer gone; one already past
+    // that check is waited for
+    g_buffer.store(nullptr);
+    while (g_in_handler.load() != 0) {
+        std::this_thread::yield();
+    }
+    if (!armed) {
+        g_running.store(false);
+        return ProfileResult::TimerFailed;
+    }
+
+    std::size_t taken = std::min(g_next.load(), capacity);
+    result->samples = taken;
+    result->dropped = g_next.load() - taken;
+    FrameNames names;
+    std::unordered_map<std::string, std::uint64_t> stacks;
+    for (std::size_t i = 0; i < taken; ++i) {
+        if (buffer[i].depth > 0) {
+            ++stacks[foldStack(buffer[i], names)];
+        }
+    }
+    std::vector<std::pair<std::string, std::uint64_t>> sorted(stacks.begin(), stacks.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    result->folded.clear();
+    for (const auto& stack : sorted) {
+        result->folded += stack.first + " " + std::to_string(stack.second) + "\n";
+    }
+    g_running.store(false);
+    return ProfileResult::Ok;
+}
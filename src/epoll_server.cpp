@@ -0,0 +1,259 @@
+#include "epoll_server.h"
+#include <iostream>
+#include <cstring>
+#include <unordered_map>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+constexpr std::size_t kReadBudget = 1024 * 1024;           // Bytes read per connection per wakeup
+constexpr std::size_t kMaxPendingOutput = 4 * 1024 * 1024; // Stop reading while this much is unsent
+}
+
+// --- Constructor / Destructor ---
+EpollServer::EpollServer(std::string name) : name_(std::move(name)) {}
+
+EpollServer::~EpollServer() {
+    // Subclasses stop the loops in their own destructors so onData is never
+    // dispatched into a partially destroyed object; this is a safety net.
+    stop();
+}
+
+// --- Socket Setup ---
+int EpollServer::openListener(const std::string& address, bool reuse_port) {
+    int fd = -1;
+    if (address.rfind("unix:", 0) == 0) {
+        std::string path = address.substr(5);
+        sockaddr_un addr{};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "[" << name_ << "] Invalid unix socket path: " << path << std::endl;
+            return -1;
+        }
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        ::unlink(path.c_str()); // Remove a stale socket from a previous run
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            std::cerr << "[" << name_ << "] bind(" << path << ") failed: " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return -1;
+        }
+        unix_path_ = path;
+    } else {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            std::cerr << "[" << name_ << "] Invalid listen address: " << address << std::endl;
+            return -1;
+        }
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* result = nullptr;
+        if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0) {
+            std::cerr << "[" << name_ << "] Cannot resolve listen address: " << address << std::endl;
+            return -1;
+        }
+        for (addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (reuse_port) {
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+            }
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            ::close(fd);
+            fd = -1;
+        }
+        ::freeaddrinfo(result);
+        if (fd < 0) {
+            std::cerr << "[" << name_ << "] bind(" << address << ") failed: " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+    }
+    if (::listen(fd, SOMAXCONN) != 0) {
+        std::cerr << "[" << name_ << "] listen failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// --- Start / Stop ---
+bool EpollServer::start(const std::string& address, std::size_t threads) {
+    bool is_unix = address.rfind("unix:", 0) == 0;
+    if (threads == 0 || is_unix) threads = 1;
+    stopping_ = false;
+    for (std::size_t i = 0; i < threads; ++i) {
+        auto loop = std::make_unique<Loop>();
+        loop->listen_fd = openListener(address, /*reuse_port=*/threads > 1);
+        loop->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->listen_fd < 0 || loop->epoll_fd < 0 || loop->wake_fd < 0) {
+            for (int fd : {loop->listen_fd, loop->epoll_fd, loop->wake_fd}) {
+                if (fd >= 0) ::close(fd);
+            }
+            stop();
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->listen_fd;
+        ::epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->listen_fd, &ev);
+        ev.data.fd = loop->wake_fd;
+        ::epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+        loops_.push_back(std::move(loop));
+    }
+    for (auto& loop : loops_) {
+        Loop* raw = loop.get();
+        loop->thread = std::thread([this, raw] { run(*raw); });
+    }
+    std::cout << "[" << name_ << "] Listening on " << address << " (" << threads << " loop thread"
+              << (threads == 1 ? "" : "s") << ")" << std::endl;
+    return true;
+}
+
+void EpollServer::stop() {
+    stopping_ = true;
+    for (auto& loop : loops_) {
+        std::uint64_t one = 1;
+        if (loop->wake_fd >= 0 && ::write(loop->wake_fd, &one, sizeof(one)) < 0) {
+            // Loop will still notice stopping_ on its next wakeup
+        }
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) loop->thread.join();
+        ::close(loop->listen_fd);
+        ::close(loop->epoll_fd);
+        ::close(loop->wake_fd);
+    }
+    loops_.clear();
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+        unix_path_.clear();
+    }
+}
+
+// --- I/O ---
+// Writes as much of conn.out as the socket takes. Returns false on error.
+bool EpollServer::flush(Connection& conn) {
+    while (!conn.out.empty()) {
+        ssize_t n = ::send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out.erase(0, static_cast<size_t>(n));
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true; // Wait for EPOLLOUT
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EpollServer::run(Loop& loop) {
+    std::unordered_map<int, Connection> connections;
+    std::vector<epoll_event> events(256);
+    char buffer[64 * 1024];
+
+    auto closeConnection = [&](int fd) {
+        ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    };
+
+    while (!stopping_) {
+        int ready = ::epoll_wait(loop.epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[" << name_ << "] epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == loop.wake_fd) {
+                continue; // stop() was called; loop condition handles it
+            }
+            if (fd == loop.listen_fd) {
+                // Accept everything pending
+                while (true) {
+                    int client = ::accept4(loop.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (client < 0) break;
+                    int one = 1;
+                    ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // No-op for unix sockets
+                    epoll_event ev{};
+                    ev.events = EPOLLIN | EPOLLRDHUP;
+                    ev.data.fd = client;
+                    ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, client, &ev);
+                    connections[client].fd = client;
+                    connections[client].watched_events = ev.events;
+                }
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            Connection& conn = it->second;
+
+            if (!conn.peer_closed && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                // Read up to kReadBudget, parsing after every read so pipelined
+                // requests are batched while conn.in holds at most one partial
+                // request. Level-triggered epoll reports the rest next round.
+                std::size_t read_bytes = 0;
+                while (read_bytes < kReadBudget && !conn.close_after_write && conn.out.size() < kMaxPendingOutput) {
+                    ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                    if (n > 0) {
+                        read_bytes += static_cast<size_t>(n);
+                        conn.in.append(buffer, static_cast<size_t>(n));
+                        std::size_t consumed = onData(conn);
+                        conn.in.erase(0, consumed);
+                    } else if (n == 0) {
+                        conn.peer_closed = true;
+                        break;
+                    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        break;
+                    } else if (errno != EINTR) {
+                        conn.peer_closed = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!flush(conn) || (conn.close_after_write && conn.out.empty()) || (conn.peer_closed && conn.out.empty())) {
+                closeConnection(fd);
+                continue;
+            }
+            // Read only while the peer is open and replies are not backing up,
+            // and ask for EPOLLOUT only while replies are pending. A half-closed
+            // peer keeps reporting EPOLLIN/EPOLLRDHUP, so it is watched for
+            // EPOLLOUT alone until its replies are flushed.
+            unsigned want = conn.out.empty() ? 0u : static_cast<unsigned>(EPOLLOUT);
+            if (!conn.peer_closed && !conn.close_after_write && conn.out.size() < kMaxPendingOutput) {
+                want |= EPOLLIN | EPOLLRDHUP;
+            }
+            if (want != conn.watched_events) {
+                epoll_event ev{};
+                ev.events = want;
+                ev.data.fd = fd;
+                ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+                conn.watched_events = want;
+            }
+        }
+    }
+
+    for (auto& entry : connections) {
+        ::close(entry.first);
+    }
+}
@@ -0,0 +1,236 @@
+#include "flash_tier.h"
+#include "lru_cache.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// On-flash record: header, then key bytes, then value bytes
+struct RecordHeader {
+    std::uint32_t key_len;
+    std::uint32_t value_len;
+    std::uint32_t raw_length; // See FlashRecord
+    std::uint32_t reserved;
+    std::int64_t expires_at_ms;
+    std::int64_t stale_after_ms;
+};
+
+std::int64_t nowUnixMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+// --- Constructor / Destructor ---
+FlashTier::FlashTier(std::size_t region_bytes, std::size_t region_count) : region_bytes_(region_bytes) {
+    if (region_bytes_ < 64 * 1024) {
+        std::cerr << "Warning: Flash region size " << region_bytes_ << " too small. Using 64 KB." << std::endl;
+        region_bytes_ = 64 * 1024;
+    }
+    if (region_bytes_ > UINT32_MAX) {
+        region_bytes_ = UINT32_MAX; // Offsets are 32-bit
+    }
+    if (region_count < 2) {
+        std::cerr << "Warning: Flash tier needs at least 2 regions. Using 2." << std::endl;
+        region_count = 2;
+    }
+    regions_.resize(region_count);
+}
+
+FlashTier::~FlashTier() {
+    if (writer_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(write_mtx_);
+            stopping_ = true;
+        }
+        write_cv_.notify_all();
+        writer_.join(); // Finishes a pending write first
+    }
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool FlashTier::open(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        std::cerr << "ERROR: Could not open flash tier file '" << path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    buffer_.resize(region_bytes_);
+    sealed_.resize(region_bytes_);
+    rebuildFilter();
+    writer_ = std::thread(&FlashTier::writerLoop, this);
+    return true;
+}
+
+std::uint64_t FlashTier::hashKey(const std::string& key) {
+    return LRUCache::hashKey(key); // Same hash as the RAM index
+}
+
+// --- Log Management ---
+// Assumes the cache mutex is held. Blocks only if the previous region is
+// still being written, i.e. flash has fallen a whole region behind.
+bool FlashTier::sealActive() {
+    bool failed = waitForWrite();
+    if (failed && sealed_region_ != UINT32_MAX) {
+        reclaim(sealed_region_); // Its records never reached flash
+    }
+    sealed_region_ = UINT32_MAX;
+    if (buffer_used_ > 0) {
+        std::swap(buffer_, sealed_);
+        sealed_used_ = buffer_used_;
+        sealed_region_ = active_;
+        {
+            std::lock_guard<std::mutex> lock(write_mtx_);
+            write_pending_ = true;
+        }
+        write_cv_.notify_all();
+    }
+    region_records_ = std::max(region_records_, regions_[active_].hashes.size());
+    active_ = static_cast<std::uint32_t>((active_ + 1) % regions_.size());
+    reclaim(active_); // FIFO: the oldest region is overwritten next
+    buffer_used_ = 0;
+    rebuildFilter();
+    return !failed;
+}
+
+bool FlashTier::waitForWrite() {
+    std::unique_lock<std::mutex> lock(write_mtx_);
+    write_cv_.wait(lock, [this] { return !write_pending_; });
+    bool failed = write_failed_;
+    write_failed_ = false;
+    return failed;
+}
+
+// Writes each sealed buffer out. sealed_ and sealed_region_ are only
+// changed by sealActive after the previous write has completed.
+void FlashTier::writerLoop() {
+    std::unique_lock<std::mutex> lock(write_mtx_);
+    while (true) {
+        write_cv_.wait(lock, [this] { return write_pending_ || stopping_; });
+        if (!write_pending_) {
+            return;
+        }
+        lock.unlock();
+        off_t position = static_cast<off_t>(sealed_region_) * static_cast<off_t>(region_bytes_);
+        bool written = ::pwrite(fd_, sealed_.data(), sealed_used_, position) == static_cast<ssize_t>(sealed_used_);
+        if (!written) {
+            std::cerr << "ERROR: Flash tier write failed: " << std::strerror(errno) << std::endl;
+        }
+        lock.lock();
+        write_failed_ = !written;
+        write_pending_ = false;
+        write_cv_.notify_all();
+    }
+}
+
+// Drops the bits of every key that left the tier. Sized for the current
+// index plus headroom for the region about to be filled.
+void FlashTier::rebuildFilter() {
+    filter_.reset(index_.size() + 2 * region_records_ + 1024);
+    for (const auto& entry : index_) {
+        filter_.add(entry.first);
+    }
+}
+
+void FlashTier::reclaim(std::uint32_t region) {
+    for (std::uint64_t hash : regions_[region].hashes) {
+        auto it = index_.find(hash);
+        if (it != index_.end() && it->second.region == region) {
+            index_.erase(it);
+        }
+    }
+    regions_[region].hashes.clear();
+}
+
+// --- Access ---
+bool FlashTier::append(const std::string& key, const std::string& value, std::uint32_t raw_length,
+                       std::int64_t expires_at_ms, std::int64_t stale_after_ms) {
+    if (fd_ < 0) return false;
+    std::size_t length = sizeof(RecordHeader) + key.size() + value.size();
+    if (length > region_bytes_) {
+        return false; // Larger than a region
+    }
+    if (buffer_used_ + length > region_bytes_ && !sealActive()) {
+        return false;
+    }
+
+    RecordHeader header{static_cast<std::uint32_t>(key.size()), static_cast<std::uint32_t>(value.size()),
+                        raw_length, 0, expires_at_ms, stale_after_ms};
+    char* out = buffer_.data() + buffer_used_;
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + sizeof(header), key.data(), key.size());
+    std::memcpy(out + sizeof(header) + key.size(), value.data(), value.size());
+
+    std::uint64_t hash = hashKey(key);
+    filter_.add(hash);
+    index_[hash] = Location{active_, static_cast<std::uint32_t>(buffer_used_), static_cast<std::uint32_t>(length)};
+    regions_[active_].hashes.push_back(hash);
+    buffer_used_ += length;
+    return true;
+}
+
+bool FlashTier::readRecord(const Location& location, std::string& out) {
+    out.resize(location.length);
+    if (location.region == active_) {
+        std::memcpy(&out[0], buffer_.data() + location.offset, location.length); // Not written out yet
+        return true;
+    }
+    if (location.region == sealed_region_) {
+        std::memcpy(&out[0], sealed_.data() + location.offset, location.length); // Possibly still being written
+        return true;
+    }
+    off_t position = static_cast<off_t>(location.region) * static_cast<off_t>(region_bytes_) + location.offset;
+    reads_++;
+    return ::pread(fd_, &out[0], location.length, position) == static_cast<ssize_t>(location.length);
+}
+
+std::optional<FlashRecord> FlashTier::take(const std::string& key) {
+    std::uint64_t hash = hashKey(key);
+    if (!filter_.mayContain(hash)) {
+        filtered_++;
+        return std::nullopt;
+    }
+    auto it = index_.find(hash);
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    std::string raw;
+    if (!readRecord(it->second, raw)) {
+        std::cerr << "ERROR: Flash tier read failed: " << std::strerror(errno) << std::endl;
+        index_.erase(it);
+        return std::nullopt;
+    }
+    RecordHeader header;
+    std::memcpy(&header, raw.data(), sizeof(header));
+    if (header.key_len != key.size() || raw.compare(sizeof(header), header.key_len, key) != 0) {
+        return std::nullopt; // Another key with the same hash
+    }
+    index_.erase(it); // Promoted to RAM, or dead
+    std::int64_t now = nowUnixMs();
+    if ((header.expires_at_ms != 0 && now >= header.expires_at_ms) ||
+        (header.stale_after_ms != 0 && now >= header.stale_after_ms)) {
+        return std::nullopt;
+    }
+    hits_++;
+    FlashRecord record;
+    record.value = raw.substr(sizeof(header) + header.key_len, header.value_len);
+    record.raw_length = header.raw_length;
+    record.expires_at_ms = header.expires_at_ms;
+    return record;
+}
+
+bool FlashTier::erase(const std::string& key) {
+    // Dropping by hash alone may also drop a colliding key's record; it is
+    // only a cache, so that costs a miss, never a wrong value
+    std::uint64_t hash = hashKey(key);
+    return filter_.mayContain(hash) && index_.erase(hash) > 0;
+}
+
+bool FlashTier::contains(const std::string& key) const {
+    std::uint64_t hash = hashKey(key);
+    return filter_.mayContain(hash) && index_.count(hash) > 0;
+}
@@ -0,0 +1,85 @@
+#include "hot_key_replicas.h"
+#include <algorithm>
+#include <thread>
+#include <sched.h>
+
+HotKeyReplicas::HotKeyReplicas(std::size_t tables)
+    : table_count_(tables != 0 ? tables : std::max(1u, std::thread::hardware_concurrency())) {
+    tables_ = std::make_unique<Table[]>(table_count_);
+}
+
+HotKeyReplicas::Table& HotKeyReplicas::local() {
+    int cpu = sched_getcpu();
+    return tables_[cpu < 0 ? 0 : static_cast<std::size_t>(cpu) % table_count_];
+}
+
+HotKeyReplicas::Lookup HotKeyReplicas::get(const std::string& key, std::shared_ptr<const std::string>* value) {
+    Table& table = local();
+    std::lock_guard<std::mutex> lock(table.mtx);
+    auto it = table.copies.find(key);
+    if (it == table.copies.end()) {
+        return Lookup::NotHot;
+    }
+    Copy& copy = it->second;
+    if (!copy.value || copy.filled_version != copy.version->value.load(std::memory_order_acquire) ||
+        std::chrono::steady_clock::now() >= copy.valid_until) {
+        return Lookup::Stale;
+    }
+    ++copy.hits;
+    *value = copy.value;
+    return Lookup::Hit;
+}
+
+void HotKeyReplicas::fill(const std::string& key, std::uint64_t version, std::shared_ptr<const std::string> value,
+                          std::int64_t expires_at_ms) {
+    auto now = std::chrono::steady_clock::now();
+    auto valid_until = now + kRefreshInterval;
+    if (expires_at_ms != 0) {
+        auto remaining = std::chrono::milliseconds(
+            expires_at_ms - std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::system_clock::now().time_since_epoch()).count());
+        valid_until = std::min(valid_until, now + remaining);
+    }
+    Table& table = local();
+    std::lock_guard<std::mutex> lock(table.mtx);
+    auto it = table.copies.find(key);
+    if (it == table.copies.end()) {
+        return; // Demoted while the shard was read
+    }
+    Copy& copy = it->second;
+    if (copy.version->value.load(std::memory_order_acquire) != version) {
+        return; // Written (or demoted and promoted again) since the shard was read
+    }
+    copy.filled_version = version;
+    copy.value = std::move(value);
+    copy.valid_until = valid_until;
+}
+
+void HotKeyReplicas::promote(const std::string& key, std::shared_ptr<HotKeyVersion> version) {
+    for (std::size_t i = 0; i < table_count_; ++i) {
+        std::lock_guard<std::mutex> lock(tables_[i].mtx);
+        tables_[i].copies[key].version = version;
+    }
+    promoted_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HotKeyReplicas::demote(const std::string& key) {
+    for (std::size_t i = 0; i < table_count_; ++i) {
+        std::lock_guard<std::mutex> lock(tables_[i].mtx);
+        tables_[i].copies.erase(key);
+    }
+    promoted_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::uint64_t HotKeyReplicas::takeHits(const std::string& key) {
+    std::uint64_t hits = 0;
+    for (std::size_t i = 0; i < table_count_; ++i) {
+        std::lock_guard<std::mutex> lock(tables_[i].mtx);
+        auto it = tables_[i].copies.find(key);
+        if (it != tables_[i].copies.end()) {
+            hits += it->second.hits;
+            it->second.hits = 0;
+        }
+    }
+    return hits;
+}
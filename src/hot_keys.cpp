@@ -0,0 +1,165 @@
+#include "hot_keys.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Sampled accesses between checks for the end of the window
+constexpr unsigned kClockCheckInterval = 64;
+
+HotKeySketch::HotKeySketch(std::size_t capacity, std::uint32_t sample_rate, std::chrono::seconds window)
+    : capacity_(std::max<std::size_t>(capacity, 1)),
+      sample_rate_(std::max<std::uint32_t>(sample_rate, 1)),
+      window_(std::max(window, std::chrono::seconds(1))),
+      rng_(0x9E3779B97F4A7C15ull ^ reinterpret_cast<std::uintptr_t>(this)),
+      window_start_(std::chrono::steady_clock::now()) {
+    heap_.reserve(capacity_);
+    slots_.reserve(capacity_);
+    skip_ = nextSkip();
+}
+
+// Gap to the next sampled access: geometric with p = 1/sample_rate, the
+// same distribution as flipping a coin per access
+std::uint64_t HotKeySketch::nextSkip() {
+    if (sample_rate_ == 1) {
+        return 1;
+    }
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 7;
+    rng_ ^= rng_ << 17;
+    double u = (static_cast<double>(rng_ >> 11) + 1.0) / 9007199254740992.0; // (0, 1]
+    return 1 + static_cast<std::uint64_t>(std::log(u) / std::log1p(-1.0 / sample_rate_));
+}
+
+void HotKeySketch::offer(const std::string& key) {
+    if (until_clock_check_ == 0) {
+        until_clock_check_ = kClockCheckInterval;
+        rotateIfDue(std::chrono::steady_clock::now());
+    }
+    --until_clock_check_;
+
+    auto it = slots_.find(key);
+    if (it != slots_.end()) {
+        ++heap_[it->second].count;
+        siftDown(it->second);
+        return;
+    }
+    if (heap_.size() < capacity_) {
+        auto inserted = slots_.emplace(key, heap_.size()).first;
+        heap_.push_back(Entry{&inserted->first, &inserted->second, 1, 0});
+        siftUp(heap_.size() - 1);
+        return;
+    }
+    // Replace the least counted key; its count bounds the newcomer's error.
+    // Relinking the victim's node under the new key keeps the entry's
+    // pointers valid and saves an allocation.
+    Entry& victim = heap_[0];
+    auto node = slots_.extract(*victim.key);
+    node.key() = key;
+    slots_.insert(std::move(node));
+    victim.error = victim.count;
+    ++victim.count;
+    siftDown(0);
+}
+
+void HotKeySketch::rotateIfDue(std::chrono::steady_clock::time_point now) {
+    if (now - window_start_ < window_) {
+        return;
+    }
+    previous_.clear();
+    for (const Entry& entry : heap_) {
+        previous_.push_back(Counted{*entry.key, entry.count, entry.error});
+    }
+    previous_span_ = now - window_start_;
+    heap_.clear();
+    slots_.clear();
+    window_start_ = now;
+}
+
+std::vector<HotKeyEstimate> HotKeySketch::top(std::size_t limit) {
+    auto now = std::chrono::steady_clock::now();
+    rotateIfDue(now);
+
+    // A key's count over the span is the sum of its counts in both windows.
+    // A key missing from a full window was seen there at most as often as
+    // that window's least counted key, so that count is added as both
+    // count and error (an overestimate, like every space-saving count).
+    auto floor = [this](const auto& entries) -> std::uint64_t {
+        if (entries.size() < capacity_) return 0; // Never full: every sampled key is present
+        std::uint64_t lowest = entries.front().count;
+        for (const auto& entry : entries) lowest = std::min(lowest, entry.count);
+        return lowest;
+    };
+    std::uint64_t current_floor = floor(heap_);
+    std::uint64_t previous_floor = floor(previous_);
+
+    std::unordered_map<std::string, HotKeyEstimate> merged;
+    for (const Entry& entry : heap_) {
+        HotKeyEstimate& estimate = merged[*entry.key];
+        estimate.key = *entry.key;
+        estimate.count = entry.count + previous_floor;
+        estimate.error = entry.error + previous_floor;
+    }
+    for (const Counted& entry : previous_) {
+        auto inserted = merged.emplace(entry.key, HotKeyEstimate{});
+        HotKeyEstimate& estimate = inserted.first->second;
+        if (inserted.second) {
+            estimate.key = entry.key;
+            estimate.count = entry.count + current_floor;
+            estimate.error = entry.error + current_floor;
+        } else {
+            estimate.count += entry.count - previous_floor; // Replace the floor added above
+            estimate.error += entry.error - previous_floor;
+        }
+    }
+
+    std::vector<HotKeyEstimate> keys;
+    keys.reserve(merged.size());
+    for (auto& entry : merged) {
+        keys.push_back(std::move(entry.second));
+    }
+    std::size_t count = std::min(limit, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + count, keys.end(),
+                      [](const HotKeyEstimate& a, const HotKeyEstimate& b) { return a.count > b.count; });
+    keys.resize(count);
+
+    double span = std::chrono::duration<double>(previous_span_ + (now - window_start_)).count();
+    for (HotKeyEstimate& estimate : keys) {
+        estimate.count *= sample_rate_;
+        estimate.error *= sample_rate_;
+        estimate.per_second = span > 0 ? static_cast<double>(estimate.count) / span : 0;
+    }
+    return keys;
+}
+
+// --- Heap Maintenance (min-heap on count; slots_ follows every move) ---
+void HotKeySketch::swapSlots(std::size_t a, std::size_t b) {
+    std::swap(heap_[a], heap_[b]);
+    *heap_[a].slot = a;
+    *heap_[b].slot = b;
+}
+
+void HotKeySketch::siftDown(std::size_t index) {
+    for (;;) {
+        std::size_t smallest = index;
+        std::size_t left = 2 * index + 1;
+        std::size_t right = left + 1;
+        if (left < heap_.size() && heap_[left].count < heap_[smallest].count) smallest = left;
+        if (right < heap_.size() && heap_[right].count < heap_[smallest].count) smallest = right;
+        if (smallest == index) {
+            return;
+        }
+        swapSlots(index, smallest);
+        index = smallest;
+    }
+}
+
+void HotKeySketch::siftUp(std::size_t index) {
+    while (index > 0) {
+        std::size_t parent = (index - 1) / 2;
+        if (heap_[parent].count <= heap_[index].count) {
+            return;
+        }
+        swapSlots(index, parent);
+        index = parent;
+    }
+}
@@ -0,0 +1,245 @@
+#include "instrumented_mutex.h"
+#include "metrics.h"
+#include "symbolizer.h"
+#include <algorithm>
+#include <cstdio>
+#include <execinfo.h>
+#include <map>
+
+// Shortest hold worth a backtrace while a lock still has free sample slots
+constexpr std::uint64_t kMinSampledHoldNs = 1000;
+
+namespace {
+
+std::uint64_t elapsedNs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+bool sameSite(const InstrumentedMutex::HolderSample& a, const InstrumentedMutex::HolderSample& b) {
+    return a.depth == b.depth && std::equal(a.frames, a.frames + a.depth, b.frames);
+}
+
+// Folds sample into holders (kSampledHolders slots): same call path keeps
+// the longer hold, otherwise it takes a free slot or evicts the shortest.
+void mergeHolder(InstrumentedMutex::HolderSample* holders, const InstrumentedMutex::HolderSample& sample) {
+    InstrumentedMutex::HolderSample* target = nullptr;
+    for (std::size_t i = 0; i < InstrumentedMutex::kSampledHolders; ++i) {
+        InstrumentedMutex::HolderSample& slot = holders[i];
+        if (slot.samples != 0 && sameSite(slot, sample)) {
+            slot.samples += sample.samples;
+            slot.max_hold_ns = std::max(slot.max_hold_ns, sample.max_hold_ns);
+            return;
+        }
+        // Prefer a free slot, then the shortest hold
+        if (!target || (target->samples != 0 && (slot.samples == 0 || slot.max_hold_ns < target->max_hold_ns))) {
+            target = &slot;
+        }
+    }
+    if (target->samples == 0 || sample.max_hold_ns > target->max_hold_ns) {
+        *target = sample;
+    }
+}
+
+// "Class::method+0x1f", or the raw address when the symbol is not exported
+std::string describeFrame(void* address) {
+    char buffer[32];
+    std::size_t offset = 0;
+    std::string name = functionName(address, &offset);
+    if (name.empty()) {
+        std::snprintf(buffer, sizeof(buffer), "%p", address);
+        return buffer;
+    }
+    std::snprintf(buffer, sizeof(buffer), "+0x%zx", offset);
+    return name + buffer;
+}
+
+// Innermost frames first, skipping unlock() itself and the std::lock_guard
+// / unique_lock frames that are not inlined in debug builds
+std::string describeSite(const InstrumentedMutex::HolderSample& sample) {
+    std::string site;
+    for (int i = 0; i < sample.depth; ++i) {
+        std::string frame = describeFrame(sample.frames[i]);
+        bool wrapper = frame.compare(0, 5, "std::") == 0 || frame.compare(0, 19, "InstrumentedMutex::") == 0;
+        if (site.empty() && wrapper && i + 1 < sample.depth) {
+            continue;
+        }
+        site += site.empty() ? frame : " <- " + frame;
+    }
+    return site;
+}
+
+} // namespace
+
+// Live locks plus the totals of destroyed ones, by name. Constructors,
+// destructors and snapshots lock it; lock() and unlock() never do.
+struct LockRegistry {
+    struct Retired {
+        std::uint64_t acquisitions = 0;
+        std::uint64_t contended = 0;
+        std::uint64_t wait_ns = 0;
+        std::uint64_t hold_ns = 0;
+        std::uint64_t max_hold_ns = 0;
+        InstrumentedMutex::HolderSample holders[InstrumentedMutex::kSampledHolders];
+    };
+
+    std::mutex mtx;
+    std::vector<InstrumentedMutex*> live;
+    std::map<std::string, Retired> retired;
+
+    static LockRegistry& instance() {
+        static LockRegistry* registry = new LockRegistry; // Never destroyed: static locks outlive it otherwise
+        return *registry;
+    }
+
+    // Adds lock's counters to totals (its own mutex held by the caller)
+    static void accumulate(Retired& totals, const InstrumentedMutex& lock) {
+        const InstrumentedMutex::Stats& stats = lock.stats_;
+        totals.acquisitions += stats.acquisitions.load(std::memory_order_relaxed);
+        totals.contended += stats.contended.load(std::memory_order_relaxed);
+        totals.wait_ns += stats.wait_ns.load(std::memory_order_relaxed);
+        totals.hold_ns += stats.hold_ns.load(std::memory_order_relaxed);
+        totals.max_hold_ns = std::max(totals.max_hold_ns, stats.max_hold_ns.load(std::memory_order_relaxed));
+        for (const auto& holder : stats.holders) {
+            if (holder.samples != 0) {
+                mergeHolder(totals.holders, holder);
+            }
+        }
+    }
+};
+
+// --- InstrumentedMutex ---
+InstrumentedMutex::InstrumentedMutex(const char* name) : name_(name) {
+    stats_.sample_floor_ns = kMinSampledHoldNs;
+    LockRegistry& registry = LockRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    registry.live.push_back(this);
+}
+
+InstrumentedMutex::~InstrumentedMutex() {
+    LockRegistry& registry = LockRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    LockRegistry::accumulate(registry.retired[name_], *this);
+    registry.live.erase(std::remove(registry.live.begin(), registry.live.end(), this), registry.live.end());
+}
+
+void InstrumentedMutex::lock() {
+    if (!mtx_.try_lock()) {
+        auto wait_start = std::chrono::steady_clock::now();
+        mtx_.lock();
+        auto now = std::chrono::steady_clock::now();
+        // Written while holding the lock, like every other statistic
+        stats_.contended.store(stats_.contended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        stats_.wait_ns.store(stats_.wait_ns.load(std::memory_order_relaxed) + elapsedNs(wait_start, now),
+                             std::memory_order_relaxed);
+        onAcquired(now);
+        return;
+    }
+    onAcquired(std::chrono::steady_clock::now());
+}
+
+bool InstrumentedMutex::try_lock() {
+    if (!mtx_.try_lock()) {
+        return false;
+    }
+    onAcquired(std::chrono::steady_clock::now());
+    return true;
+}
+
+void InstrumentedMutex::onAcquired(std::chrono::steady_clock::time_point now) {
+    acquired_at_ = now;
+    stats_.acquisitions.store(stats_.acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+__attribute__((noinline)) void InstrumentedMutex::unlock() {
+    std::uint64_t hold_ns = elapsedNs(acquired_at_, std::chrono::steady_clock::now());
+    stats_.hold_ns.store(stats_.hold_ns.load(std::memory_order_relaxed) + hold_ns, std::memory_order_relaxed);
+    if (hold_ns > stats_.max_hold_ns.load(std::memory_order_relaxed)) {
+        stats_.max_hold_ns.store(hold_ns, std::memory_order_relaxed);
+    }
+    if (hold_ns >= stats_.sample_floor_ns) {
+        sampleHolder(hold_ns);
+    }
+    mtx_.unlock();
+}
+
+__attribute__((noinline)) void InstrumentedMutex::sampleHolder(std::uint64_t hold_ns) {
+    // Drop this function's own frame; unlock() and lock wrappers are
+    // skipped when symbolized, since inlining decides which are present
+    void* frames[kSampleDepth + 1];
+    int depth = backtrace(frames, kSampleDepth + 1);
+    HolderSample sample;
+    sample.depth = std::max(0, depth - 1);
+    std::copy(frames + 1, frames + 1 + sample.depth, sample.frames);
+    sample.max_hold_ns = hold_ns;
+    sample.samples = 1;
+    mergeHolder(stats_.holders, sample);
+
+    // Once every slot is taken, only a hold longer than the shortest sampled
+    // one can change the list
+    std::uint64_t floor = ~std::uint64_t{0};
+    for (const auto& holder : stats_.holders) {
+        floor = std::min(floor, holder.samples == 0 ? kMinSampledHoldNs : holder.max_hold_ns);
+    }
+    stats_.sample_floor_ns = std::max(floor, kMinSampledHoldNs);
+}
+
+std::vector<LockSnapshot> InstrumentedMutex::snapshot() {
+    LockRegistry& registry = LockRegistry::instance();
+    std::map<std::string, LockRegistry::Retired> totals;
+    std::map<std::string, std::size_t> instances;
+    {
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        totals = registry.retired;
+        for (InstrumentedMutex* live : registry.live) {
+            // The raw mutex, so reading is neither counted nor sampled
+            std::lock_guard<std::mutex> held(live->mtx_);
+            LockRegistry::accumulate(totals[live->name_], *live);
+            ++instances[live->name_];
+        }
+    }
+
+    std::vector<LockSnapshot> locks;
+    for (const auto& entry : totals) {
+        LockSnapshot snapshot;
+        snapshot.name = entry.first;
+        snapshot.instances = instances[entry.first];
+        snapshot.acquisitions = entry.second.acquisitions;
+        snapshot.contended = entry.second.contended;
+        snapshot.wait_ns = entry.second.wait_ns;
+        snapshot.hold_ns = entry.second.hold_ns;
+        snapshot.max_hold_ns = entry.second.max_hold_ns;
+        for (const auto& holder : entry.second.holders) {
+            if (holder.samples != 0) {
+                snapshot.longest_holders.push_back({describeSite(holder), holder.max_hold_ns, holder.samples});
+            }
+        }
+        std::sort(snapshot.longest_holders.begin(), snapshot.longest_holders.end(),
+                  [](const LockHolderSample& a, const LockHolderSample& b) { return a.max_hold_ns > b.max_hold_ns; });
+        locks.push_back(std::move(snapshot));
+    }
+    return locks;
+}
+
+std::string InstrumentedMutex::formatPrometheus(const std::vector<LockSnapshot>& locks) {
+    if (locks.empty()) {
+        return "";
+    }
+    std::string out;
+    auto family = [&](const std::string& name, const char* type, std::string (*value)(const LockSnapshot&)) {
+        out += "# TYPE " + name + " " + type + "\n";
+        for (const LockSnapshot& lock : locks) {
+            out += name + "{lock=\"" + lock.name + "\"} " + value(lock) + "\n";
+        }
+    };
+    family("lru_cache_lock_acquisitions_total", "counter",
+           [](const LockSnapshot& l) { return std::to_string(l.acquisitions); });
+    family("lru_cache_lock_contended_total", "counter",
+           [](const LockSnapshot& l) { return std::to_string(l.contended); });
+    family("lru_cache_lock_wait_seconds_total", "counter",
+           [](const LockSnapshot& l) { return Metrics::formatSeconds(l.wait_ns); });
+    family("lru_cache_lock_hold_seconds_total", "counter",
+           [](const LockSnapshot& l) { return Metrics::formatSeconds(l.hold_ns); });
+    family("lru_cache_lock_max_hold_seconds", "gauge",
+           [](const LockSnapshot& l) { return Metrics::formatSeconds(l.max_hold_ns); });
+    return out;
+}
@@ -1,10 +1,12 @@
 #include "lru_cache.h"
+#include "metrics.h"
 #include <iostream>
 #include <utility>
 #include <chrono>
 #include <cstddef>
 #include <sstream> // For parsing WAL
 #include <vector>  // For splitting strings
+#include <charconv> // For INCR parsing
 
 // --- Constructor ---
 LRUCache::LRUCache(std::size_t cap, int ttl) : capacity(cap), ttl_seconds(ttl) {
@@ -16,11 +18,16 @@ LRUCache::LRUCache(std::size_t cap, int ttl) : capacity(cap), ttl_seconds(ttl) {
     tail = new Node("", "");
     head->next = tail;
     tail->prev = head;
+    large_head = new Node("", "");
+    large_tail = new Node("", "");
+    large_head->next = large_tail;
+    large_tail->prev = large_head;
     wal_stream_ = nullptr; // Ensure WAL is initially off
 }
 
 // --- Destructor ---
 LRUCache::~LRUCache() {
+    stopBackgroundTasks();
     // WAL stream is managed externally (e.g., in server main), just clear pointer
     wal_stream_ = nullptr;
 
@@ -28,32 +35,814 @@ LRUCache::~LRUCache() {
     while (current != tail) {
         Node* toDelete = current;
         current = current->next;
-        delete toDelete;
+        destroyNode(toDelete);
+    }
+    current = large_head->next;
+    while (current != large_tail) {
+        Node* toDelete = current;
+        current = current->next;
+        destroyNode(toDelete);
     }
     delete head;
     delete tail;
+    delete large_head;
+    delete large_tail;
 }
 
 // --- WAL Stream Setter ---
 void LRUCache::setWalStream(std::ofstream* stream) {
-    std::lock_guard<std::mutex> lock(mtx); // Lock while changing stream pointer
+    std::lock_guard<CacheMutex> lock(mtx); // Lock while changing stream pointer
     wal_stream_ = stream;
 }
 
+// --- NUMA Placement ---
+void LRUCache::setNumaNode(int numa_node) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    numa_node_ = numa_node;
+}
+
+PageOptions LRUCache::pageOptions(bool huge_pages) const {
+    PageOptions options;
+    options.huge_pages = huge_pages;
+    options.numa_node = numa_node_;
+    return options;
+}
+
+// --- Node Allocation Helpers ---
+// Assumes lock is held
+Node* LRUCache::createNode(const std::string& key) {
+    std::size_t split = key_table_ ? internSplit(key) : std::string::npos;
+    if (split == std::string::npos) {
+        if (node_pool_) {
+            return node_pool_->create(key);
+        }
+        return new Node(key, "");
+    }
+    std::string suffix = key.substr(split + 1);
+    Node* node = node_pool_ ? node_pool_->create(suffix) : new Node(suffix, "");
+    // The table keeps the prefix alive until its last node releases it
+    node->key_prefix = key_table_->acquire(std::string_view(key).substr(0, split + 1)).get();
+    return node;
+}
+
+void LRUCache::destroyNode(Node* node) {
+    if (!hot_versions_.empty()) {
+        invalidateHot(keyOf(node)); // Removed, evicted or expired: copies must not outlive it
+    }
+    if (node->key_prefix) {
+        key_table_->release(*node->key_prefix);
+        node->key_prefix = nullptr;
+    }
+    if (node_pool_) {
+        node_pool_->destroy(node);
+        return;
+    }
+    delete node;
+}
+
+bool LRUCache::enableNodePool(bool huge_pages) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (node_pool_) return true; // Already enabled
+    if (!cache.empty()) {
+        std::cerr << "Warning: Node pool can only be enabled on an empty cache." << std::endl;
+        return false;
+    }
+    node_pool_ = std::make_unique<NodePool>(pageOptions(huge_pages));
+    return true;
+}
+
+// The shortest prefix ending in a delimiter whose suffix fits in the
+// string's inline buffer, so the node's key needs no heap allocation.
+// Shorter prefixes are shared by more keys. Falls back to the last
+// delimiter; npos if the key is already inline or has no delimiter.
+std::size_t LRUCache::internSplit(const std::string& key) const {
+    static const std::size_t kInlineBytes = std::string().capacity();
+    if (key.size() <= kInlineBytes) {
+        return std::string::npos;
+    }
+    std::size_t split = key.find(key_delimiter_);
+    while (split != std::string::npos && key.size() - split - 1 > kInlineBytes) {
+        std::size_t next = key.find(key_delimiter_, split + 1);
+        if (next == std::string::npos) break;
+        split = next;
+    }
+    return split;
+}
+
+// --- Key Index Helpers ---
+std::uint64_t LRUCache::hashKey(std::string_view prefix, std::string_view suffix) {
+    std::uint64_t h = 1469598103934665603ULL; // FNV-1a: stable across runs and builds
+    for (char c : prefix) {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+    for (char c : suffix) {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+    return h;
+}
+
+bool LRUCache::keyEquals(const Node* node, const std::string& key) {
+    if (node->key_prefix == nullptr) {
+        return node->key == key;
+    }
+    const std::string& prefix = *node->key_prefix;
+    return key.size() == prefix.size() + node->key.size() && key.compare(0, prefix.size(), prefix) == 0 &&
+           key.compare(prefix.size(), std::string::npos, node->key) == 0;
+}
+
+std::string LRUCache::keyOf(const Node* node) {
+    return node->key_prefix ? *node->key_prefix + node->key : node->key;
+}
+
+// Assumes lock is held
+Node* LRUCache::lookup(const std::string& key) const {
+    auto range = cache.equal_range(hashKey(key));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (keyEquals(it->second, key)) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+void LRUCache::indexInsert(Node* node, const std::string& key) {
+    cache.emplace(hashKey(key), node);
+}
+
+void LRUCache::indexErase(Node* node) {
+    std::uint64_t hash = node->key_prefix ? hashKey(*node->key_prefix, node->key) : hashKey(node->key);
+    auto range = cache.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == node) {
+            cache.erase(it);
+            return;
+        }
+    }
+}
+
+// --- Key Interning ---
+bool LRUCache::enableKeyInterning(char delimiter) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (!cache.empty()) {
+        std::cerr << "Warning: Key interning can only be enabled on an empty cache." << std::endl;
+        return false;
+    }
+    key_table_ = std::make_unique<ValueTable>();
+    key_delimiter_ = delimiter;
+    return true;
+}
+
+std::size_t LRUCache::keyPrefixSavedBytes() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return key_table_ ? key_table_->savedBytes() : 0;
+}
+
+std::size_t LRUCache::keyPrefixCount() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return key_table_ ? key_table_->uniqueValues() : 0;
+}
+
+// --- Hot-key Detection ---
+void LRUCache::enableHotKeys(std::size_t capacity, std::uint32_t sample_rate, std::chrono::seconds window) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    hot_keys_ = std::make_unique<HotKeySketch>(capacity, sample_rate, window);
+}
+
+std::vector<HotKeyEstimate> LRUCache::hotKeys(std::size_t limit) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return hot_keys_ ? hot_keys_->top(limit) : std::vector<HotKeyEstimate>();
+}
+
+std::uint32_t LRUCache::hotKeySampleRate() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return hot_keys_ ? hot_keys_->sampleRate() : 0;
+}
+
+// --- Hot-key Replication ---
+void LRUCache::startHotKeyReplication(HotKeyReplicas* replicas, std::chrono::seconds interval, double min_rate,
+                                      std::size_t max_keys) {
+    {
+        std::lock_guard<CacheMutex> lock(mtx);
+        hot_replicas_ = replicas;
+    }
+    double interval_seconds = static_cast<double>(interval.count());
+    runPeriodically(interval, [this, min_rate, max_keys, interval_seconds] {
+        std::lock_guard<CacheMutex> lock(mtx);
+        if (hot_keys_) {
+            refreshHotReplicas(min_rate, max_keys, interval_seconds);
+        }
+    });
+}
+
+// Assumes lock is held. The sketch only sees reads that reach the shard,
+// so a promoted key's rate also counts the hits on its copies.
+void LRUCache::refreshHotReplicas(double min_rate, std::size_t max_keys, double interval_seconds) {
+    std::vector<HotKeyEstimate> top = hot_keys_->top(max_keys);
+    for (auto it = hot_versions_.begin(); it != hot_versions_.end();) {
+        double rate = static_cast<double>(hot_replicas_->takeHits(it->first)) / interval_seconds;
+        for (const HotKeyEstimate& estimate : top) {
+            if (estimate.key == it->first) rate += estimate.per_second;
+        }
+        if (rate >= min_rate / 2) { // Hysteresis, so keys near the threshold do not flap
+            ++it;
+            continue;
+        }
+        it->second->value.fetch_add(1, std::memory_order_release);
+        hot_replicas_->demote(it->first);
+        it = hot_versions_.erase(it);
+    }
+    for (const HotKeyEstimate& estimate : top) {
+        if (hot_versions_.size() >= max_keys) {
+            break;
+        }
+        if (estimate.per_second >= min_rate && hot_versions_.find(estimate.key) == hot_versions_.end()) {
+            auto version = std::make_shared<HotKeyVersion>();
+            hot_versions_.emplace(estimate.key, version);
+            hot_replicas_->promote(estimate.key, version);
+        }
+    }
+}
+
+// Assumes lock is held
+void LRUCache::invalidateHot(const std::string& key) {
+    auto it = hot_versions_.find(key);
+    if (it != hot_versions_.end()) {
+        it->second->value.fetch_add(1, std::memory_order_release);
+    }
+}
+
+LRUCache::HotRead LRUCache::readHot(const std::string& key) {
+    HotRead read;
+    StoredValue stored;
+    bool found = false;
+    {
+        std::lock_guard<CacheMutex> lock(mtx);
+        found = get_locked(key, &stored).has_value(); // Refreshes LRU position and TTL for all copies
+        if (found) {
+            read.expires_at_ms = lookup(key)->expires_at_ms;
+        }
+        // Read after get_locked, which may have changed it (expiry, flash promotion)
+        auto hot = hot_versions_.find(key);
+        if (hot != hot_versions_.end()) {
+            read.promoted = true;
+            read.version = hot->second->value.load(std::memory_order_relaxed);
+        }
+    }
+    if (!found) {
+        return read;
+    }
+    if (stored.shared && stored.raw_length == 0) {
+        read.value = stored.shared; // Shares the stored bytes
+    } else {
+        read.value = std::make_shared<const std::string>(decodeValue(std::move(stored)));
+    }
+    return read;
+}
+
+// --- Value Storage Helpers ---
+// Assumes lock is held. False (node left without a value) only when the
+// value belongs in a slab class and no chunk can be freed for it.
+bool LRUCache::storeValue(Node* node, StoredValue& stored) {
+    node->raw_length = stored.raw_length;
+    if (stored.raw_length != 0) {
+        compressed_raw_bytes_ += stored.raw_length;
+        compressed_stored_bytes_ += stored.storedSize();
+    }
+    bool dedup = isDeduplicated(stored.storedSize());
+    if (stored.large || dedup) {
+        if (!stored.shared) {
+            stored.shared = std::make_shared<const std::string>(std::move(stored.bytes));
+        }
+        if (dedup) {
+            stored.shared = value_table_->acquire(std::move(stored.shared)); // Equal values share one buffer
+            node->deduplicated = true;
+        }
+        if (stored.large) {
+            large_bytes_ += stored.shared->size();
+            large_count_++;
+            node->large = true;
+        }
+        node->shared_value = std::move(stored.shared);
+        node->value.clear();
+        return true;
+    }
+    const std::string& value = stored.bytes;
+    if (slabs_ && slabs_->classFor(value.size()) != SlabRef::kNoClass) {
+        // Slab-sized values never spill to the heap, which would escape the budget
+        node->value.clear();
+        if (storeInSlab(node, value)) {
+            return true;
+        }
+        if (node->raw_length != 0) {
+            compressed_raw_bytes_ -= node->raw_length;
+            compressed_stored_bytes_ -= stored.storedSize();
+            node->raw_length = 0;
+        }
+        return false;
+    }
+    if (arena_) {
+        node->value_span = arena_->allocate(value.data(), value.size());
+        if (node->value_span.valid()) {
+            node->value.clear();
+            return true;
+        }
+        // Arena could not map memory; keep this value on the heap instead
+    }
+    node->value = std::move(stored.bytes);
+    return true;
+}
+
+std::string LRUCache::loadValue(const Node* node) const {
+    if (node->raw_length == 0) {
+        return loadStored(node);
+    }
+    StoredValue stored;
+    stored.bytes = loadStored(node);
+    stored.raw_length = node->raw_length;
+    return decodeValue(std::move(stored));
+}
+
+std::string LRUCache::loadStored(const Node* node) const {
+    if (node->shared_value) {
+        return *node->shared_value;
+    }
+    if (node->slab_ref.valid()) {
+        return slabs_->read(node->slab_ref);
+    }
+    if (node->value_span.valid()) {
+        return arena_->read(node->value_span);
+    }
+    return node->value;
+}
+
+std::size_t LRUCache::storedLength(const Node* node) const {
+    return node->shared_value       ? node->shared_value->size()
+           : node->slab_ref.valid()   ? node->slab_ref.length
+           : node->value_span.valid() ? node->value_span.length
+                                      : node->value.size();
+}
+
+std::size_t LRUCache::valueLength(const Node* node) const {
+    return node->raw_length != 0 ? node->raw_length : storedLength(node);
+}
+
+void LRUCache::captureStored(const Node* node, StoredValue* stored) const {
+    if (node->shared_value) {
+        stored->shared = node->shared_value;
+    } else {
+        stored->bytes = loadStored(node);
+    }
+    stored->raw_length = node->raw_length;
+}
+
+void LRUCache::releaseValue(Node* node) {
+    if (node->raw_length != 0) {
+        compressed_raw_bytes_ -= node->raw_length;
+        compressed_stored_bytes_ -= storedLength(node);
+        node->raw_length = 0;
+    }
+    if (node->slab_ref.valid()) {
+        unlinkClass(node);
+        slabs_->release(node->slab_ref);
+        node->slab_ref = SlabRef{};
+    }
+    if (node->value_span.valid()) {
+        arena_->release(node->value_span);
+        node->value_span = ArenaSpan{};
+    }
+    if (node->shared_value) {
+        if (node->large) {
+            large_bytes_ -= node->shared_value->size();
+            large_count_--;
+            node->large = false;
+        }
+        if (node->deduplicated) {
+            value_table_->release(*node->shared_value);
+            node->deduplicated = false;
+        }
+        node->shared_value.reset(); // Readers holding a handle keep the bytes alive
+    }
+}
+
+bool LRUCache::isLarge(std::size_t value_bytes) const {
+    return large_threshold_ > 0 && value_bytes >= large_threshold_;
+}
+
+bool LRUCache::isDeduplicated(std::size_t stored_bytes) const {
+    return value_table_ && stored_bytes >= dedup_min_bytes_;
+}
+
+// --- Encoding ---
+StoredValue LRUCache::encodeValue(const std::string& value) const {
+    StoredValue stored;
+    if (codec_ && value.size() >= compress_min_bytes_ && value.size() <= UINT32_MAX &&
+        codec_->compress(value, stored.bytes) && stored.bytes.size() < value.size()) {
+        stored.raw_length = static_cast<std::uint32_t>(value.size());
+    } else {
+        stored.bytes = value; // Incompressible, too small, or compression is off
+    }
+    shareIfNeeded(stored);
+    return stored;
+}
+
+void LRUCache::shareIfNeeded(StoredValue& stored) const {
+    stored.large = isLarge(stored.bytes.size());
+    if (stored.large || isDeduplicated(stored.bytes.size())) {
+        stored.shared = std::make_shared<const std::string>(std::move(stored.bytes));
+        stored.bytes.clear();
+    }
+}
+
+std::string LRUCache::decodeValue(StoredValue&& stored) const {
+    if (stored.raw_length == 0) {
+        return stored.shared ? *stored.shared : std::move(stored.bytes);
+    }
+    std::string value;
+    if (!codec_->decompress(stored.shared ? *stored.shared : stored.bytes, stored.raw_length, value)) {
+        std::cerr << "ERROR: Failed to decompress a cached value!" << std::endl;
+        value.clear();
+    }
+    return value;
+}
+
+// --- Compression ---
+bool LRUCache::enableCompression(std::unique_ptr<ValueCodec> codec, std::size_t min_bytes) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (!cache.empty()) {
+        std::cerr << "Warning: Compression can only be enabled on an empty cache." << std::endl;
+        return false;
+    }
+    codec_ = std::move(codec);
+    compress_min_bytes_ = min_bytes;
+    return true;
+}
+
+std::pair<std::size_t, std::size_t> LRUCache::compressionBytes() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return {compressed_raw_bytes_, compressed_stored_bytes_};
+}
+
+// --- Deduplication ---
+bool LRUCache::enableDedup(std::size_t min_bytes) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (!cache.empty()) {
+        std::cerr << "Warning: Deduplication can only be enabled on an empty cache." << std::endl;
+        return false;
+    }
+    value_table_ = std::make_unique<ValueTable>();
+    dedup_min_bytes_ = min_bytes;
+    return true;
+}
+
+std::size_t LRUCache::dedupSavedBytes() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return value_table_ ? value_table_->savedBytes() : 0;
+}
+
+std::size_t LRUCache::dedupUniqueValues() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return value_table_ ? value_table_->uniqueValues() : 0;
+}
+
+// --- Large-object Store ---
+bool LRUCache::enableLargeObjects(std::size_t threshold_bytes, std::size_t budget_bytes) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (!cache.empty()) {
+        std::cerr << "Warning: The large-object store can only be enabled on an empty cache." << std::endl;
+        return false;
+    }
+    large_threshold_ = threshold_bytes;
+    large_budget_ = budget_bytes;
+    return true;
+}
+
+std::size_t LRUCache::largeObjectBytes() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return large_bytes_;
+}
+
+bool LRUCache::exceedsLargeBudget(const StoredValue& stored) const {
+    return stored.large && stored.storedSize() > large_budget_;
+}
+
+// Assumes lock is held. Evicts the store's own LRU tail until it is within
+// budget; keep (the value just stored) always fits, as puts reject values
+// larger than the whole budget.
+void LRUCache::evictLargeObjects(const Node* keep) {
+    while (large_bytes_ > large_budget_ && large_tail->prev != large_head && large_tail->prev != keep) {
+        Node* victim = large_tail->prev;
+        spillToFlash(victim);
+        removeInternal(victim);
+        Metrics::add(Metric::CacheEvictions);
+    }
+}
+
+// --- Flash Tier ---
+bool LRUCache::enableFlashTier(const std::string& path, std::size_t region_bytes, std::size_t region_count) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (flash_) return true; // Already enabled
+    auto flash = std::make_unique<FlashTier>(region_bytes, region_count);
+    if (!flash->open(path)) {
+        return false;
+    }
+    flash_ = std::move(flash);
+    return true;
+}
+
+// Assumes lock is held. Keeps what is left of the inactivity TTL, so a
+// spilled entry does not outlive its time in RAM. Compressed values are
+// written as stored, so flash holds them compressed too.
+void LRUCache::spillToFlash(const Node* node) {
+    if (!flash_ || isExpired(node)) {
+        return;
+    }
+    std::int64_t stale_after_ms = 0;
+    if (node->expires_at_ms == 0 && ttl_seconds > 0) {
+        auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - node->timestamp).count();
+        stale_after_ms = nowUnixMs() + std::int64_t{ttl_seconds} * 1000 - idle;
+    }
+    flash_->append(keyOf(node), loadStored(node), node->raw_length, node->expires_at_ms, stale_after_ms);
+}
+
+// Assumes lock is held. Moves key's flash record back into RAM in its
+// stored form, so nothing is recompressed; the WAL already has its value,
+// so nothing is logged (and put_locked never reads the plain value).
+Node* LRUCache::promoteFromFlash(const std::string& key) {
+    if (!flash_) {
+        return nullptr;
+    }
+    std::optional<FlashRecord> record = flash_->take(key);
+    if (!record) {
+        return nullptr;
+    }
+    StoredValue stored;
+    stored.bytes = std::move(record->value);
+    stored.raw_length = record->raw_length;
+    shareIfNeeded(stored);
+    if (!put_locked(key, std::string(), record->expires_at_ms, /*is_recovery=*/true, &stored)) {
+        return nullptr;
+    }
+    return lookup(key);
+}
+
+// --- Arena ---
+void LRUCache::enableArena(std::size_t region_bytes, bool huge_pages) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (arena_) return; // Already enabled
+    arena_ = std::make_unique<RegionArena>(region_bytes, pageOptions(huge_pages));
+    // Migrate values that were stored before the arena existed
+    for (Node* node = head->next; node != tail;) {
+        Node* next = node->next;
+        StoredValue stored;
+        stored.bytes = loadStored(node);
+        stored.raw_length = node->raw_length;
+        releaseValue(node);
+        if (!storeValue(node, stored)) {
+            removeInternal(node); // Does not fit the slab budget
+            Metrics::add(Metric::CacheEvictions);
+        }
+        node = next;
+    }
+}
+
+std::size_t LRUCache::compactArena(double max_live_ratio) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (!arena_) return 0;
+    if (arena_->markSparseRegions(max_live_ratio) > 0) {
+        // Re-allocate every live value that sits in a sparse region; the copy
+        // lands in the active region and the old span is only released.
+        for (Node* node = head->next; node != tail; node = node->next) {
+            if (node->value_span.valid() && arena_->isSparse(node->value_span.region)) {
+                ArenaSpan moved = arena_->allocate(arena_->data(node->value_span), node->value_span.length);
+                if (!moved.valid()) break; // Out of memory; try again next round
+                arena_->release(node->value_span);
+                node->value_span = moved;
+            }
+        }
+    }
+    return arena_->releaseEmptyRegions();
+}
+
+void LRUCache::startArenaCompactor(std::chrono::seconds interval, double max_live_ratio) {
+    runPeriodically(interval, [this, max_live_ratio] {
+        std::size_t released = compactArena(max_live_ratio);
+        if (released > 0) {
+            std::cout << "[Compactor] Released " << released << " bytes of arena regions." << std::endl;
+        }
+    });
+}
+
+// --- Slabs ---
+void LRUCache::enableSlabs(std::size_t page_bytes, std::size_t memory_limit_bytes, double growth_factor,
+                           bool huge_pages) {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (slabs_) return; // Already enabled
+    slabs_ = std::make_unique<SlabAllocator>(page_bytes, memory_limit_bytes, growth_factor,
+                                             pageOptions(huge_pages));
+    slab_classes_.assign(slabs_->classCount(), SlabClassState{});
+    // Migrate values that were stored before slabs existed (oldest first so
+    // the per-class lists end up in the same order as the main list)
+    for (Node* node = tail->prev; node != head;) {
+        Node* older = node->prev;
+        StoredValue stored;
+        stored.bytes = loadStored(node);
+        stored.raw_length = node->raw_length;
+        releaseValue(node);
+        if (!storeValue(node, stored)) {
+            removeInternal(node); // Does not fit the slab budget
+            Metrics::add(Metric::CacheEvictions);
+        }
+        node = older;
+    }
+}
+
+// Assumes lock is held. Evicts from the class's own LRU tail until a chunk
+// is free. A class that owns no values takes a page from another class
+// first, as memcached does; false only if no class has a page to give.
+bool LRUCache::storeInSlab(Node* node, const std::string& value) {
+    std::uint16_t cls = slabs_->classFor(value.size());
+    SlabRef ref = slabs_->allocate(value.data(), value.size(), node);
+    while (!ref.valid()) {
+        SlabClassState& state = slab_classes_[cls];
+        state.pressure++; // Signals the rebalancer that this class is short of pages
+        Node* victim = state.tail;
+        if (victim != nullptr && victim != node) {
+            spillToFlash(victim);
+            removeInternal(victim);
+            Metrics::add(Metric::CacheEvictions);
+        } else if (!takeSlabPage(cls)) {
+            return false;
+        }
+        ref = slabs_->allocate(value.data(), value.size(), node);
+    }
+    node->slab_ref = ref;
+    linkClassHead(node);
+    return true;
+}
+
+// Assumes lock is held. Moves a page over to cls from another class: an
+// empty page if some class has one, else the page holding the LRU tail of
+// the least pressured class, evicting the values stored on it. Runs on the
+// put path, so it costs O(classes + chunks per page), never O(pages).
+bool LRUCache::takeSlabPage(std::uint16_t cls) {
+    std::size_t donor = slab_classes_.size();
+    for (std::size_t c = 0; c < slab_classes_.size(); ++c) {
+        std::uint16_t candidate = static_cast<std::uint16_t>(c);
+        if (c == cls || slabs_->pageCount(candidate) == 0) continue;
+        if (slabs_->usedChunks(candidate) == 0) {
+            return slabs_->movePage(slabs_->partialPage(candidate), cls);
+        }
+        if (donor == slab_classes_.size() || slab_classes_[c].pressure < slab_classes_[donor].pressure) {
+            donor = c;
+        }
+    }
+    if (donor == slab_classes_.size()) {
+        return false;
+    }
+    std::uint16_t donor_cls = static_cast<std::uint16_t>(donor);
+    std::uint32_t page = slab_classes_[donor_cls].tail->slab_ref.page;
+    evacuateSlabPage(donor_cls, page);
+    return slabs_->movePage(page, cls);
+}
+
+void LRUCache::evacuateSlabPage(std::uint16_t cls, std::uint32_t page) {
+    // Assumes lock is held. Visits only the page's own chunks.
+    for (std::uint32_t chunk = 0; chunk < slabs_->chunksPerPage(cls); ++chunk) {
+        Node* node = static_cast<Node*>(slabs_->owner(page, chunk));
+        if (node == nullptr) continue;
+        spillToFlash(node);
+        removeInternal(node);
+        Metrics::add(Metric::CacheEvictions);
+    }
+}
+
+void LRUCache::linkClassHead(Node* node) {
+    // Assumes lock is held and node->slab_ref is valid
+    SlabClassState& state = slab_classes_[node->slab_ref.cls];
+    node->class_prev = nullptr;
+    node->class_next = state.head;
+    if (state.head) state.head->class_prev = node;
+    state.head = node;
+    if (state.tail == nullptr) state.tail = node;
+}
+
+void LRUCache::unlinkClass(Node* node) {
+    // Assumes lock is held and node->slab_ref is valid
+    SlabClassState& state = slab_classes_[node->slab_ref.cls];
+    if (node->class_prev) node->class_prev->class_next = node->class_next;
+    else state.head = node->class_next;
+    if (node->class_next) node->class_next->class_prev = node->class_prev;
+    else state.tail = node->class_prev;
+    node->class_prev = nullptr;
+    node->class_next = nullptr;
+}
+
+bool LRUCache::rebalanceSlabs() {
+    std::lock_guard<CacheMutex> lock(mtx);
+    if (!slabs_) return false;
+
+    // Neediest class: most evictions since the last round. Donor: the class
+    // with the least pressure that still owns a page.
+    std::size_t needy = slab_classes_.size();
+    std::size_t donor = slab_classes_.size();
+    for (std::size_t c = 0; c < slab_classes_.size(); ++c) {
+        if (slab_classes_[c].pressure > 0 &&
+            (needy == slab_classes_.size() || slab_classes_[c].pressure > slab_classes_[needy].pressure)) {
+            needy = c;
+        }
+    }
+    if (needy == slab_classes_.size()) {
+        return false; // Distribution is stable
+    }
+    for (std::size_t c = 0; c < slab_classes_.size(); ++c) {
+        if (c == needy || slabs_->pageCount(static_cast<std::uint16_t>(c)) == 0) continue;
+        if (donor == slab_classes_.size() || slab_classes_[c].pressure < slab_classes_[donor].pressure) {
+            donor = c;
+        }
+    }
+    bool worth_moving = donor != slab_classes_.size() &&
+                        slab_classes_[donor].pressure < slab_classes_[needy].pressure;
+    for (auto& state : slab_classes_) state.pressure = 0; // Start a new observation window
+    if (!worth_moving) {
+        return false;
+    }
+
+    // Evacuate the donor's emptiest page by evicting the values stored on it
+    std::uint16_t donor_cls = static_cast<std::uint16_t>(donor);
+    std::uint32_t page = slabs_->leastUsedPage(donor_cls);
+    evacuateSlabPage(donor_cls, page);
+    if (!slabs_->movePage(page, static_cast<std::uint16_t>(needy))) {
+        return false;
+    }
+    std::cout << "[SlabRebalancer] Moved page " << page << " from class " << donor << " ("
+              << slabs_->chunkSize(donor_cls) << "B) to class " << needy << " ("
+              << slabs_->chunkSize(static_cast<std::uint16_t>(needy)) << "B)." << std::endl;
+    return true;
+}
+
+void LRUCache::startSlabRebalancer(std::chrono::seconds interval) {
+    runPeriodically(interval, [this] { rebalanceSlabs(); });
+}
+
+// --- Background Maintenance ---
+// Runs task every interval on its own thread until stopBackgroundTasks().
+void LRUCache::runPeriodically(std::chrono::seconds interval, std::function<void()> task) {
+    stop_background_ = false;
+    background_threads_.emplace_back([this, interval, task = std::move(task)] {
+        std::unique_lock<std::mutex> lock(background_mtx_);
+        while (!stop_background_) {
+            // Sleep for one interval unless asked to stop
+            if (background_cv_.wait_for(lock, interval, [this] { return stop_background_.load(); })) {
+                break;
+            }
+            lock.unlock(); // Let other maintenance threads wake up while this one works
+            task();
+            lock.lock();
+        }
+    });
+}
+
+void LRUCache::stopBackgroundTasks() {
+    {
+        std::lock_guard<std::mutex> lock(background_mtx_);
+        stop_background_ = true;
+    }
+    background_cv_.notify_all();
+    for (auto& worker : background_threads_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    background_threads_.clear();
+}
+
 // --- Internal Logging Helper ---
 // Assumes lock is held
 bool LRUCache::writeLogEntry(const std::string& entry) {
     if (!wal_stream_) {
         return true; // WAL disabled, treat as success
     }
-    *wal_stream_ << entry << std::endl; // Append newline automatically
+    ScopedStage wal_stage(LatencyStage::WalWrite); // Attributed to the operation being timed, if any
+    *wal_stream_ << entry << '\n';
     if (!wal_stream_->good()) {
         std::cerr << "ERROR: Failed to write to WAL file!" << std::endl;
+        Metrics::add(Metric::WalErrors);
         // In a real system, might try to reopen/recover or stop accepting writes
         return false;
     }
+    Metrics::add(Metric::WalRecords);
+    Metrics::add(Metric::WalBytes, entry.size() + 1);
+    if (defer_wal_flush_) {
+        return true; // applyBatch flushes once at the end
+    }
     wal_stream_->flush(); // Flush buffer to OS (not necessarily to disk)
-    return wal_stream_->good();
+    Metrics::add(Metric::WalFlushes);
+    if (!wal_stream_->good()) {
+        Metrics::add(Metric::WalErrors);
+        return false;
+    }
+    return true;
 }
 
 
@@ -61,84 +850,194 @@ bool LRUCache::writeLogEntry(const std::string& entry) {
 
 // Return optional string: empty optional if not found/expired
 std::optional<std::string> LRUCache::get_sync(const std::string& key) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto it = cache.find(key);
-    if (it == cache.end()) {
-        return std::nullopt; // Not found
+    StoredValue stored;
+    OpTimer timer(LatencyOp::Get);
+    bool found = false;
+    {
+        std::lock_guard<CacheMutex> lock(mtx);
+        timer.mark(LatencyStage::LockWait);
+        found = get_locked(key, &stored).has_value();
+        timer.mark(LatencyStage::CriticalSection);
     }
-    Node* node = it->second;
-    if (isExpired(node)) {
-        // Don't log expiration, just remove internally
-        removeInternal(node); // removeInternal deletes the node
-        return std::nullopt; // Expired
+    if (!found) {
+        return std::nullopt;
+    }
+    return decodeValue(std::move(stored)); // Decompress and copy large objects after unlocking
+}
+
+bool LRUCache::put_sync(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                        bool is_recovery, bool* too_large, std::uint64_t* cas) {
+    StoredValue encoded = encodeValue(value); // Compress and copy the bytes before taking the lock
+    bool rejected = exceedsLargeBudget(encoded); // Could never fit in the large-object store
+    if (too_large) *too_large = rejected;
+    if (rejected) {
+        return false;
     }
-    moveToHead(node);
-    node->timestamp = std::chrono::steady_clock::now(); // Reset TTL on access
-    return node->value; // Found
+    OpTimer timer(LatencyOp::Put);
+    std::lock_guard<CacheMutex> lock(mtx);
+    timer.mark(LatencyStage::LockWait);
+    bool success = put_locked(key, value, expires_at_ms, is_recovery, &encoded, cas);
+    timer.mark(LatencyStage::CriticalSection);
+    return success;
 }
 
-bool LRUCache::put_sync(const std::string& key, const std::string& value, bool is_recovery) {
-    std::lock_guard<std::mutex> lock(mtx);
-    Node* existing_node = nullptr;
-    auto it = cache.find(key);
-    if (it != cache.end()) {
-        existing_node = it->second;
+bool LRUCache::remove_sync(const std::string& key, bool is_recovery, bool* existed) {
+    OpTimer timer(LatencyOp::Delete);
+    std::lock_guard<CacheMutex> lock(mtx);
+    timer.mark(LatencyStage::LockWait);
+    bool success = remove_locked(key, is_recovery, existed);
+    timer.mark(LatencyStage::CriticalSection);
+    return success;
+}
+
+// --- Lock-held Variants ---
+// Assume lock is held
+std::optional<std::string> LRUCache::get_locked(const std::string& key, StoredValue* stored) {
+    if (hot_keys_) hot_keys_->record(key); // Misses count too: a hot missing key still loads the shard
+    Node* node = lookup(key);
+    if (node == nullptr) {
+        node = promoteFromFlash(key); // Lands at the head with a fresh timestamp
+        if (node == nullptr) {
+            Metrics::add(Metric::CacheMisses);
+            return std::nullopt; // Not found
+        }
+    } else {
+        if (isExpired(node)) {
+            // Don't log expiration, just remove internally
+            removeInternal(node); // removeInternal deletes the node
+            Metrics::add(Metric::CacheExpirations);
+            Metrics::add(Metric::CacheMisses);
+            return std::nullopt; // Expired
+        }
+        moveToHead(node);
+        node->timestamp = std::chrono::steady_clock::now(); // Reset TTL on access
+    }
+    Metrics::add(Metric::CacheHits);
+    if (stored) {
+        captureStored(node, stored); // The caller decodes it once the lock is released
+        return std::string();
+    }
+    return loadValue(node); // Found
+}
+
+// Assumes lock is held. The put was already logged, so the WAL gets a
+// delete to match the entry being gone. Always returns false.
+bool LRUCache::slabStoreFailed(const std::string& key, bool is_recovery) {
+    std::cerr << "ERROR: Out of slab memory storing key: " << key << std::endl;
+    if (!is_recovery) {
+        writeLogEntry(walRemoveRecord(key));
+    }
+    return false;
+}
+
+bool LRUCache::put_locked(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                          bool is_recovery, StoredValue* encoded, std::uint64_t* cas) {
+    if (hot_keys_ && !is_recovery) hot_keys_->record(key);
+    Node* existing_node = lookup(key);
+    if (existing_node != nullptr) {
         if (isExpired(existing_node)) {
             // Treat expired node during put as if it wasn't there
             removeInternal(existing_node); // Remove old expired node
             existing_node = nullptr; // Reset pointer
+            Metrics::add(Metric::CacheExpirations);
         }
     }
+    StoredValue local;
+    if (encoded == nullptr) {
+        local = encodeValue(value);
+        encoded = &local;
+    }
+    bool is_large = encoded->large;
+    if (exceedsLargeBudget(*encoded)) {
+        return false; // Callers outside the lock reject these first
+    }
 
     // --- Log BEFORE changing state (if not in recovery) ---
     if (!is_recovery) {
-        // Format: PUT,key,value (simple CSV-like)
-        // Need basic escaping if key/value can contain commas/newlines
-        // For simplicity, assume they don't for now.
-        std::string log_entry = "PUT," + key + "," + value;
-        if (!writeLogEntry(log_entry)) {
+        if (!writeLogEntry(walPutRecord(key, value, expires_at_ms))) {
             return false; // WAL write failed, abort operation
         }
     }
 
     // --- Apply change to memory ---
+    if (!hot_versions_.empty()) {
+        invalidateHot(key);
+    }
+    // Large objects do not count against capacity, so only an entry joining
+    // the main list can push out its tail
+    bool joins_main_list = !is_large && (existing_node == nullptr || existing_node->large);
+    if (joins_main_list && cache.size() - large_count_ >= capacity) {
+        Node* tailNode = popTail(); // Removes from list
+        if (tailNode != nullptr) {
+            // Need to log eviction? No, WAL replays puts, eviction happens naturally.
+            spillToFlash(tailNode);
+            indexErase(tailNode);       // Remove from map
+            releaseValue(tailNode);
+            destroyNode(tailNode);      // Delete node data
+            Metrics::add(Metric::CacheEvictions);
+        }
+    }
+    Node* written = existing_node;
     if (existing_node) {
-        // Update existing node
-        existing_node->value = value;
+        // Update existing node (moveToHead also switches lists if its size class changed)
+        releaseValue(existing_node);
+        if (!storeValue(existing_node, *encoded)) {
+            removeInternal(existing_node); // Like memcached: a failed set does not leave stale data behind
+            return slabStoreFailed(key, is_recovery);
+        }
+        existing_node->cas = ++next_cas_;
+        existing_node->expires_at_ms = expires_at_ms;
         existing_node->timestamp = std::chrono::steady_clock::now();
         moveToHead(existing_node);
     } else {
-        // Insert new node, handle eviction if necessary
-        if (cache.size() >= capacity) {
-            Node* tailNode = popTail(); // Removes from list
-            if (tailNode != nullptr) {
-                // Need to log eviction? No, WAL replays puts, eviction happens naturally.
-                cache.erase(tailNode->key); // Remove from map
-                delete tailNode;            // Delete node data
-            }
+        if (flash_) {
+            flash_->erase(key); // Any spilled copy is now outdated
+        }
+        Node* newNode = createNode(key);
+        if (!storeValue(newNode, *encoded)) {
+            destroyNode(newNode);
+            return slabStoreFailed(key, is_recovery);
         }
-        Node* newNode = new Node(key, value);
-        cache[key] = newNode;
+        newNode->cas = ++next_cas_;
+        newNode->expires_at_ms = expires_at_ms;
+        indexInsert(newNode, key);
         addNodeToHead(newNode); // Add to list
+        written = newNode;
+    }
+    if (cas) *cas = written->cas;
+    if (is_large) {
+        evictLargeObjects(written);
+    }
+    if (!is_recovery) {
+        Metrics::add(Metric::CachePuts); // Client writes only, not replay, replication or promotion
     }
     return true; // Success
 }
 
-bool LRUCache::remove_sync(const std::string& key, bool is_recovery) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto it = cache.find(key);
-    if (it == cache.end()) {
+bool LRUCache::remove_locked(const std::string& key, bool is_recovery, bool* existed) {
+    if (existed) *existed = false;
+    if (!is_recovery) {
+        Metrics::add(Metric::CacheDeletes);
+    }
+    Node* node_to_remove = lookup(key);
+    if (node_to_remove == nullptr) {
+        if (flash_ && flash_->contains(key)) {
+            // Only spilled to flash: still needs a DEL so replay drops it
+            if (!is_recovery && !writeLogEntry(walRemoveRecord(key))) {
+                return false;
+            }
+            flash_->erase(key);
+            if (existed) *existed = true;
+        }
         return true; // Key doesn't exist, removal is trivially successful
     }
 
-    Node* node_to_remove = it->second;
+    if (existed) *existed = !isExpired(node_to_remove);
     // Check expiration? If expired, maybe don't log DEL? Let's log DEL always for simplicity.
 
     // --- Log BEFORE changing state (if not in recovery) ---
     if (!is_recovery) {
-        // Format: DEL,key
-        std::string log_entry = "DEL," + key;
-         if (!writeLogEntry(log_entry)) {
+         if (!writeLogEntry(walRemoveRecord(key))) {
             return false; // WAL write failed, abort operation
         }
     }
@@ -148,18 +1047,217 @@ bool LRUCache::remove_sync(const std::string& key, bool is_recovery) {
     return true; // Success
 }
 
+CacheOp::Status LRUCache::expire_locked(const std::string& key, std::int64_t expires_at_ms, bool is_recovery) {
+    Node* node = findLive(key);
+    if (node == nullptr) {
+        return CacheOp::Status::NotFound;
+    }
+    if (!is_recovery && !writeLogEntry(walExpireRecord(key, expires_at_ms))) {
+        return CacheOp::Status::Failed;
+    }
+    if (!hot_versions_.empty()) {
+        invalidateHot(key); // Copies carry the old deadline
+    }
+    node->expires_at_ms = expires_at_ms;
+    return CacheOp::Status::Ok;
+}
+
 // --- Public API Wrappers ---
 // These now just call the internal sync methods
 std::optional<std::string> LRUCache::get(const std::string& key) {
     return get_sync(key);
 }
 
-bool LRUCache::put(const std::string& key, const std::string& value) {
-    return put_sync(key, value, false); // 'false' means it's NOT recovery
+bool LRUCache::put(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                   bool* too_large, std::uint64_t* cas) {
+    return put_sync(key, value, expires_at_ms, false, too_large, cas); // 'false' means it's NOT recovery
 }
 
-bool LRUCache::remove(const std::string& key) {
-    return remove_sync(key, false); // 'false' means it's NOT recovery
+bool LRUCache::remove(const std::string& key, bool* existed) {
+    return remove_sync(key, false, existed); // 'false' means it's NOT recovery
+}
+
+std::shared_ptr<const std::string> LRUCache::getShared(const std::string& key) {
+    StoredValue stored;
+    OpTimer timer(LatencyOp::Get);
+    bool found = false;
+    {
+        std::lock_guard<CacheMutex> lock(mtx);
+        timer.mark(LatencyStage::LockWait);
+        found = get_locked(key, &stored).has_value();
+        timer.mark(LatencyStage::CriticalSection);
+    }
+    if (!found) {
+        return nullptr;
+    }
+    if (stored.shared && stored.raw_length == 0) {
+        return stored.shared; // Shares the stored bytes
+    }
+    return std::make_shared<const std::string>(decodeValue(std::move(stored)));
+}
+
+// --- Batched Access ---
+void LRUCache::applyBatch(const std::vector<CacheOp*>& ops) {
+    for (CacheOp* op : ops) {
+        if (op->type == CacheOp::Type::Put) {
+            op->stored = encodeValue(op->value); // Compress before taking the lock
+        }
+    }
+    {
+        std::lock_guard<CacheMutex> lock(mtx);
+        defer_wal_flush_ = true;
+        for (CacheOp* op : ops) {
+            applyOp(*op);
+        }
+        defer_wal_flush_ = false;
+        if (wal_stream_) {
+            wal_stream_->flush();
+            Metrics::add(Metric::WalFlushes);
+            if (!wal_stream_->good()) {
+                std::cerr << "ERROR: Failed to flush WAL after batch!" << std::endl;
+                Metrics::add(Metric::WalErrors);
+            }
+        }
+    }
+    // Values read by the batch are decompressed and copied out without the lock
+    for (CacheOp* op : ops) {
+        bool read = op->type == CacheOp::Type::Get || op->type == CacheOp::Type::Expire;
+        if (read && op->status == CacheOp::Status::Ok) {
+            op->result = decodeValue(std::move(op->stored));
+        }
+        op->stored = StoredValue{};
+    }
+}
+
+// Assumes lock is held
+void LRUCache::applyOp(CacheOp& op) {
+    switch (op.type) {
+        case CacheOp::Type::Get: {
+            op.status = get_locked(op.key, &op.stored) ? CacheOp::Status::Ok : CacheOp::Status::NotFound;
+            break;
+        }
+        case CacheOp::Type::Put:
+            if (exceedsLargeBudget(op.stored)) {
+                op.status = CacheOp::Status::TooLarge;
+                break;
+            }
+            op.status = put_locked(op.key, op.value, op.expires_at_ms, false, &op.stored)
+                            ? CacheOp::Status::Ok
+                            : CacheOp::Status::Failed;
+            break;
+        case CacheOp::Type::Remove: {
+            bool existed = false;
+            if (!remove_locked(op.key, false, &existed)) {
+                op.status = CacheOp::Status::Failed;
+            } else {
+                op.status = existed ? CacheOp::Status::Ok : CacheOp::Status::NotFound;
+            }
+            break;
+        }
+        case CacheOp::Type::Expire:
+            op.status = expire_locked(op.key, op.expires_at_ms, false);
+            if (op.status == CacheOp::Status::Ok) {
+                captureStored(lookup(op.key), &op.stored); // Decoded into result after unlocking
+            }
+            break;
+        case CacheOp::Type::Incr: {
+            // Missing keys count from 0; the entry keeps its expiry
+            std::int64_t current = 0;
+            std::int64_t expires_at_ms = 0;
+            if (Node* node = findLive(op.key)) {
+                // Longer than "-9223372036854775808": not an integer, so never
+                // decode (possibly decompress) a large value under the lock
+                constexpr std::size_t kMaxIntegerLength = 20;
+                if (valueLength(node) > kMaxIntegerLength) {
+                    op.status = CacheOp::Status::NotInteger;
+                    break;
+                }
+                std::string text = loadValue(node);
+                auto parsed = std::from_chars(text.data(), text.data() + text.size(), current);
+                if (text.empty() || parsed.ec != std::errc() || parsed.ptr != text.data() + text.size()) {
+                    op.status = CacheOp::Status::NotInteger;
+                    break;
+                }
+                expires_at_ms = node->expires_at_ms;
+            }
+            std::int64_t updated = 0;
+            if (__builtin_add_overflow(current, op.delta, &updated)) {
+                op.status = CacheOp::Status::NotInteger;
+                break;
+            }
+            op.result = std::to_string(updated);
+            op.expires_at_ms = expires_at_ms;
+            op.status = put_locked(op.key, op.result, expires_at_ms, false) ? CacheOp::Status::Ok
+                                                                            : CacheOp::Status::Failed;
+            break;
+        }
+    }
+}
+
+std::int64_t LRUCache::nowUnixMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// --- Versioned Access ---
+// Assumes lock is held
+Node* LRUCache::findLive(const std::string& key) {
+    Node* node = lookup(key);
+    if (node == nullptr) {
+        return promoteFromFlash(key);
+    }
+    if (isExpired(node)) {
+        removeInternal(node);
+        Metrics::add(Metric::CacheExpirations);
+        return nullptr;
+    }
+    return node;
+}
+
+std::optional<CacheEntry> LRUCache::getWithCas(const std::string& key) {
+    StoredValue stored;
+    CacheEntry entry;
+    {
+        std::lock_guard<CacheMutex> lock(mtx);
+        if (hot_keys_) hot_keys_->record(key);
+        Node* node = findLive(key);
+        if (node == nullptr) {
+            Metrics::add(Metric::CacheMisses);
+            return std::nullopt;
+        }
+        Metrics::add(Metric::CacheHits);
+        moveToHead(node);
+        node->timestamp = std::chrono::steady_clock::now(); // Reset TTL on access
+        captureStored(node, &stored);
+        entry.cas = node->cas;
+    }
+    if (stored.shared && stored.raw_length == 0) {
+        entry.value = std::move(stored.shared); // Shares the stored bytes
+    } else {
+        entry.value = std::make_shared<const std::string>(decodeValue(std::move(stored))); // After unlocking
+    }
+    return entry;
+}
+
+CasResult LRUCache::compareAndSwap(const std::string& key, const std::string& value, std::uint64_t expected_cas,
+                                   std::int64_t expires_at_ms, std::uint64_t* new_cas) {
+    StoredValue encoded = encodeValue(value); // Compress before taking the lock, as put_sync does
+    if (exceedsLargeBudget(encoded)) {
+        return CasResult::TooLarge;
+    }
+    std::lock_guard<CacheMutex> lock(mtx);
+    Node* node = findLive(key);
+    if (node == nullptr) {
+        return CasResult::NotFound;
+    }
+    if (node->cas != expected_cas) {
+        return CasResult::Exists;
+    }
+    // Logged as a plain put: replay only needs the final value
+    if (!put_locked(key, value, expires_at_ms, false, &encoded, new_cas)) {
+        return CasResult::Failed;
+    }
+    return CasResult::Stored;
 }
 
 
@@ -177,11 +1275,11 @@ static std::vector<std::string> splitString(const std::string& s, char delimiter
 
 // --- Public Replication API Implementations --- ADD THESE ---
 
-bool LRUCache::applyReplicatedPut(const std::string& key, const std::string& value) {
+bool LRUCache::applyReplicatedPut(const std::string& key, const std::string& value, std::int64_t expires_at_ms) {
     // This public method is called by the replication service.
     // It calls the internal sync method with is_recovery=true
     // to prevent WAL writes and further replication attempts.
-    return put_sync(key, value, /*is_recovery=*/true);
+    return put_sync(key, value, expires_at_ms, /*is_recovery=*/true);
 }
 
 bool LRUCache::applyReplicatedRemove(const std::string& key) {
@@ -191,8 +1289,96 @@ bool LRUCache::applyReplicatedRemove(const std::string& key) {
 }
 // --- END ADD ---
 
-bool LRUCache::loadFromWAL(const std::string& wal_filename, LRUCache& cache_instance) {
-    std::ifstream wal_file(wal_filename);
+std::string LRUCache::walPutRecord(const std::string& key, const std::string& value, std::int64_t expires_at_ms) {
+    return "PUT2," + std::to_string(key.size()) + "," + std::to_string(value.size()) + "," +
+           std::to_string(expires_at_ms) + "," + key + value;
+}
+
+std::string LRUCache::walRemoveRecord(const std::string& key) {
+    return "DEL2," + std::to_string(key.size()) + ",0,0," + key;
+}
+
+std::string LRUCache::walExpireRecord(const std::string& key, std::int64_t expires_at_ms) {
+    return "EXP2," + std::to_string(key.size()) + ",0," + std::to_string(expires_at_ms) + "," + key;
+}
+
+// Reads the rest of a length-prefixed record after its op. False if the
+// record is malformed or cut short (a crash mid-append leaves a partial
+// last record); the stream cannot be resynchronised after either.
+static bool readBinaryRecord(std::istream& in, const std::string& op, WalRecord* record) {
+    constexpr std::uint64_t kMaxFieldBytes = std::uint64_t{1} << 31; // Guards the allocation below
+    std::string fields[3];
+    for (std::string& field : fields) {
+        if (!std::getline(in, field, ',')) return false;
+    }
+    std::uint64_t key_len = 0;
+    std::uint64_t value_len = 0;
+    std::int64_t expires_at_ms = 0;
+    auto parse = [](const std::string& text, auto* out) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), *out);
+        return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    };
+    if (!parse(fields[0], &key_len) || !parse(fields[1], &value_len) || !parse(fields[2], &expires_at_ms) ||
+        key_len > kMaxFieldBytes || value_len > kMaxFieldBytes) {
+        return false;
+    }
+    record->key.resize(key_len);
+    record->value.resize(value_len);
+    if (!in.read(&record->key[0], static_cast<std::streamsize>(key_len)) ||
+        !in.read(&record->value[0], static_cast<std::streamsize>(value_len)) || in.get() != '\n') {
+        return false;
+    }
+    record->expires_at_ms = expires_at_ms;
+    if (op == "PUT2") {
+        record->type = WalRecord::Type::Put;
+    } else if (op == "DEL2" && value_len == 0) {
+        record->type = WalRecord::Type::Remove;
+    } else if (op == "EXP2" && value_len == 0) {
+        record->type = WalRecord::Type::Expire;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Parses a line written by builds before the length-prefixed format.
+static bool parseLegacyRecord(const std::string& line, WalRecord* record) {
+    std::vector<std::string> parts = splitString(line, ',');
+    if (parts.empty()) return false;
+    const std::string& op = parts[0];
+    if (op == "PUT" && parts.size() == 3) {
+        record->type = WalRecord::Type::Put;
+        record->key = parts[1];
+        record->value = parts[2];
+        return true;
+    }
+    if ((op == "PUTX" && parts.size() == 4) || (op == "EXP" && parts.size() == 3)) {
+        // Expiries are absolute, so entries that lapsed while the server
+        // was down come back already expired
+        try {
+            record->expires_at_ms = std::stoll(parts[2]);
+        } catch (const std::exception& e) {
+            return false;
+        }
+        record->key = parts[1];
+        if (op == "PUTX") {
+            record->type = WalRecord::Type::Put;
+            record->value = parts[3];
+        } else {
+            record->type = WalRecord::Type::Expire;
+        }
+        return true;
+    }
+    if (op == "DEL" && parts.size() == 2) {
+        record->type = WalRecord::Type::Remove;
+        record->key = parts[1];
+        return true;
+    }
+    return false;
+}
+
+bool LRUCache::readWAL(const std::string& wal_filename, const std::function<bool(const WalRecord&)>& apply) {
+    std::ifstream wal_file(wal_filename, std::ios::binary);
     if (!wal_file.is_open()) {
         // File might not exist on first run, which is okay.
         if (errno == ENOENT) {
@@ -204,56 +1390,82 @@ bool LRUCache::loadFromWAL(const std::string& wal_filename, LRUCache& cache_inst
     }
 
     std::cout << "Loading cache state from WAL file: " << wal_filename << std::endl;
-    std::string line;
-    int line_num = 0;
+    std::string op;
+    int record_num = 0;
     int applied_puts = 0;
     int applied_dels = 0;
-    while (std::getline(wal_file, line)) {
-        line_num++;
-        if (line.empty()) continue; // Skip empty lines
-
-        std::vector<std::string> parts = splitString(line, ',');
-        if (parts.empty()) {
-             std::cerr << "Warning: Skipping empty or invalid line " << line_num << " in WAL." << std::endl;
-             continue;
+    int applied_expires = 0;
+    while (std::getline(wal_file, op, ',')) {
+        std::size_t line_start = op.rfind('\n');
+        if (line_start != std::string::npos) {
+            if (op.find_first_not_of('\n') < line_start) {
+                std::cerr << "Warning: Skipping WAL line without fields after record " << record_num << std::endl;
+            }
+            op.erase(0, line_start + 1); // Empty lines or a line with no comma end before the op
         }
+        if (op.empty()) continue;
+        record_num++;
 
-        std::string& op = parts[0];
-        if (op == "PUT" && parts.size() == 3) {
-            // Call put_sync with is_recovery = true
-            if (cache_instance.put_sync(parts[1], parts[2], true)) {
-                 applied_puts++;
-            } else {
-                 std::cerr << "Error applying PUT from WAL line " << line_num << std::endl;
-                 // Decide: stop recovery or continue? Let's continue for now.
-            }
-        } else if (op == "DEL" && parts.size() == 2) {
-             // Call remove_sync with is_recovery = true
-            if (cache_instance.remove_sync(parts[1], true)) {
-                applied_dels++;
-            } else {
-                 std::cerr << "Error applying DEL from WAL line " << line_num << std::endl;
+        WalRecord record;
+        if (op == "PUT2" || op == "DEL2" || op == "EXP2") {
+            if (!readBinaryRecord(wal_file, op, &record)) {
+                // Lengths can no longer be trusted, so nothing after this is either
+                std::cerr << "Warning: WAL record " << record_num
+                          << " is truncated or malformed. Ignoring it and the rest of the log." << std::endl;
+                break;
             }
         } else {
-            std::cerr << "Warning: Skipping unrecognized or malformed WAL entry at line "
-                      << line_num << ": " << line << std::endl;
+            std::string rest;
+            std::getline(wal_file, rest);
+            if (!parseLegacyRecord(op + "," + rest, &record)) {
+                std::cerr << "Warning: Skipping unrecognized or malformed WAL entry " << record_num << std::endl;
+                continue;
+            }
+        }
+
+        bool applied = apply(record);
+        switch (record.type) {
+            case WalRecord::Type::Put:    applied_puts += applied; break;
+            case WalRecord::Type::Remove: applied_dels += applied; break;
+            case WalRecord::Type::Expire: applied_expires += applied; break;
+        }
+        if (!applied && record.type != WalRecord::Type::Expire) {
+            std::cerr << "Error applying WAL record " << record_num << std::endl; // Continue with the rest
         }
     }
 
-    std::cout << "WAL recovery complete. Applied " << applied_puts << " PUTs and "
-              << applied_dels << " DELs." << std::endl;
+    std::cout << "WAL recovery complete. Applied " << applied_puts << " PUTs, "
+              << applied_dels << " DELs and " << applied_expires << " EXPs." << std::endl;
     wal_file.close();
     return true;
 }
 
+bool LRUCache::loadFromWAL(const std::string& wal_filename, LRUCache& cache_instance) {
+    // Replay with is_recovery = true so nothing is logged again
+    return readWAL(wal_filename, [&cache_instance](const WalRecord& record) {
+        switch (record.type) {
+            case WalRecord::Type::Put:
+                return cache_instance.put_sync(record.key, record.value, record.expires_at_ms, true);
+            case WalRecord::Type::Remove:
+                return cache_instance.remove_sync(record.key, true);
+            case WalRecord::Type::Expire: {
+                std::lock_guard<CacheMutex> lock(cache_instance.mtx);
+                return cache_instance.expire_locked(record.key, record.expires_at_ms, true) == CacheOp::Status::Ok;
+            }
+        }
+        return false;
+    });
+}
+
 
 // --- Helper Methods (Unchanged, but need lock acquisition) ---
 void LRUCache::addNodeToHead(Node* node) {
     // Assumes lock is held
-    node->next = head->next;
-    node->prev = head;
-    head->next->prev = node;
-    head->next = node;
+    Node* list_head = node->large ? large_head : head; // Large objects keep their own LRU order
+    node->next = list_head->next;
+    node->prev = list_head;
+    list_head->next->prev = node;
+    list_head->next = node;
 }
 
 void LRUCache::removeNodeFromList(Node* node) {
@@ -267,6 +1479,11 @@ void LRUCache::moveToHead(Node* node) {
     // Assumes lock is held
     removeNodeFromList(node);
     addNodeToHead(node);
+    if (node->slab_ref.valid()) {
+        // Keep the per-class LRU order in step with the main list
+        unlinkClass(node);
+        linkClassHead(node);
+    }
 }
 
 Node* LRUCache::popTail() {
@@ -281,26 +1498,47 @@ Node* LRUCache::popTail() {
 void LRUCache::removeInternal(Node* node) {
     // Assumes lock is held
     if (node == nullptr) return;
-    cache.erase(node->key); // Remove from map first
+    indexErase(node); // Remove from map first
     removeNodeFromList(node); // Then from list
-    delete node; // Free memory
+    releaseValue(node);
+    destroyNode(node); // Free memory
 }
 
 bool LRUCache::isExpired(const Node* node) const {
     // Assumes lock is held (or called from method holding lock)
+    if (node->expires_at_ms != 0) {
+        return nowUnixMs() >= node->expires_at_ms; // Explicit deadline replaces the inactivity TTL
+    }
     if (ttl_seconds <= 0) return false;
     auto now = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - node->timestamp);
     return duration.count() > ttl_seconds;
 }
 
+std::size_t LRUCache::size() const {
+    std::lock_guard<CacheMutex> lock(mtx);
+    return cache.size();
+}
+
 void LRUCache::print() const {
-    std::lock_guard<std::mutex> lock(mtx); // Use mutable mtx
+    std::lock_guard<CacheMutex> lock(mtx); // Use mutable mtx
     Node* current = head->next;
     std::cout << "Cache State (Head -> Tail): [ ";
     while (current != tail) {
-        std::cout << "(" << current->key << ": " << current->value << ") ";
+        std::cout << "(" << keyOf(current) << ": " << loadValue(current) << ") ";
         current = current->next;
     }
     std::cout << "]" << std::endl;
+    if (large_count_ > 0) {
+        std::cout << "Large objects: " << large_count_ << " (" << large_bytes_ << " of " << large_budget_
+                  << " bytes)" << std::endl;
+    }
+    if (key_table_) {
+        std::cout << "Key prefixes: " << key_table_->uniqueValues() << " distinct, "
+                  << key_table_->savedBytes() << " bytes saved" << std::endl;
+    }
+    if (value_table_) {
+        std::cout << "Dedup: " << value_table_->uniqueValues() << " distinct values, "
+                  << value_table_->savedBytes() << " bytes saved" << std::endl;
+    }
 }
\ No newline at end of file
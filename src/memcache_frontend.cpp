@@ -0,0 +1,369 @@
+#include "memcache_frontend.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+
+namespace {
+
+const char* const kServerVersion = "lru-cache-1.0";
+constexpr std::size_t kMaxKeyLength = 250;       // memcached protocol limit
+constexpr std::size_t kMaxLineLength = 8 * 1024; // Longest command line we buffer
+constexpr std::size_t kMaxItemBytes = 1024 * 1024; // memcached's default item size limit (-I 1m)
+
+// --- Binary protocol constants ---
+constexpr unsigned char kRequestMagic = 0x80;
+constexpr unsigned char kResponseMagic = 0x81;
+constexpr std::size_t kHeaderBytes = 24;
+
+enum BinaryOpcode : unsigned char {
+    kGet = 0x00, kSet = 0x01, kDelete = 0x04, kQuit = 0x07, kGetQ = 0x09,
+    kNoop = 0x0a, kVersion = 0x0b, kGetK = 0x0c, kGetKQ = 0x0d,
+    kSetQ = 0x11, kDeleteQ = 0x14, kQuitQ = 0x17
+};
+
+enum BinaryStatus : std::uint16_t {
+    kOk = 0x0000, kKeyNotFound = 0x0001, kKeyExists = 0x0002, kValueTooLarge = 0x0003, kInvalidArguments = 0x0004,
+    kUnknownCommand = 0x0081, kInternalError = 0x0084
+};
+
+std::uint16_t readBe16(const std::string& s, std::size_t at) {
+    return static_cast<std::uint16_t>((static_cast<unsigned char>(s[at]) << 8) |
+                                      static_cast<unsigned char>(s[at + 1]));
+}
+
+std::uint32_t readBe32(const std::string& s, std::size_t at) {
+    std::uint32_t v = 0;
+    for (std::size_t i = 0; i < 4; ++i) v = (v << 8) | static_cast<unsigned char>(s[at + i]);
+    return v;
+}
+
+std::uint64_t readBe64(const std::string& s, std::size_t at) {
+    std::uint64_t v = 0;
+    for (std::size_t i = 0; i < 8; ++i) v = (v << 8) | static_cast<unsigned char>(s[at + i]);
+    return v;
+}
+
+void appendBe(std::string& out, std::uint64_t v, std::size_t bytes) {
+    for (std::size_t i = bytes; i > 0; --i) {
+        out.push_back(static_cast<char>((v >> (8 * (i - 1))) & 0xff));
+    }
+}
+
+void appendBinaryResponse(std::string& out, unsigned char opcode, std::uint16_t status,
+                          std::uint32_t opaque, std::uint64_t cas, const std::string& extras,
+                          const std::string& key, const std::string& value) {
+    out.push_back(static_cast<char>(kResponseMagic));
+    out.push_back(static_cast<char>(opcode));
+    appendBe(out, key.size(), 2);
+    out.push_back(static_cast<char>(extras.size()));
+    out.push_back(0); // Data type
+    appendBe(out, status, 2);
+    appendBe(out, extras.size() + key.size() + value.size(), 4);
+    appendBe(out, opaque, 4);
+    appendBe(out, cas, 8);
+    out += extras;
+    out += key;
+    out += value;
+}
+
+// memcached exptime: 0 = never, up to 30 days = seconds from now, larger
+// values = absolute Unix time, negative = already expired.
+std::int64_t toExpiresAtMs(std::int64_t exptime) {
+    constexpr std::int64_t kMaxRelativeSeconds = 60 * 60 * 24 * 30;
+    if (exptime == 0) return 0;
+    if (exptime < 0) return 1; // Any past deadline
+    if (exptime <= kMaxRelativeSeconds) return LRUCache::nowUnixMs() + exptime * 1000;
+    return exptime * 1000;
+}
+
+// Decimal digits only: std::stoul would accept "-1" and wrap it
+bool parseSize(const std::string& token, std::size_t* out) {
+    if (token.empty() || token.size() > 19) return false;
+    std::size_t value = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<std::size_t>(c - '0');
+    }
+    *out = value;
+    return true;
+}
+
+std::vector<std::string> tokenize(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::istringstream stream(line);
+    std::string token;
+    while (stream >> token) tokens.push_back(token);
+    return tokens;
+}
+
+} // namespace
+
+// --- Constructor / Destructor ---
+MemcacheFrontend::MemcacheFrontend(ShardedCache& cache, MutationHook on_mutation)
+    : EpollServer("Memcache"), cache_(cache), on_mutation_(std::move(on_mutation)) {}
+
+MemcacheFrontend::~MemcacheFrontend() {
+    stop(); // Join the loops before members used by onData go away
+}
+
+// --- Dispatch ---
+std::size_t MemcacheFrontend::onData(Connection& conn) {
+    if (static_cast<unsigned char>(conn.in[0]) == kRequestMagic) {
+        return processBinary(conn);
+    }
+    return processText(conn);
+}
+
+// --- Text Protocol ---
+std::size_t MemcacheFrontend::processText(Connection& conn) {
+    std::size_t pos = 0;
+    while (pos < conn.in.size() && !conn.close_after_write) {
+        std::size_t eol = conn.in.find('\n', pos);
+        if (eol == std::string::npos) {
+            if (conn.in.size() - pos > kMaxLineLength) {
+                conn.out += "CLIENT_ERROR line too long\r\n";
+                conn.close_after_write = true;
+                return conn.in.size();
+            }
+            break; // Wait for the rest of the line
+        }
+        std::string line = conn.in.substr(pos, eol - pos);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::size_t consumed = eol + 1;
+        if (!handleTextCommand(conn, line, eol + 1, consumed)) {
+            break; // Data block incomplete; re-parse this command when more arrives
+        }
+        pos = consumed;
+    }
+    return pos;
+}
+
+bool MemcacheFrontend::handleTextCommand(Connection& conn, const std::string& line,
+                                         std::size_t line_end, std::size_t& consumed) {
+    std::vector<std::string> tokens = tokenize(line);
+    if (tokens.empty()) {
+        conn.out += "ERROR\r\n";
+        return true;
+    }
+    const std::string& cmd = tokens[0];
+
+    if (cmd == "get" || cmd == "gets") {
+        bool with_cas = cmd == "gets";
+        for (std::size_t i = 1; i < tokens.size(); ++i) {
+            std::optional<CacheEntry> entry = cache_.getWithCas(tokens[i]);
+            if (!entry) continue;
+            conn.out += "VALUE " + tokens[i] + " 0 " + std::to_string(entry->value->size());
+            if (with_cas) conn.out += " " + std::to_string(entry->cas);
+            conn.out += "\r\n";
+            conn.out += *entry->value;
+            conn.out += "\r\n";
+        }
+        conn.out += "END\r\n";
+        return true;
+    }
+
+    if (cmd == "set" || cmd == "cas") {
+        bool is_cas = cmd == "cas";
+        std::size_t needed = is_cas ? 6 : 5;
+        if (tokens.size() < needed || tokens[1].size() > kMaxKeyLength) {
+            conn.out += "CLIENT_ERROR bad command line format\r\n";
+            return true;
+        }
+        std::size_t bytes = 0;
+        std::uint64_t expected_cas = 0;
+        std::int64_t expires_at_ms = 0;
+        try {
+            expires_at_ms = toExpiresAtMs(std::stoll(tokens[3]));
+            if (is_cas) expected_cas = std::stoull(tokens[5]);
+        } catch (const std::exception& e) {
+            conn.out += "CLIENT_ERROR bad command line format\r\n";
+            return true;
+        }
+        if (!parseSize(tokens[4], &bytes) || bytes > kMaxItemBytes) {
+            // The data block cannot be skipped safely, so drop the connection
+            conn.out += "CLIENT_ERROR bad data chunk\r\n";
+            conn.close_after_write = true;
+            return true;
+        }
+        bool noreply = tokens.size() > needed && tokens[needed] == "noreply";
+        if (conn.in.size() - line_end < bytes + 2) {
+            return false; // Data block not complete yet
+        }
+        consumed = line_end + bytes + 2;
+        if (conn.in.compare(line_end + bytes, 2, "\r\n") != 0) {
+            conn.out += "CLIENT_ERROR bad data chunk\r\n";
+            return true;
+        }
+        const std::string& key = tokens[1];
+        std::string value = conn.in.substr(line_end, bytes);
+
+        std::string reply;
+        if (!is_cas) {
+            bool too_large = false;
+            if (cache_.put(key, value, expires_at_ms, &too_large)) {
+                reply = "STORED\r\n";
+                if (on_mutation_) on_mutation_(true, key, value, expires_at_ms);
+            } else if (too_large) {
+                reply = "SERVER_ERROR object too large for cache\r\n";
+            } else {
+                reply = "SERVER_ERROR write failed\r\n";
+            }
+        } else {
+            switch (cache_.compareAndSwap(key, value, expected_cas, expires_at_ms)) {
+                case CasResult::Stored:
+                    reply = "STORED\r\n";
+                    if (on_mutation_) on_mutation_(true, key, value, expires_at_ms);
+                    break;
+                case CasResult::Exists:   reply = "EXISTS\r\n"; break;
+                case CasResult::NotFound: reply = "NOT_FOUND\r\n"; break;
+                case CasResult::TooLarge: reply = "SERVER_ERROR object too large for cache\r\n"; break;
+                case CasResult::Failed:   reply = "SERVER_ERROR write failed\r\n"; break;
+            }
+        }
+        if (!noreply) conn.out += reply;
+        return true;
+    }
+
+    if (cmd == "delete") {
+        if (tokens.size() < 2) {
+            conn.out += "CLIENT_ERROR bad command line format\r\n";
+            return true;
+        }
+        bool noreply = tokens.size() > 2 && tokens.back() == "noreply";
+        bool existed = false;
+        std::string reply;
+        if (!cache_.remove(tokens[1], &existed)) {
+            reply = "SERVER_ERROR write failed\r\n";
+        } else if (existed) {
+            reply = "DELETED\r\n";
+            if (on_mutation_) on_mutation_(false, tokens[1], "", 0);
+        } else {
+            reply = "NOT_FOUND\r\n";
+        }
+        if (!noreply) conn.out += reply;
+        return true;
+    }
+
+    if (cmd == "version") {
+        conn.out += std::string("VERSION ") + kServerVersion + "\r\n";
+    } else if (cmd == "quit") {
+        conn.close_after_write = true;
+    } else {
+        conn.out += "ERROR\r\n";
+    }
+    return true;
+}
+
+// --- Binary Protocol ---
+std::size_t MemcacheFrontend::processBinary(Connection& conn) {
+    const std::string& in = conn.in;
+    std::size_t pos = 0;
+    while (in.size() - pos >= kHeaderBytes && !conn.close_after_write) {
+        if (static_cast<unsigned char>(in[pos]) != kRequestMagic) {
+            conn.close_after_write = true; // Lost framing; nothing sensible to reply
+            return in.size();
+        }
+        unsigned char opcode = static_cast<unsigned char>(in[pos + 1]);
+        std::uint16_t key_len = readBe16(in, pos + 2);
+        unsigned char extras_len = static_cast<unsigned char>(in[pos + 4]);
+        std::uint32_t body_len = readBe32(in, pos + 8);
+        std::uint32_t opaque = readBe32(in, pos + 12);
+        std::uint64_t cas = readBe64(in, pos + 16);
+        if (body_len > kMaxItemBytes + kMaxKeyLength + 255) { // Value plus the longest key and extras
+            appendBinaryResponse(conn.out, opcode, kValueTooLarge, opaque, 0, "", "", "Too large");
+            conn.close_after_write = true; // Not buffering the body to skip it
+            return in.size();
+        }
+        if (in.size() - pos < kHeaderBytes + body_len) {
+            break; // Body not complete yet
+        }
+        std::size_t body = pos + kHeaderBytes;
+        pos = body + body_len;
+        if (static_cast<std::size_t>(extras_len) + key_len > body_len) {
+            appendBinaryResponse(conn.out, opcode, kInvalidArguments, opaque, 0, "", "", "");
+            continue;
+        }
+        std::string key = in.substr(body + extras_len, key_len);
+        std::string value = in.substr(body + extras_len + key_len, body_len - extras_len - key_len);
+        const std::string flags(4, '\0'); // Flags are not stored; always report 0
+
+        switch (opcode) {
+            case kGet: case kGetQ: case kGetK: case kGetKQ: {
+                bool quiet = opcode == kGetQ || opcode == kGetKQ;
+                bool with_key = opcode == kGetK || opcode == kGetKQ;
+                std::optional<CacheEntry> entry = cache_.getWithCas(key);
+                if (entry) {
+                    appendBinaryResponse(conn.out, opcode, kOk, opaque, entry->cas, flags,
+                                         with_key ? key : "", *entry->value);
+                } else if (!quiet) {
+                    appendBinaryResponse(conn.out, opcode, kKeyNotFound, opaque, 0, "",
+                                         with_key ? key : "", "Not found");
+                }
+                break;
+            }
+            case kSet: case kSetQ: {
+                bool quiet = opcode == kSetQ;
+                if (extras_len != 8) {
+                    appendBinaryResponse(conn.out, opcode, kInvalidArguments, opaque, 0, "", "", "");
+                    break;
+                }
+                // Extras: flags (ignored), then exptime
+                std::int64_t expires_at_ms =
+                    toExpiresAtMs(static_cast<std::int32_t>(readBe32(in, body + 4)));
+                std::uint16_t status = kOk;
+                std::uint64_t stored_cas = 0; // Returned so the client can chain a CAS on it
+                if (cas != 0) {
+                    // A non-zero CAS turns SET into compare-and-swap
+                    switch (cache_.compareAndSwap(key, value, cas, expires_at_ms, &stored_cas)) {
+                        case CasResult::Stored:   status = kOk; break;
+                        case CasResult::Exists:   status = kKeyExists; break;
+                        case CasResult::NotFound: status = kKeyNotFound; break;
+                        case CasResult::TooLarge: status = kValueTooLarge; break;
+                        case CasResult::Failed:   status = kInternalError; break;
+                    }
+                } else {
+                    bool too_large = false;
+                    if (!cache_.put(key, value, expires_at_ms, &too_large, &stored_cas)) {
+                        status = too_large ? kValueTooLarge : kInternalError;
+                    }
+                }
+                if (status == kOk && on_mutation_) on_mutation_(true, key, value, expires_at_ms);
+                if (status != kOk || !quiet) {
+                    appendBinaryResponse(conn.out, opcode, status, opaque, stored_cas, "", "", "");
+                }
+                break;
+            }
+            case kDelete: case kDeleteQ: {
+                bool existed = false;
+                std::uint16_t status = kOk;
+                if (!cache_.remove(key, &existed)) {
+                    status = kInternalError;
+                } else if (!existed) {
+                    status = kKeyNotFound;
+                } else if (on_mutation_) {
+                    on_mutation_(false, key, "", 0);
+                }
+                if (status != kOk || opcode == kDelete) {
+                    appendBinaryResponse(conn.out, opcode, status, opaque, 0, "", "", "");
+                }
+                break;
+            }
+            case kNoop:
+                appendBinaryResponse(conn.out, opcode, kOk, opaque, 0, "", "", "");
+                break;
+            case kVersion:
+                appendBinaryResponse(conn.out, opcode, kOk, opaque, 0, "", "", kServerVersion);
+                break;
+            case kQuit: case kQuitQ:
+                if (opcode == kQuit) appendBinaryResponse(conn.out, opcode, kOk, opaque, 0, "", "", "");
+                conn.close_after_write = true;
+                break;
+            default:
+                appendBinaryResponse(conn.out, opcode, kUnknownCommand, opaque, 0, "", "", "Unknown command");
+                break;
+        }
+    }
+    return pos;
+}
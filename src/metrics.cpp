@@ -0,0 +1,324 @@
+#include "metrics.h"
+#include "request_trace.h"
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+const char* const kMetricNames[kMetricCount] = {
+    "hits",
+    "misses",
+    "puts",
+    "deletes",
+    "evictions",
+    "expirations",
+    "hot_replica_hits",
+    "wal_records",
+    "wal_bytes",
+    "wal_flushes",
+    "wal_errors",
+    "replication_enqueued",
+    "replication_sent",
+    "replication_errors",
+    "traces_written",
+    "traces_dropped",
+    "slow_ops",
+};
+
+const char* const kLatencyOpNames[kLatencyOpCount] = {"get", "put", "delete"};
+const char* const kLatencyStageNames[kLatencyStageCount] = {"lock_wait", "critical_section", "wal_write", "total"};
+
+std::size_t seriesIndex(LatencyOp op, LatencyStage stage) {
+    return static_cast<std::size_t>(op) * kLatencyStageCount + static_cast<std::size_t>(stage);
+}
+
+// Gets never write the WAL, so that series is never exported
+bool seriesExported(std::size_t op, std::size_t stage) {
+    return !(op == static_cast<std::size_t>(LatencyOp::Get) &&
+             stage == static_cast<std::size_t>(LatencyStage::WalWrite));
+}
+
+// Blocks of running threads plus the counts of threads that have exited.
+// Only registration, thread exit and reads lock it, never an increment.
+struct Registry {
+    std::mutex mtx;
+    std::vector<std::pair<MetricCounters*, LatencyCounters**>> live; // Latency block is created later
+    std::uint64_t retired[kMetricCount] = {};
+    std::uint64_t retired_buckets[kLatencySeriesCount][kLatencyBuckets] = {};
+    std::uint64_t retired_sum_ns[kLatencySeriesCount] = {};
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry; // Never destroyed: threads may exit after static teardown
+    return *instance;
+}
+} // namespace
+
+struct Metrics::ThreadRegistration {
+    std::unique_ptr<MetricCounters> counters = std::make_unique<MetricCounters>();
+    std::unique_ptr<LatencyCounters> latency_owner;
+    LatencyCounters* latency = nullptr; // Set under the registry lock
+
+    ThreadRegistration() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.live.emplace_back(counters.get(), &latency);
+    }
+
+    ~ThreadRegistration() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for (std::size_t i = 0; i < kMetricCount; ++i) {
+            r.retired[i] += counters->values[i].load(std::memory_order_relaxed);
+        }
+        if (latency) {
+            for (std::size_t s = 0; s < kLatencySeriesCount; ++s) {
+                for (std::size_t b = 0; b < kLatencyBuckets; ++b) {
+                    r.retired_buckets[s][b] += latency->buckets[s][b].load(std::memory_order_relaxed);
+                }
+                r.retired_sum_ns[s] += latency->sum_ns[s].load(std::memory_order_relaxed);
+            }
+        }
+        r.live.erase(std::find_if(r.live.begin(), r.live.end(),
+                                  [this](const auto& entry) { return entry.first == counters.get(); }));
+        // Later thread_local destructors must not touch the blocks
+        local_ = nullptr;
+        local_latency_ = nullptr;
+    }
+
+    static ThreadRegistration& forThisThread() {
+        thread_local ThreadRegistration registration;
+        return registration;
+    }
+};
+
+thread_local MetricCounters* Metrics::local_ = nullptr;
+thread_local LatencyCounters* Metrics::local_latency_ = nullptr;
+std::atomic<bool> Metrics::latency_enabled_{false};
+
+MetricCounters* Metrics::registerThread() {
+    local_ = ThreadRegistration::forThisThread().counters.get();
+    return local_;
+}
+
+LatencyCounters* Metrics::registerLatency() {
+    ThreadRegistration& registration = ThreadRegistration::forThisThread();
+    local_ = registration.counters.get();
+    auto latency = std::make_unique<LatencyCounters>();
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        registration.latency = latency.get();
+    }
+    registration.latency_owner = std::move(latency);
+    local_latency_ = registration.latency;
+    return local_latency_;
+}
+
+// --- Latency ---
+std::size_t Metrics::latencyBucket(std::uint64_t ns) {
+    if (ns < kLatencySubBuckets) {
+        return static_cast<std::size_t>(ns);
+    }
+    unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+    if (exponent >= kLatencyMaxExponent) {
+        return kLatencyBuckets - 1;
+    }
+    std::size_t sub = static_cast<std::size_t>(ns >> (exponent - 4)) & (kLatencySubBuckets - 1);
+    return (exponent - 3) * kLatencySubBuckets + sub;
+}
+
+std::uint64_t Metrics::latencyBucketLowerBound(std::size_t bucket) {
+    if (bucket < kLatencySubBuckets) {
+        return bucket;
+    }
+    unsigned exponent = static_cast<unsigned>(bucket / kLatencySubBuckets) + 3;
+    std::uint64_t sub = bucket % kLatencySubBuckets;
+    return (kLatencySubBuckets + sub) << (exponent - 4);
+}
+
+void Metrics::recordLatency(LatencyOp op, LatencyStage stage, std::uint64_t ns) {
+    LatencyCounters* latency = local_latency_ ? local_latency_ : registerLatency();
+    std::size_t series = seriesIndex(op, stage);
+    std::atomic<std::uint64_t>& slot = latency->buckets[series][latencyBucket(ns)];
+    slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic<std::uint64_t>& sum = latency->sum_ns[series];
+    sum.store(sum.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+}
+
+std::uint64_t HistogramSnapshot::quantileNs(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(count));
+    if (rank == 0) rank = 1;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return b + 1 < kLatencyBuckets ? Metrics::latencyBucketLowerBound(b + 1) - 1
+                                           : Metrics::latencyBucketLowerBound(b);
+        }
+    }
+    return Metrics::latencyBucketLowerBound(buckets.size() - 1);
+}
+
+// --- Reading ---
+std::uint64_t Metrics::read(Metric metric) {
+    std::size_t index = static_cast<std::size_t>(metric);
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    std::uint64_t total = r.retired[index];
+    for (const auto& entry : r.live) {
+        total += entry.first->values[index].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    bool with_latency = latencyTracking();
+    std::uint64_t totals[kMetricCount];
+    std::vector<HistogramSnapshot> histograms(with_latency ? kLatencySeriesCount : 0);
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        std::copy(r.retired, r.retired + kMetricCount, totals);
+        for (std::size_t s = 0; s < histograms.size(); ++s) {
+            histograms[s].buckets.assign(r.retired_buckets[s], r.retired_buckets[s] + kLatencyBuckets);
+            histograms[s].sum_ns = r.retired_sum_ns[s];
+        }
+        for (const auto& entry : r.live) {
+            for (std::size_t i = 0; i < kMetricCount; ++i) {
+                totals[i] += entry.first->values[i].load(std::memory_order_relaxed);
+            }
+            const LatencyCounters* latency = *entry.second;
+            if (latency == nullptr) continue;
+            for (std::size_t s = 0; s < histograms.size(); ++s) {
+                for (std::size_t b = 0; b < kLatencyBuckets; ++b) {
+                    histograms[s].buckets[b] += latency->buckets[s][b].load(std::memory_order_relaxed);
+                }
+                histograms[s].sum_ns += latency->sum_ns[s].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    MetricsSnapshot snapshot;
+    snapshot.counters.reserve(kMetricCount);
+    for (std::size_t i = 0; i < kMetricCount; ++i) {
+        snapshot.counters.emplace_back(kMetricNames[i], totals[i]);
+    }
+    for (std::size_t s = 0; s < histograms.size(); ++s) {
+        std::size_t op = s / kLatencyStageCount;
+        std::size_t stage = s % kLatencyStageCount;
+        if (!seriesExported(op, stage)) continue;
+        HistogramSnapshot& histogram = histograms[s];
+        histogram.op = kLatencyOpNames[op];
+        histogram.stage = kLatencyStageNames[stage];
+        for (std::uint64_t n : histogram.buckets) histogram.count += n;
+        snapshot.histograms.push_back(std::move(histogram));
+    }
+    return snapshot;
+}
+
+const char* Metrics::name(Metric metric) {
+    return kMetricNames[static_cast<std::size_t>(metric)];
+}
+
+// --- Prometheus Text Format ---
+std::string Metrics::formatSeconds(std::uint64_t ns) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(ns) / 1e9);
+    return buffer;
+}
+
+std::string Metrics::formatPrometheus(const MetricsSnapshot& snapshot) {
+    std::string out;
+    for (const auto& counter : snapshot.counters) {
+        std::string name = "lru_cache_" + counter.first + "_total";
+        out += "# TYPE " + name + " counter\n";
+        out += name + " " + std::to_string(counter.second) + "\n";
+    }
+    for (const auto& gauge : snapshot.gauges) {
+        std::string name = "lru_cache_" + gauge.first;
+        out += "# TYPE " + name + " gauge\n";
+        out += name + " " + std::to_string(gauge.second) + "\n";
+    }
+    if (!snapshot.histograms.empty()) {
+        // Cumulative counts at every power of two from 256 ns; each is a
+        // bucket boundary, so no bucket is split
+        out += "# TYPE lru_cache_op_latency_seconds histogram\n";
+        for (const auto& histogram : snapshot.histograms) {
+            std::string labels = "op=\"" + histogram.op + "\",stage=\"" + histogram.stage + "\"";
+            std::uint64_t cumulative = 0;
+            std::size_t bucket = 0;
+            for (unsigned exponent = 8; exponent <= kLatencyMaxExponent; ++exponent) {
+                std::size_t end = (exponent - 3) * kLatencySubBuckets; // First bucket at 2^exponent
+                for (; bucket < end && bucket < kLatencyBuckets; ++bucket) {
+                    cumulative += histogram.buckets[bucket];
+                }
+                out += "lru_cache_op_latency_seconds_bucket{" + labels + ",le=\"" +
+                       formatSeconds(std::uint64_t{1} << exponent) + "\"} " + std::to_string(cumulative) + "\n";
+            }
+            out += "lru_cache_op_latency_seconds_bucket{" + labels + ",le=\"+Inf\"} " +
+                   std::to_string(histogram.count) + "\n";
+            out += "lru_cache_op_latency_seconds_sum{" + labels + "} " + formatSeconds(histogram.sum_ns) + "\n";
+            out += "lru_cache_op_latency_seconds_count{" + labels + "} " + std::to_string(histogram.count) + "\n";
+        }
+    }
+    return out;
+}
+
+// --- OpTimer ---
+thread_local OpTimer* OpTimer::current_ = nullptr;
+
+OpTimer::OpTimer(LatencyOp op, bool record_total)
+    : op_(op),
+      latency_(Metrics::latencyTracking()),
+      trace_(RequestTrace::current()),
+      active_(latency_ || trace_ != nullptr),
+      record_total_(record_total) {
+    if (!active_) {
+        return;
+    }
+    start_ = last_ = std::chrono::steady_clock::now();
+    previous_ = current_;
+    current_ = this;
+}
+
+OpTimer::~OpTimer() {
+    if (!active_) {
+        return;
+    }
+    if (record_total_) {
+        record(LatencyStage::Total, start_);
+    }
+    current_ = previous_;
+}
+
+void OpTimer::mark(LatencyStage stage) {
+    if (!active_) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (latency_) {
+        Metrics::recordLatency(op_, stage,
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count());
+    }
+    if (trace_) {
+        trace_->addSpan(kLatencyStageNames[static_cast<std::size_t>(stage)], last_, now);
+    }
+    last_ = now;
+}
+
+void OpTimer::record(LatencyStage stage, std::chrono::steady_clock::time_point start) {
+    if (!active_) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (latency_) {
+        Metrics::recordLatency(op_, stage, std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+    }
+    if (trace_ && stage != LatencyStage::Total) { // The request's own span covers the total
+        trace_->addSpan(kLatencyStageNames[static_cast<std::size_t>(stage)], start, now);
+    }
+}
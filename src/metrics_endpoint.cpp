@@ -0,0 +1,53 @@
+#include "metrics_endpoint.h"
+#include <utility>
+
+namespace {
+
+constexpr std::size_t kMaxRequestHeader = 8 * 1024;
+
+std::string httpResponse(const std::string& status, const std::string& content_type, const std::string& body) {
+    return "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+} // namespace
+
+MetricsEndpoint::MetricsEndpoint(std::function<std::string()> render)
+    : EpollServer("Metrics"), render_(std::move(render)) {}
+
+MetricsEndpoint::~MetricsEndpoint() {
+    stop(); // Join the loops before render_ goes away
+}
+
+std::size_t MetricsEndpoint::onData(Connection& conn) {
+    if (conn.close_after_write) {
+        return conn.in.size(); // Already answered; ignore anything pipelined after it
+    }
+    std::size_t header_end = conn.in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        if (conn.in.size() > kMaxRequestHeader) {
+            conn.out += httpResponse("431 Request Header Fields Too Large", "text/plain", "");
+            conn.close_after_write = true;
+            return conn.in.size();
+        }
+        return 0; // Wait for the rest of the header
+    }
+
+    // Request line: METHOD SP PATH SP VERSION
+    std::string line = conn.in.substr(0, conn.in.find("\r\n"));
+    std::size_t method_end = line.find(' ');
+    std::size_t path_end = method_end == std::string::npos ? std::string::npos : line.find(' ', method_end + 1);
+    std::string method = line.substr(0, method_end);
+    std::string path = path_end == std::string::npos ? "" : line.substr(method_end + 1, path_end - method_end - 1);
+    path = path.substr(0, path.find('?'));
+
+    if (method != "GET") {
+        conn.out += httpResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    } else if (path == "/metrics") {
+        conn.out += httpResponse("200 OK", "text/plain; version=0.0.4", render_());
+    } else {
+        conn.out += httpResponse("404 Not Found", "text/plain", "Try /metrics\n");
+    }
+    conn.close_after_write = true;
+    return conn.in.size();
+}
@@ -0,0 +1,48 @@
+#include "node_pool.h"
+#include <iostream>
+#include <new>
+
+// --- Constructor / Destructor ---
+NodePool::NodePool(const PageOptions& options, std::size_t extent_bytes)
+    : page_options_(options), extent_bytes_(extent_bytes) {
+    if (extent_bytes_ < kSlotBytes) {
+        extent_bytes_ = kSlotBytes;
+    }
+}
+
+NodePool::~NodePool() {
+    // Live nodes are destroyed by the owning cache before the pool goes away
+    for (auto& extent : extents_) {
+        unmapPages(extent);
+    }
+}
+
+// --- Allocation ---
+Node* NodePool::create(const std::string& key) {
+    void* slot = nullptr;
+    if (free_list_ != nullptr) {
+        slot = free_list_;
+        free_list_ = free_list_->next;
+    } else {
+        if (extents_.empty() || extents_.back().bytes - extent_used_ < kSlotBytes) {
+            MappedPages extent = mapPages(extent_bytes_, page_options_);
+            if (extent.base == nullptr) {
+                std::cerr << "ERROR: Failed to map node pool extent." << std::endl;
+                throw std::bad_alloc(); // Same contract as operator new
+            }
+            extents_.push_back(extent);
+            extent_used_ = 0;
+            mapped_bytes_ += extent.bytes;
+        }
+        slot = extents_.back().base + extent_used_;
+        extent_used_ += kSlotBytes;
+    }
+    return new (slot) Node(key, "");
+}
+
+void NodePool::destroy(Node* node) {
+    node->~Node();
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(node);
+    slot->next = free_list_;
+    free_list_ = slot;
+}
@@ -0,0 +1,95 @@
+#include "numa_topology.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h> // MPOL_* constants; syscalls used directly to avoid a libnuma dependency
+
+// --- Helpers ---
+// Parses a sysfs cpulist such as "0-3,8-11".
+static std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        try {
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        } catch (const std::exception& e) { /* skip malformed range */ }
+    }
+    return cpus;
+}
+
+static constexpr unsigned long kMaxNodes = 1024; // Size of the nodemask passed to the kernel
+
+// --- Topology Detection ---
+NumaTopology NumaTopology::detect() {
+    NumaTopology topology;
+    const std::string base = "/sys/devices/system/node";
+    if (DIR* dir = ::opendir(base.c_str())) {
+        while (dirent* entry = ::readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue; // Not a nodeN directory
+            }
+            std::ifstream cpulist(base + "/" + name + "/cpulist");
+            std::string line;
+            std::getline(cpulist, line);
+            NumaNode node;
+            node.id = std::stoi(name.substr(4));
+            node.cpus = parseCpuList(line);
+            if (!node.cpus.empty()) { // Memory-only nodes cannot host workers
+                topology.nodes_.push_back(node);
+            }
+        }
+        ::closedir(dir);
+    }
+
+    if (topology.nodes_.empty()) {
+        NumaNode node;
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < cpus; ++cpu) node.cpus.push_back(static_cast<int>(cpu));
+        topology.nodes_.push_back(node);
+    }
+    std::sort(topology.nodes_.begin(), topology.nodes_.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return topology;
+}
+
+const NumaNode* NumaTopology::findNode(int id) const {
+    for (const auto& node : nodes_) {
+        if (node.id == id) return &node;
+    }
+    return nullptr;
+}
+
+// --- Memory Placement ---
+bool bindMemoryToNode(void* addr, std::size_t len, int node) {
+    if (node < 0 || static_cast<unsigned long>(node) >= kMaxNodes) return false;
+    unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    long rc = ::syscall(SYS_mbind, addr, len, MPOL_PREFERRED, mask, kMaxNodes, 0);
+    return rc == 0; // Fails harmlessly on kernels without NUMA support
+}
+
+ScopedMemoryPolicy::ScopedMemoryPolicy(int node) {
+    if (node < 0 || static_cast<unsigned long>(node) >= kMaxNodes) return;
+    unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    active_ = ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, kMaxNodes) == 0;
+}
+
+ScopedMemoryPolicy::~ScopedMemoryPolicy() {
+    if (active_) {
+        ::syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+    }
+}
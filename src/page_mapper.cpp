@@ -0,0 +1,74 @@
+#include "page_mapper.h"
+#include "numa_topology.h"
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <sys/mman.h>
+
+static std::size_t roundUp(std::size_t bytes, std::size_t align) {
+    return (bytes + align - 1) / align * align;
+}
+
+// Applies the NUMA placement before anything touches the new pages.
+static MappedPages placed(MappedPages pages, const PageOptions& options) {
+    if (pages.base != nullptr && options.numa_node >= 0) {
+        bindMemoryToNode(pages.base, pages.bytes, options.numa_node);
+    }
+    return pages;
+}
+
+MappedPages mapPages(std::size_t bytes, const PageOptions& options) {
+    MappedPages pages;
+    const bool huge_pages = options.huge_pages;
+    if (huge_pages) {
+        std::size_t huge_bytes = roundUp(bytes, kHugePageBytes);
+#ifdef MAP_HUGETLB
+        void* mem = ::mmap(nullptr, huge_bytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            pages.base = static_cast<char*>(mem);
+            pages.bytes = huge_bytes;
+            pages.huge = true;
+            return placed(pages, options);
+        }
+        // Warn once: an empty hugetlb pool is a common deployment mistake
+        static std::atomic<bool> warned{false};
+        if (!warned.exchange(true)) {
+            std::cerr << "Warning: MAP_HUGETLB mapping failed (is vm.nr_hugepages set?). "
+                      << "Falling back to transparent huge pages." << std::endl;
+        }
+#endif
+        bytes = huge_bytes; // Keep THP-eligible mappings 2 MB sized
+    }
+
+    // mmap only guarantees 4 KB alignment, and THP can only back 2 MB
+    // ranges that are 2 MB aligned. Over-map by one huge page and trim the
+    // misaligned head and the leftover tail.
+    std::size_t map_bytes = huge_pages ? bytes + kHugePageBytes : bytes;
+    void* mem = ::mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return pages;
+    }
+    char* base = static_cast<char*>(mem);
+    if (huge_pages) {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(base);
+        std::size_t head = roundUp(address, kHugePageBytes) - address;
+        if (head > 0) {
+            ::munmap(base, head);
+        }
+        ::munmap(base + head + bytes, kHugePageBytes - head); // Never empty: head < kHugePageBytes
+        base += head;
+#ifdef MADV_HUGEPAGE
+        ::madvise(base, bytes, MADV_HUGEPAGE); // Best effort; THP may be disabled system-wide
+#endif
+    }
+    pages.base = base;
+    pages.bytes = bytes;
+    return placed(pages, options);
+}
+
+void unmapPages(const MappedPages& pages) {
+    if (pages.base != nullptr) {
+        ::munmap(pages.base, pages.bytes);
+    }
+}
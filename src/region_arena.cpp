@@ -0,0 +1,133 @@
+#include "region_arena.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+// --- Constructor / Destructor ---
+RegionArena::RegionArena(std::size_t region_bytes, const PageOptions& options)
+    : region_bytes_(region_bytes), page_options_(options) {
+    if (region_bytes_ < 4096) {
+        std::cerr << "Warning: Arena region size " << region_bytes_ << " too small. Using 4096." << std::endl;
+        region_bytes_ = 4096;
+    }
+}
+
+RegionArena::~RegionArena() {
+    for (auto& region : regions_) {
+        unmapPages(region.pages);
+    }
+}
+
+// --- Region Management ---
+// Maps a new region big enough for min_bytes and returns its slot id.
+std::uint32_t RegionArena::openRegion(std::size_t min_bytes) {
+    // Regions are separate mappings so released ones go straight back to the OS
+    std::size_t capacity = std::max(region_bytes_, min_bytes); // Oversized values get their own region
+    MappedPages pages = mapPages(capacity, page_options_);
+    if (pages.base == nullptr) {
+        std::cerr << "ERROR: Failed to map arena region of " << capacity << " bytes." << std::endl;
+        return ArenaSpan::kNoRegion;
+    }
+
+    std::uint32_t id;
+    if (!free_slots_.empty()) {
+        id = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        id = static_cast<std::uint32_t>(regions_.size());
+        regions_.emplace_back();
+    }
+    Region& region = regions_[id];
+    region = Region{};
+    region.pages = pages;
+    mapped_bytes_ += pages.bytes;
+    return id;
+}
+
+// --- Allocation ---
+ArenaSpan RegionArena::allocate(const char* data, std::size_t len) {
+    ArenaSpan span;
+    if (len > UINT32_MAX) {
+        return span; // Offsets/lengths are 32-bit; caller falls back to the heap
+    }
+
+    std::uint32_t target = active_;
+    bool fits = target != ArenaSpan::kNoRegion &&
+                regions_[target].pages.bytes - regions_[target].used >= len;
+    if (!fits) {
+        target = openRegion(len);
+        if (target == ArenaSpan::kNoRegion) {
+            return span;
+        }
+        // Oversized values get a dedicated region; small ones keep
+        // bump-allocating into the active region.
+        if (len <= region_bytes_) {
+            active_ = target;
+        }
+    }
+
+    Region& region = regions_[target];
+    std::memcpy(region.pages.base + region.used, data, len);
+    span.region = target;
+    span.offset = static_cast<std::uint32_t>(region.used);
+    span.length = static_cast<std::uint32_t>(len);
+    region.used += len;
+    region.live += len;
+    live_bytes_ += len;
+    return span;
+}
+
+void RegionArena::release(const ArenaSpan& span) {
+    if (!span.valid() || span.region >= regions_.size()) return;
+    Region& region = regions_[span.region];
+    region.live -= span.length;
+    live_bytes_ -= span.length;
+}
+
+const char* RegionArena::data(const ArenaSpan& span) const {
+    return regions_[span.region].pages.base + span.offset;
+}
+
+std::string RegionArena::read(const ArenaSpan& span) const {
+    if (!span.valid()) return std::string();
+    return std::string(data(span), span.length);
+}
+
+// --- Compaction Support ---
+std::size_t RegionArena::markSparseRegions(double max_live_ratio) {
+    std::size_t marked = 0;
+    for (std::uint32_t id = 0; id < regions_.size(); ++id) {
+        Region& region = regions_[id];
+        if (region.pages.base == nullptr || id == active_ || region.used == 0) {
+            continue;
+        }
+        double ratio = static_cast<double>(region.live) / static_cast<double>(region.used);
+        region.sparse = ratio <= max_live_ratio;
+        if (region.sparse) marked++;
+    }
+    return marked;
+}
+
+bool RegionArena::isSparse(std::uint32_t region) const {
+    return region < regions_.size() && regions_[region].sparse;
+}
+
+std::size_t RegionArena::releaseEmptyRegions() {
+    std::size_t released = 0;
+    for (std::uint32_t id = 0; id < regions_.size(); ++id) {
+        Region& region = regions_[id];
+        if (region.pages.base == nullptr || id == active_ || region.live != 0) {
+            continue;
+        }
+        unmapPages(region.pages);
+        mapped_bytes_ -= region.pages.bytes;
+        released += region.pages.bytes;
+        region = Region{};
+        free_slots_.push_back(id);
+    }
+    return released;
+}
+
+std::size_t RegionArena::regionCount() const {
+    return regions_.size() - free_slots_.size();
+}
@@ -0,0 +1,308 @@
+#include "request_trace.h"
+#include "metrics.h"
+#include "slow_op_log.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+constexpr std::size_t kMaxQueuedTraces = 4096; // Beyond this the writer is behind; new traces are dropped
+constexpr std::size_t kMaxTracedKeyBytes = 256;
+
+struct FinishedTrace {
+    const char* name;
+    std::string key;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    long tid;
+    std::vector<TraceSpan> spans;
+    std::vector<std::pair<const char*, std::int64_t>> args;
+};
+
+// Queue of finished traces and the file they are written to. The file
+// state is touched only by the writer thread, or by start/stop while no
+// writer runs.
+struct TraceWriter {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<FinishedTrace> queue;
+    bool running = false;
+    bool stopping = false;
+    std::thread thread;
+
+    TraceConfig config;
+    std::ofstream file;
+    std::size_t file_bytes = 0;
+    long pid = 0;
+};
+
+TraceWriter& writer() {
+    static TraceWriter* instance = new TraceWriter; // Never destroyed: request threads may outlive statics
+    return *instance;
+}
+
+long currentTid() {
+    thread_local long tid = static_cast<long>(syscall(SYS_gettid));
+    return tid;
+}
+
+// --- Chrome Trace Formatting ---
+void appendEscaped(std::string& out, const std::string& text) {
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7f) { // Keys are bytes; escape so the file stays valid UTF-8
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+}
+
+// Chrome trace timestamps are microseconds
+void appendMicros(std::string& out, std::chrono::steady_clock::duration value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", std::chrono::duration<double, std::micro>(value).count());
+    out += buffer;
+}
+
+void appendCompleteEvent(std::string& out, const char* name, const char* category,
+                         std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+                         long pid, long tid) {
+    out += "{\"name\":\"";
+    out += name;
+    out += "\",\"cat\":\"";
+    out += category;
+    out += "\",\"ph\":\"X\",\"ts\":";
+    appendMicros(out, start.time_since_epoch());
+    out += ",\"dur\":";
+    appendMicros(out, end - start);
+    out += ",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid);
+}
+
+// The request as one event with its steps as events nested inside it
+std::string formatTrace(const FinishedTrace& trace, long pid) {
+    std::string out;
+    appendCompleteEvent(out, trace.name, "request", trace.start, trace.end, pid, trace.tid);
+    out += ",\"args\":{\"key\":\"";
+    appendEscaped(out, trace.key);
+    out += '"';
+    for (const auto& arg : trace.args) {
+        out += ",\"";
+        out += arg.first;
+        out += "\":" + std::to_string(arg.second);
+    }
+    out += "}}";
+    for (const TraceSpan& span : trace.spans) {
+        out += ",\n";
+        appendCompleteEvent(out, span.name, "stage", span.start, span.end, pid, trace.tid);
+        out += '}';
+    }
+    return out;
+}
+
+// --- Trace File ---
+// Shifts path -> path.1 -> path.2 ..., dropping the oldest.
+void shiftFiles(const TraceConfig& config) {
+    if (config.max_files == 0) {
+        std::remove(config.path.c_str());
+        return;
+    }
+    for (std::size_t i = config.max_files - 1; i >= 1; --i) {
+        std::rename((config.path + "." + std::to_string(i)).c_str(),
+                    (config.path + "." + std::to_string(i + 1)).c_str());
+    }
+    std::rename(config.path.c_str(), (config.path + ".1").c_str());
+}
+
+bool openFile(TraceWriter& w) {
+    w.file.open(w.config.path, std::ios::out | std::ios::trunc);
+    if (!w.file.is_open()) {
+        return false;
+    }
+    std::string header = "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(w.pid) +
+                         ",\"args\":{\"name\":\"cache_server\"}}";
+    w.file << header;
+    w.file_bytes = header.size();
+    return true;
+}
+
+// Closes the array so the file is plain JSON (viewers also accept a file
+// cut off without it, as the current one is while being written)
+void closeFile(TraceWriter& w) {
+    if (w.file.is_open()) {
+        w.file << "\n]\n";
+        w.file.close();
+    }
+}
+
+void writeTrace(TraceWriter& w, const FinishedTrace& trace) {
+    std::string events = formatTrace(trace, w.pid);
+    w.file << ",\n" << events;
+    w.file_bytes += events.size() + 2;
+    if (w.file_bytes >= w.config.max_file_bytes) {
+        closeFile(w);
+        shiftFiles(w.config);
+        if (!openFile(w)) {
+            std::cerr << "ERROR: Could not reopen trace file " << w.config.path << std::endl;
+        }
+    }
+}
+
+void writerLoop() {
+    TraceWriter& w = writer();
+    std::unique_lock<std::mutex> lock(w.mtx);
+    for (;;) {
+        w.cv.wait(lock, [&w] { return w.stopping || !w.queue.empty(); });
+        std::deque<FinishedTrace> batch;
+        batch.swap(w.queue);
+        lock.unlock();
+        for (const FinishedTrace& trace : batch) {
+            if (w.file.is_open()) writeTrace(w, trace);
+        }
+        w.file.flush();
+        Metrics::add(Metric::TracesWritten, batch.size());
+        lock.lock();
+        if (w.stopping && w.queue.empty()) {
+            return;
+        }
+    }
+}
+
+void submit(FinishedTrace&& trace) {
+    TraceWriter& w = writer();
+    {
+        std::lock_guard<std::mutex> lock(w.mtx);
+        if (!w.running || w.stopping) {
+            return;
+        }
+        if (w.queue.size() >= kMaxQueuedTraces) {
+            Metrics::add(Metric::TracesDropped);
+            return;
+        }
+        w.queue.push_back(std::move(trace));
+    }
+    w.cv.notify_one();
+}
+} // namespace
+
+// --- RequestTrace ---
+thread_local RequestTrace* RequestTrace::current_ = nullptr;
+
+RequestTrace::RequestTrace(const char* name, const std::string& key) : name_(name), key_(&key) {
+    bool sampled = RequestTracer::enabled() && RequestTracer::sampleThisRequest();
+    // Nested requests (a handler calling another) stay part of the outer trace
+    if ((!sampled && !SlowOpLog::enabled()) || current_) {
+        return;
+    }
+    active_ = true;
+    sampled_ = sampled;
+    start_ = last_ = std::chrono::steady_clock::now();
+    current_ = this;
+}
+
+RequestTrace::~RequestTrace() {
+    if (!active_) {
+        return;
+    }
+    current_ = nullptr;
+    auto end = std::chrono::steady_clock::now();
+    if (SlowOpLog::enabled() && end - start_ >= SlowOpLog::threshold()) {
+        SlowOpLog::record(*this, end - start_);
+    }
+    if (!sampled_ ||
+        end - start_ < std::chrono::nanoseconds(RequestTracer::min_duration_ns_.load(std::memory_order_relaxed))) {
+        return;
+    }
+    submit(FinishedTrace{name_, key_->substr(0, kMaxTracedKeyBytes), start_, end, currentTid(),
+                         std::vector<TraceSpan>(spans_.begin(), spans_.begin() + span_count_),
+                         std::vector<std::pair<const char*, std::int64_t>>(args_.begin(),
+                                                                           args_.begin() + arg_count_)});
+}
+
+void RequestTrace::markSlow(const char* name) {
+    auto now = std::chrono::steady_clock::now();
+    addSpan(name, last_, now);
+    last_ = now;
+}
+
+void RequestTrace::addSpan(const char* name, std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end) {
+    if (active_ && span_count_ < kMaxSpans) {
+        spans_[span_count_++] = TraceSpan{name, start, end};
+    }
+}
+
+std::int64_t RequestTrace::arg(const char* name, std::int64_t fallback) const {
+    for (std::size_t i = arg_count_; i-- > 0;) {
+        if (std::strcmp(args_[i].first, name) == 0) return args_[i].second;
+    }
+    return fallback;
+}
+
+// --- RequestTracer ---
+std::atomic<bool> RequestTracer::enabled_{false};
+std::atomic<std::uint32_t> RequestTracer::sample_rate_{1000};
+std::atomic<std::int64_t> RequestTracer::min_duration_ns_{0};
+
+// Every sample_rate-th request of the calling thread
+bool RequestTracer::sampleThisRequest() {
+    thread_local std::uint32_t countdown = 0;
+    if (countdown == 0) {
+        countdown = sample_rate_.load(std::memory_order_relaxed);
+    }
+    return --countdown == 0;
+}
+
+bool RequestTracer::start(const TraceConfig& config) {
+    TraceWriter& w = writer();
+    std::lock_guard<std::mutex> lock(w.mtx);
+    if (w.running) {
+        return false;
+    }
+    w.config = config;
+    w.config.max_file_bytes = std::max<std::size_t>(w.config.max_file_bytes, 4096);
+    w.pid = static_cast<long>(getpid());
+    shiftFiles(w.config); // Keep the previous run's trace
+    if (!openFile(w)) {
+        std::cerr << "ERROR: Could not open trace file " << config.path << std::endl;
+        return false;
+    }
+    w.running = true;
+    w.stopping = false;
+    w.thread = std::thread(writerLoop);
+
+    sample_rate_.store(std::max<std::uint32_t>(config.sample_rate, 1), std::memory_order_relaxed);
+    min_duration_ns_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(config.min_duration).count(),
+                           std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void RequestTracer::stop() {
+    enabled_.store(false, std::memory_order_relaxed);
+    TraceWriter& w = writer();
+    {
+        std::lock_guard<std::mutex> lock(w.mtx);
+        if (!w.running) {
+            return;
+        }
+        w.stopping = true;
+    }
+    w.cv.notify_all();
+    w.thread.join();
+    std::lock_guard<std::mutex> lock(w.mtx);
+    closeFile(w);
+    w.running = false;
+}
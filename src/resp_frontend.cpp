@@ -0,0 +1,384 @@
+#include "resp_frontend.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+
+namespace {
+
+constexpr std::size_t kMaxBatchCommands = 1024;          // Commands executed per batch
+constexpr std::size_t kMaxInlineLength = 64 * 1024;      // Longest inline command we buffer
+// Same item limit as the memcached listener: larger values are refused
+// before they are buffered, instead of after filling conn.in
+constexpr long long kMaxBulkLength = 1024 * 1024;
+constexpr long long kMaxArgs = 1024 * 1024;
+
+enum class ParseStatus { Complete, Incomplete, Error };
+
+std::string toUpper(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+    return s;
+}
+
+std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+bool parseInteger(const char* begin, const char* end, long long& value) {
+    auto parsed = std::from_chars(begin, end, value);
+    return begin != end && parsed.ec == std::errc() && parsed.ptr == end;
+}
+
+bool parseInteger(const std::string& s, long long& value) {
+    return parseInteger(s.data(), s.data() + s.size(), value);
+}
+
+// Reads the CRLF-terminated integer that follows a '*' or '$' type byte.
+ParseStatus readLength(const std::string& in, std::size_t pos, long long& value, std::size_t& next) {
+    std::size_t eol = in.find("\r\n", pos);
+    if (eol == std::string::npos) {
+        return in.size() - pos > 32 ? ParseStatus::Error : ParseStatus::Incomplete;
+    }
+    if (!parseInteger(in.data() + pos, in.data() + eol, value)) {
+        return ParseStatus::Error;
+    }
+    next = eol + 2;
+    return ParseStatus::Complete;
+}
+
+// Parses one command at pos: a RESP array of bulk strings, or an inline
+// command (space-separated words on one line, as typed into telnet).
+ParseStatus parseCommand(const std::string& in, std::size_t pos, std::vector<std::string>& args,
+                         std::size_t& next, std::string& error) {
+    args.clear();
+    if (in[pos] != '*') {
+        std::size_t eol = in.find('\n', pos);
+        if (eol == std::string::npos) {
+            if (in.size() - pos > kMaxInlineLength) {
+                error = "too big inline request";
+                return ParseStatus::Error;
+            }
+            return ParseStatus::Incomplete;
+        }
+        std::size_t end = (eol > pos && in[eol - 1] == '\r') ? eol - 1 : eol;
+        std::size_t i = pos;
+        while (i < end) {
+            while (i < end && in[i] == ' ') ++i;
+            std::size_t start = i;
+            while (i < end && in[i] != ' ') ++i;
+            if (i > start) args.emplace_back(in, start, i - start);
+        }
+        next = eol + 1;
+        return ParseStatus::Complete;
+    }
+
+    long long count = 0;
+    std::size_t cursor = 0;
+    ParseStatus status = readLength(in, pos + 1, count, cursor);
+    if (status == ParseStatus::Error || count > kMaxArgs) {
+        error = "invalid multibulk length";
+        return ParseStatus::Error;
+    }
+    if (status == ParseStatus::Incomplete) {
+        return status;
+    }
+    for (long long i = 0; i < count; ++i) {
+        if (cursor >= in.size()) {
+            return ParseStatus::Incomplete;
+        }
+        if (in[cursor] != '$') {
+            error = std::string("expected '$', got '") + in[cursor] + "'";
+            return ParseStatus::Error;
+        }
+        long long len = 0;
+        status = readLength(in, cursor + 1, len, cursor);
+        if (status == ParseStatus::Error || len < 0 || len > kMaxBulkLength) {
+            error = "invalid bulk length";
+            return ParseStatus::Error;
+        }
+        if (status == ParseStatus::Incomplete || in.size() - cursor < static_cast<std::size_t>(len) + 2) {
+            return ParseStatus::Incomplete;
+        }
+        if (in.compare(cursor + len, 2, "\r\n") != 0) {
+            error = "expected CRLF after bulk string";
+            return ParseStatus::Error;
+        }
+        args.emplace_back(in, cursor, static_cast<std::size_t>(len));
+        cursor += len + 2;
+    }
+    next = cursor;
+    return ParseStatus::Complete;
+}
+
+// Converts an EX/PX/EXAT/PXAT style argument to an absolute deadline in
+// Unix ms. Returns false on overflow.
+bool toDeadline(const std::string& unit, long long amount, std::int64_t& expires_at_ms) {
+    std::int64_t ms = amount;
+    if ((unit == "EX" || unit == "EXAT") && __builtin_mul_overflow(amount, 1000LL, &ms)) {
+        return false;
+    }
+    if (unit == "EX" || unit == "PX") {
+        return !__builtin_add_overflow(ms, LRUCache::nowUnixMs(), &expires_at_ms);
+    }
+    expires_at_ms = ms;
+    return true;
+}
+
+// --- Reply Encoding ---
+void appendBulk(std::string& out, const std::string& value) {
+    out += "$" + std::to_string(value.size()) + "\r\n";
+    out += value;
+    out += "\r\n";
+}
+
+void appendNull(std::string& out, int protocol) {
+    out += protocol == 3 ? "_\r\n" : "$-1\r\n";
+}
+
+void appendError(std::string& out, const std::string& message) {
+    out += "-" + message + "\r\n";
+}
+
+} // namespace
+
+// --- Constructor / Destructor ---
+RespFrontend::RespFrontend(ShardedCache& cache, MutationHook on_mutation)
+    : EpollServer("RESP"), cache_(cache), on_mutation_(std::move(on_mutation)) {}
+
+RespFrontend::~RespFrontend() {
+    stop(); // Join the loops before members used by onData go away
+}
+
+// --- Batch Processing ---
+std::size_t RespFrontend::onData(Connection& conn) {
+    std::size_t pos = 0;
+    std::string protocol_error;
+    std::vector<Command> commands;
+    std::vector<CacheOp> ops;
+    while (pos < conn.in.size() && !conn.close_after_write) {
+        // Parse everything the client has pipelined so far into one batch
+        commands.clear();
+        ops.clear();
+        while (pos < conn.in.size() && commands.size() < kMaxBatchCommands) {
+            Command command;
+            std::size_t next = pos;
+            if (parseCommand(conn.in, pos, command.args, next, protocol_error) != ParseStatus::Complete) {
+                break;
+            }
+            pos = next;
+            if (command.args.empty()) continue; // Blank inline line
+            command.name = toUpper(command.args[0]);
+            planCommand(command, ops);
+            commands.push_back(std::move(command));
+            if (commands.back().name == "QUIT") break;
+        }
+        if (commands.empty()) {
+            break;
+        }
+
+        if (!ops.empty()) {
+            cache_.executeBatch(ops); // One lock acquisition per shard touched
+        }
+        notifyMutations(ops);
+        for (const Command& command : commands) {
+            writeReply(conn, command, ops);
+        }
+        if (!protocol_error.empty()) {
+            break;
+        }
+    }
+    if (!protocol_error.empty()) {
+        appendError(conn.out, "ERR Protocol error: " + protocol_error);
+        conn.close_after_write = true;
+        return conn.in.size();
+    }
+    return pos;
+}
+
+void RespFrontend::planCommand(Command& command, std::vector<CacheOp>& ops) const {
+    const std::vector<std::string>& args = command.args;
+    const std::string& name = command.name;
+    command.first_op = ops.size();
+    auto addOp = [&ops](CacheOp::Type type, const std::string& key) -> CacheOp& {
+        ops.emplace_back();
+        ops.back().type = type;
+        ops.back().key = key;
+        return ops.back();
+    };
+    auto arityError = [&] {
+        command.error = "ERR wrong number of arguments for '" + toLower(args[0]) + "' command";
+    };
+
+    if (name == "GET") {
+        if (args.size() != 2) return arityError();
+        addOp(CacheOp::Type::Get, args[1]);
+    } else if (name == "MGET") {
+        if (args.size() < 2) return arityError();
+        for (std::size_t i = 1; i < args.size(); ++i) addOp(CacheOp::Type::Get, args[i]);
+    } else if (name == "SET") {
+        if (args.size() < 3) return arityError();
+        std::int64_t expires_at_ms = 0;
+        for (std::size_t i = 3; i < args.size(); ++i) {
+            std::string option = toUpper(args[i]);
+            bool is_expiry = option == "EX" || option == "PX" || option == "EXAT" || option == "PXAT";
+            if (!is_expiry || expires_at_ms != 0 || i + 1 >= args.size()) {
+                command.error = "ERR syntax error"; // NX/XX/GET/KEEPTTL are not supported
+                return;
+            }
+            long long amount = 0;
+            if (!parseInteger(args[++i], amount) || amount <= 0 || !toDeadline(option, amount, expires_at_ms)) {
+                command.error = "ERR invalid expire time in 'set' command";
+                return;
+            }
+        }
+        CacheOp& op = addOp(CacheOp::Type::Put, args[1]);
+        op.value = args[2];
+        op.expires_at_ms = expires_at_ms;
+    } else if (name == "MSET") {
+        if (args.size() < 3 || args.size() % 2 == 0) return arityError();
+        for (std::size_t i = 1; i < args.size(); i += 2) {
+            addOp(CacheOp::Type::Put, args[i]).value = args[i + 1];
+        }
+    } else if (name == "DEL") {
+        if (args.size() < 2) return arityError();
+        for (std::size_t i = 1; i < args.size(); ++i) addOp(CacheOp::Type::Remove, args[i]);
+    } else if (name == "INCR" || name == "DECR" || name == "INCRBY" || name == "DECRBY") {
+        bool by = name == "INCRBY" || name == "DECRBY";
+        if (args.size() != (by ? 3u : 2u)) return arityError();
+        long long delta = 1;
+        if (by && (!parseInteger(args[2], delta) || delta == INT64_MIN)) {
+            command.error = "ERR value is not an integer or out of range";
+            return;
+        }
+        addOp(CacheOp::Type::Incr, args[1]).delta = name[0] == 'D' ? -delta : delta;
+    } else if (name == "EXPIRE" || name == "PEXPIRE") {
+        if (args.size() != 3) return arityError();
+        long long amount = 0;
+        if (!parseInteger(args[2], amount)) {
+            command.error = "ERR value is not an integer or out of range";
+            return;
+        }
+        std::int64_t expires_at_ms = 1; // Non-positive timeouts expire the key at once
+        if (amount > 0 && !toDeadline(name == "EXPIRE" ? "EX" : "PX", amount, expires_at_ms)) {
+            command.error = "ERR invalid expire time in '" + toLower(args[0]) + "' command";
+            return;
+        }
+        addOp(CacheOp::Type::Expire, args[1]).expires_at_ms = expires_at_ms;
+    } else if (name == "PING") {
+        if (args.size() > 2) return arityError();
+    } else if (name == "ECHO") {
+        if (args.size() != 2) return arityError();
+    } else if (name != "HELLO" && name != "QUIT" && name != "COMMAND") {
+        command.error = "ERR unknown command '" + args[0] + "'";
+    }
+    command.op_count = ops.size() - command.first_op;
+}
+
+void RespFrontend::writeReply(Connection& conn, const Command& command, const std::vector<CacheOp>& ops) const {
+    std::string& out = conn.out;
+    const std::string& name = command.name;
+    int protocol = conn.protocol_state == 3 ? 3 : 2;
+    if (!command.error.empty()) {
+        appendError(out, command.error);
+        return;
+    }
+    const CacheOp* first = ops.data() + command.first_op;
+    const CacheOp* last = first + command.op_count;
+    bool too_large = std::any_of(first, last, [](const CacheOp& op) {
+        return op.status == CacheOp::Status::TooLarge;
+    });
+    if (too_large) {
+        appendError(out, "ERR value too large for the cache");
+        return;
+    }
+    bool write_failed = std::any_of(first, last, [](const CacheOp& op) {
+        return op.status == CacheOp::Status::Failed;
+    });
+    if (write_failed) {
+        appendError(out, "ERR write failed");
+        return;
+    }
+
+    if (name == "GET" || name == "MGET") {
+        if (name == "MGET") out += "*" + std::to_string(command.op_count) + "\r\n";
+        for (const CacheOp* op = first; op != last; ++op) {
+            if (op->status == CacheOp::Status::Ok) appendBulk(out, op->result);
+            else appendNull(out, protocol);
+        }
+    } else if (name == "SET" || name == "MSET") {
+        out += "+OK\r\n";
+    } else if (name == "DEL") {
+        long long removed = std::count_if(first, last, [](const CacheOp& op) {
+            return op.status == CacheOp::Status::Ok;
+        });
+        out += ":" + std::to_string(removed) + "\r\n";
+    } else if (name == "INCR" || name == "DECR" || name == "INCRBY" || name == "DECRBY") {
+        if (first->status == CacheOp::Status::NotInteger) {
+            appendError(out, "ERR value is not an integer or out of range");
+        } else {
+            out += ":" + first->result + "\r\n";
+        }
+    } else if (name == "EXPIRE" || name == "PEXPIRE") {
+        out += first->status == CacheOp::Status::Ok ? ":1\r\n" : ":0\r\n";
+    } else if (name == "PING") {
+        if (command.args.size() == 2) appendBulk(out, command.args[1]);
+        else out += "+PONG\r\n";
+    } else if (name == "ECHO") {
+        appendBulk(out, command.args[1]);
+    } else if (name == "COMMAND") {
+        out += "*0\r\n"; // No command table; enough for clients that probe it on connect
+    } else if (name == "QUIT") {
+        out += "+OK\r\n";
+        conn.close_after_write = true;
+    } else if (name == "HELLO") {
+        // HELLO [protover [AUTH user pass] [SETNAME name]]; options are ignored
+        if (command.args.size() >= 2) {
+            long long version = 0;
+            if (!parseInteger(command.args[1], version) || (version != 2 && version != 3)) {
+                appendError(out, "NOPROTO unsupported protocol version");
+                return;
+            }
+            protocol = static_cast<int>(version);
+            conn.protocol_state = protocol;
+        }
+        out += protocol == 3 ? "%7\r\n" : "*14\r\n";
+        appendBulk(out, "server");
+        appendBulk(out, "lru-cache");
+        appendBulk(out, "version");
+        appendBulk(out, "1.0");
+        appendBulk(out, "proto");
+        out += ":" + std::to_string(protocol) + "\r\n";
+        appendBulk(out, "id");
+        out += ":" + std::to_string(conn.fd) + "\r\n";
+        appendBulk(out, "mode");
+        appendBulk(out, "standalone");
+        appendBulk(out, "role");
+        appendBulk(out, "master");
+        appendBulk(out, "modules");
+        out += "*0\r\n";
+    }
+}
+
+// Reports applied writes in their final form: INCR and EXPIRE are
+// replicated as puts of the resulting value and deadline.
+void RespFrontend::notifyMutations(const std::vector<CacheOp>& ops) const {
+    if (!on_mutation_) return;
+    for (const CacheOp& op : ops) {
+        if (op.status != CacheOp::Status::Ok) continue;
+        switch (op.type) {
+            case CacheOp::Type::Put:
+                on_mutation_(true, op.key, op.value, op.expires_at_ms);
+                break;
+            case CacheOp::Type::Remove:
+                on_mutation_(false, op.key, "", 0);
+                break;
+            case CacheOp::Type::Incr:
+            case CacheOp::Type::Expire:
+                on_mutation_(true, op.key, op.result, op.expires_at_ms);
+                break;
+            case CacheOp::Type::Get:
+                break;
+        }
+    }
+}
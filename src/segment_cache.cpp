@@ -0,0 +1,816 @@
+#include "segment_cache.h"
+#include "metrics.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <thread>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+namespace {
+constexpr std::uint64_t kMagic = 0x4C52555345474D31ULL; // "LRUSEGM1"
+constexpr std::uint32_t kLayoutVersion = 3; // 3: keys hashed with LRUCache::hashKey
+constexpr std::size_t kMinBlock = 64;   // Smallest block; class k holds kMinBlock << k bytes
+constexpr std::uint32_t kSizeClasses = 40;
+constexpr std::size_t kMinSegmentBytes = 1 << 20;
+
+constexpr std::uint32_t kBlockUsed = 0x55534544; // "USED"
+constexpr std::uint32_t kBlockFree = 0x46524545; // "FREE"
+
+std::size_t alignUp(std::size_t n, std::size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+void initRobustMutex(pthread_mutex_t* mutex) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+// First word of every heap block, so a freed block can tell whether its
+// buddy is free and of the same size
+struct BlockTag {
+    std::uint32_t size_class;
+    std::uint32_t state; // kBlockUsed or kBlockFree
+};
+
+struct FreeBlock {
+    BlockTag tag;
+    std::uint64_t prev; // Free list of the same class
+    std::uint64_t next;
+};
+} // namespace
+
+// --- Segment Layout ---
+// [Header][bucket offsets][blocks ...]. Offset 0 is the header, so 0 doubles
+// as the null offset everywhere.
+struct SegmentCache::Header {
+    std::atomic<std::uint64_t> magic; // Published last by the creating process
+    std::uint32_t version;
+    std::int32_t ttl_seconds;
+    std::uint64_t segment_bytes;
+    std::uint64_t capacity;
+    std::uint64_t bucket_count;         // Power of two
+    std::uint64_t buckets_offset;
+    std::uint64_t heap_offset;
+    std::uint32_t clean_shutdown;       // File-backed only: 1 while closed cleanly
+    std::uint32_t reserved;
+    pthread_mutex_t mutex;              // Robust + process-shared
+
+    // --- Guarded by mutex ---
+    std::uint64_t lru_head;             // Most recently used entry
+    std::uint64_t lru_tail;             // Eviction candidate
+    std::uint64_t entry_count;
+    std::uint64_t next_cas;
+    std::uint64_t bytes_in_use;         // Sum of allocated block sizes
+    std::uint64_t free_lists[kSizeClasses];
+};
+
+struct SegmentCache::Entry {
+    BlockTag tag;
+    std::uint64_t prev;                 // Towards the head (more recent)
+    std::uint64_t next;                 // Towards the tail
+    std::uint64_t hash_next;            // Bucket chain
+    std::uint64_t hash;
+    std::uint64_t cas;
+    std::int64_t expires_at_ms;         // Absolute deadline (Unix ms), 0 = inactivity TTL
+    std::int64_t accessed_at_ms;        // Wall clock: steady_clock is per boot, not per segment
+    std::uint32_t key_len;
+    std::uint32_t value_len;
+    // Key bytes, then value bytes
+
+    char* key() { return reinterpret_cast<char*>(this + 1); }
+    const char* key() const { return reinterpret_cast<const char*>(this + 1); }
+    char* value() { return key() + key_len; }
+    const char* value() const { return key() + key_len; }
+};
+
+// Holds the segment mutex. If the previous owner died holding it, the
+// entries may be half-linked, so the segment is emptied before use.
+class SegmentCache::Guard {
+public:
+    explicit Guard(SegmentCache& cache) : cache_(cache) {
+        int rc = pthread_mutex_lock(&cache_.header_->mutex);
+        if (rc == EOWNERDEAD) {
+            std::cerr << "Warning: A process died while holding the shared segment lock. "
+                      << "Resetting the segment." << std::endl;
+            cache_.resetLocked();
+            pthread_mutex_consistent(&cache_.header_->mutex);
+            rc = 0;
+        }
+        locked_ = rc == 0;
+        if (!locked_) {
+            std::cerr << "ERROR: Could not lock shared segment: " << std::strerror(rc) << std::endl;
+        }
+    }
+    ~Guard() {
+        if (locked_) pthread_mutex_unlock(&cache_.header_->mutex);
+    }
+    bool locked() const { return locked_; }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+private:
+    SegmentCache& cache_;
+    bool locked_ = false;
+};
+
+// --- Attach / Create ---
+std::unique_ptr<SegmentCache> SegmentCache::openShared(const std::string& name, std::size_t bytes,
+                                                       std::size_t capacity, int ttl_seconds) {
+    bool created = true;
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) {
+        std::cerr << "ERROR: shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    if (created) {
+        bytes = std::max(bytes, kMinSegmentBytes);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+            std::cerr << "ERROR: Could not size shared segment " << name << ": " << std::strerror(errno)
+                      << std::endl;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return nullptr;
+        }
+    } else {
+        // The creator sizes the segment right after creating it
+        struct stat st{};
+        for (int attempt = 0; attempt < 500; ++attempt) {
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        bytes = static_cast<std::size_t>(st.st_size);
+        if (bytes < kMinSegmentBytes) {
+            std::cerr << "ERROR: Shared segment " << name << " was never initialized." << std::endl;
+            ::close(fd);
+            return nullptr;
+        }
+    }
+
+    void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps the segment alive
+    if (base == MAP_FAILED) {
+        std::cerr << "ERROR: Could not map shared segment " << name << ": " << std::strerror(errno) << std::endl;
+        if (created) ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    char* segment = static_cast<char*>(base);
+    Header* header = reinterpret_cast<Header*>(segment);
+    if (created) {
+        format(segment, bytes, capacity, ttl_seconds);
+        std::cout << "Created shared segment " << name << " (" << bytes / (1024 * 1024) << " MB, capacity "
+                  << capacity << ")." << std::endl;
+    } else {
+        // Wait for the creator to publish the formatted header
+        for (int attempt = 0; attempt < 500 && header->magic.load(std::memory_order_acquire) != kMagic;
+             ++attempt) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (header->magic.load(std::memory_order_acquire) != kMagic || header->version != kLayoutVersion ||
+            header->segment_bytes != bytes) {
+            std::cerr << "ERROR: Shared segment " << name << " has an unknown or incomplete layout. "
+                      << "Remove it (/dev/shm" << name << ") and restart." << std::endl;
+            ::munmap(base, bytes);
+            return nullptr;
+        }
+        std::cout << "Attached to shared segment " << name << " (" << bytes / (1024 * 1024) << " MB, capacity "
+                  << header->capacity << ")." << std::endl;
+    }
+    return std::unique_ptr<SegmentCache>(new SegmentCache(segment, bytes, -1));
+}
+
+bool SegmentCache::unlinkShared(const std::string& name) {
+    return ::shm_unlink(name.c_str()) == 0;
+}
+
+std::unique_ptr<SegmentCache> SegmentCache::openFile(const std::string& path, std::size_t bytes,
+                                                     std::size_t capacity, int ttl_seconds, bool* restored) {
+    if (restored) *restored = false;
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        std::cerr << "ERROR: Could not open segment file '" << path << "': " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // One owner at a time: the clean-shutdown marker describes a single run
+    if (::flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        std::cerr << "ERROR: Segment file '" << path << "' is in use by another process." << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+
+    // Reuse the file only if the previous owner marked it clean
+    bool clean = false;
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= kMinSegmentBytes) {
+        Header existing{};
+        if (::pread(fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing))) {
+            clean = existing.magic.load(std::memory_order_relaxed) == kMagic && existing.version == kLayoutVersion &&
+                    existing.segment_bytes == static_cast<std::uint64_t>(st.st_size) &&
+                    existing.clean_shutdown == 1;
+        }
+    }
+    if (clean) {
+        bytes = static_cast<std::size_t>(st.st_size); // Keep the file's layout
+    } else {
+        // New file, older layout or crash: start from zeroed storage
+        bytes = std::max(bytes, kMinSegmentBytes);
+        if (::ftruncate(fd, 0) < 0 || ::ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+            std::cerr << "ERROR: Could not size segment file '" << path << "': " << std::strerror(errno)
+                      << std::endl;
+            ::close(fd);
+            return nullptr;
+        }
+    }
+
+    void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "ERROR: Could not map segment file '" << path << "': " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    char* segment = static_cast<char*>(base);
+    Header* header = reinterpret_cast<Header*>(segment);
+    if (clean) {
+        // The lock word may hold state from the previous owner's process
+        initRobustMutex(&header->mutex);
+        header->ttl_seconds = ttl_seconds;
+        header->capacity = capacity == 0 ? 1 : capacity; // Shrinking evicts on the next put
+        std::cout << "Restored " << header->entry_count << " entries from segment file " << path
+                  << " without replay." << std::endl;
+    } else {
+        format(segment, bytes, capacity, ttl_seconds);
+        std::cout << "Formatted segment file " << path << " (" << bytes / (1024 * 1024) << " MB, capacity "
+                  << capacity << ")." << std::endl;
+    }
+    // Until close() marks it again, a restart must not trust the contents
+    header->clean_shutdown = 0;
+    ::msync(base, sizeof(Header), MS_SYNC);
+
+    if (restored) *restored = clean;
+    return std::unique_ptr<SegmentCache>(new SegmentCache(segment, bytes, fd));
+}
+
+SegmentCache::SegmentCache(char* base, std::size_t bytes, int file_fd)
+    : base_(base), bytes_(bytes), header_(reinterpret_cast<Header*>(base)), file_fd_(file_fd) {}
+
+SegmentCache::~SegmentCache() {
+    if (file_fd_ >= 0) {
+        // Write everything back before setting the marker, so a crash in
+        // between leaves the file marked dirty
+        {
+            Guard guard(*this);
+            if (guard.locked() && ::msync(base_, bytes_, MS_SYNC) == 0) {
+                header_->clean_shutdown = 1;
+                ::msync(base_, sizeof(Header), MS_SYNC);
+            }
+        }
+        ::close(file_fd_); // Releases the flock
+    }
+    if (base_) ::munmap(base_, bytes_); // The segment itself outlives this process
+}
+
+// --- WAL ---
+void SegmentCache::setWalStream(std::ofstream* stream) {
+    Guard guard(*this);
+    wal_stream_ = stream;
+}
+
+// Assumes lock is held
+bool SegmentCache::writeLogEntry(const std::string& entry) {
+    if (!wal_stream_) {
+        return true; // WAL disabled, treat as success
+    }
+    *wal_stream_ << entry << '\n';
+    if (!wal_stream_->good()) {
+        std::cerr << "ERROR: Failed to write to WAL file!" << std::endl;
+        Metrics::add(Metric::WalErrors);
+        return false;
+    }
+    Metrics::add(Metric::WalRecords);
+    Metrics::add(Metric::WalBytes, entry.size() + 1);
+    if (defer_wal_flush_) {
+        return true; // applyBatch flushes once at the end
+    }
+    wal_stream_->flush();
+    Metrics::add(Metric::WalFlushes);
+    if (!wal_stream_->good()) {
+        Metrics::add(Metric::WalErrors);
+        return false;
+    }
+    return true;
+}
+
+bool SegmentCache::loadFromWAL(const std::string& wal_filename) {
+    return LRUCache::readWAL(wal_filename, [this](const WalRecord& record) {
+        Guard guard(*this);
+        if (!guard.locked()) return false;
+        switch (record.type) {
+            case WalRecord::Type::Put:
+                return putLocked(record.key, record.value, record.expires_at_ms, /*is_recovery=*/true);
+            case WalRecord::Type::Remove:
+                return removeLocked(record.key, /*is_recovery=*/true, nullptr);
+            case WalRecord::Type::Expire:
+                return expireLocked(record.key, record.expires_at_ms, /*is_recovery=*/true) == CacheOp::Status::Ok;
+        }
+        return false;
+    });
+}
+
+void SegmentCache::format(char* base, std::size_t bytes, std::size_t capacity, int ttl_seconds) {
+    Header* header = reinterpret_cast<Header*>(base);
+    std::uint64_t buckets = 64;
+    while (buckets < capacity) buckets <<= 1; // Load factor <= 1
+    // Keep at least half the segment for entries
+    while (buckets > 64 && buckets * sizeof(std::uint64_t) > bytes / 2) buckets >>= 1;
+
+    header->version = kLayoutVersion;
+    header->ttl_seconds = ttl_seconds;
+    header->segment_bytes = bytes;
+    header->capacity = capacity == 0 ? 1 : capacity;
+    header->bucket_count = buckets;
+    header->buckets_offset = alignUp(sizeof(Header), kMinBlock);
+    header->heap_offset = alignUp(header->buckets_offset + buckets * sizeof(std::uint64_t), kMinBlock);
+    header->next_cas = 0;
+
+    header->clean_shutdown = 0;
+    initRobustMutex(&header->mutex);
+
+    SegmentCache view(base, bytes, -1);
+    view.resetLocked(); // Nobody else can see the segment before magic is set
+    view.base_ = nullptr; // Borrowed mapping: keep the destructor from unmapping it
+    header->magic.store(kMagic, std::memory_order_release);
+}
+
+// Assumes lock is held
+void SegmentCache::resetLocked() {
+    std::memset(base_ + header_->buckets_offset, 0, header_->bucket_count * sizeof(std::uint64_t));
+    header_->lru_head = 0;
+    header_->lru_tail = 0;
+    header_->entry_count = 0;
+    header_->bytes_in_use = 0;
+    std::memset(header_->free_lists, 0, sizeof(header_->free_lists));
+    // Carve the heap into the largest naturally aligned blocks that fit
+    std::uint64_t heap_bytes = header_->segment_bytes - header_->heap_offset;
+    std::uint64_t relative = 0;
+    while (relative + kMinBlock <= heap_bytes) {
+        std::uint32_t k = 0;
+        while (k + 1 < kSizeClasses && relative % (kMinBlock << (k + 1)) == 0 &&
+               relative + (kMinBlock << (k + 1)) <= heap_bytes) {
+            ++k;
+        }
+        pushFree(header_->heap_offset + relative, k);
+        relative += kMinBlock << k;
+    }
+}
+
+// --- Offset Helpers ---
+SegmentCache::Entry* SegmentCache::entryAt(std::uint64_t offset) const {
+    return offset == 0 ? nullptr : reinterpret_cast<Entry*>(base_ + offset);
+}
+
+std::uint64_t SegmentCache::offsetOf(const Entry* entry) const {
+    return entry == nullptr ? 0 : static_cast<std::uint64_t>(reinterpret_cast<const char*>(entry) - base_);
+}
+
+std::uint64_t* SegmentCache::bucketFor(std::uint64_t hash) const {
+    auto* buckets = reinterpret_cast<std::uint64_t*>(base_ + header_->buckets_offset);
+    return &buckets[hash & (header_->bucket_count - 1)];
+}
+
+
+// --- Block Allocation (binary buddy system) ---
+// The layout fields read here never change after the segment is created
+bool SegmentCache::blockClassFor(const std::string& key, const std::string& value, std::uint32_t* size_class) const {
+    if (value.size() > UINT32_MAX || key.size() > UINT32_MAX) return false;
+    std::size_t needed = sizeof(Entry) + key.size() + value.size();
+    std::uint32_t k = 0;
+    while (k < kSizeClasses && (kMinBlock << k) < needed) ++k;
+    if (k == kSizeClasses || (kMinBlock << k) > header_->segment_bytes - header_->heap_offset) return false;
+    *size_class = k;
+    return true;
+}
+
+// Block offsets are relative to the heap start; a block of class k at
+// relative offset r has its buddy at r ^ (kMinBlock << k). Freed blocks merge
+// with free buddies, so evicting small entries eventually frees room for
+// large ones. Assumes lock is held.
+std::uint64_t SegmentCache::allocateBlock(std::uint32_t size_class) {
+    for (std::uint32_t k = size_class; k < kSizeClasses; ++k) {
+        std::uint64_t offset = header_->free_lists[k];
+        if (offset == 0) continue;
+        unlinkFree(offset, k);
+        while (k > size_class) {
+            --k; // Return the upper half to the next smaller class
+            pushFree(offset + (kMinBlock << k), k);
+        }
+        auto* tag = reinterpret_cast<BlockTag*>(base_ + offset);
+        tag->size_class = size_class;
+        tag->state = kBlockUsed;
+        header_->bytes_in_use += kMinBlock << size_class;
+        return offset;
+    }
+    return 0; // Full
+}
+
+// Assumes lock is held
+void SegmentCache::freeBlock(std::uint64_t offset, std::uint32_t size_class) {
+    header_->bytes_in_use -= kMinBlock << size_class;
+    std::uint64_t heap_bytes = header_->segment_bytes - header_->heap_offset;
+    std::uint64_t relative = offset - header_->heap_offset;
+    while (size_class + 1 < kSizeClasses) {
+        std::uint64_t block = kMinBlock << size_class;
+        std::uint64_t buddy = relative ^ block;
+        if (buddy + block > heap_bytes) break; // Buddy lies past the end of the heap
+        auto* tag = reinterpret_cast<BlockTag*>(base_ + header_->heap_offset + buddy);
+        if (tag->state != kBlockFree || tag->size_class != size_class) break;
+        unlinkFree(header_->heap_offset + buddy, size_class);
+        tag->state = 0; // Now interior to the merged block
+        relative = std::min(relative, buddy);
+        ++size_class;
+    }
+    pushFree(header_->heap_offset + relative, size_class);
+}
+
+// Assumes lock is held
+void SegmentCache::pushFree(std::uint64_t offset, std::uint32_t size_class) {
+    auto* block = reinterpret_cast<FreeBlock*>(base_ + offset);
+    block->tag.size_class = size_class;
+    block->tag.state = kBlockFree;
+    block->prev = 0;
+    block->next = header_->free_lists[size_class];
+    if (block->next != 0) reinterpret_cast<FreeBlock*>(base_ + block->next)->prev = offset;
+    header_->free_lists[size_class] = offset;
+}
+
+// Assumes lock is held
+void SegmentCache::unlinkFree(std::uint64_t offset, std::uint32_t size_class) {
+    auto* block = reinterpret_cast<FreeBlock*>(base_ + offset);
+    if (block->prev != 0) reinterpret_cast<FreeBlock*>(base_ + block->prev)->next = block->next;
+    else header_->free_lists[size_class] = block->next;
+    if (block->next != 0) reinterpret_cast<FreeBlock*>(base_ + block->next)->prev = block->prev;
+}
+
+// --- Internal Methods (assume lock is held) ---
+SegmentCache::Entry* SegmentCache::findLocked(const std::string& key, std::uint64_t hash) {
+    for (Entry* entry = entryAt(*bucketFor(hash)); entry != nullptr; entry = entryAt(entry->hash_next)) {
+        if (entry->hash == hash && entry->key_len == key.size() &&
+            std::memcmp(entry->key(), key.data(), key.size()) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+SegmentCache::Entry* SegmentCache::findLive(const std::string& key) {
+    Entry* entry = findLocked(key, hashKey(key));
+    if (entry != nullptr && isExpired(entry)) {
+        removeEntry(entry);
+        Metrics::add(Metric::CacheExpirations);
+        return nullptr;
+    }
+    return entry;
+}
+
+bool SegmentCache::isExpired(const Entry* entry) const {
+    if (entry->expires_at_ms != 0) {
+        return LRUCache::nowUnixMs() >= entry->expires_at_ms; // Explicit deadline replaces the inactivity TTL
+    }
+    if (header_->ttl_seconds <= 0) return false;
+    return LRUCache::nowUnixMs() - entry->accessed_at_ms > std::int64_t{header_->ttl_seconds} * 1000;
+}
+
+void SegmentCache::linkHead(Entry* entry) {
+    entry->prev = 0;
+    entry->next = header_->lru_head;
+    if (Entry* old_head = entryAt(header_->lru_head)) {
+        old_head->prev = offsetOf(entry);
+    } else {
+        header_->lru_tail = offsetOf(entry);
+    }
+    header_->lru_head = offsetOf(entry);
+}
+
+void SegmentCache::unlinkList(Entry* entry) {
+    if (Entry* prev = entryAt(entry->prev)) prev->next = entry->next;
+    else header_->lru_head = entry->next;
+    if (Entry* next = entryAt(entry->next)) next->prev = entry->prev;
+    else header_->lru_tail = entry->prev;
+    entry->prev = entry->next = 0;
+}
+
+void SegmentCache::unlinkBucket(Entry* entry) {
+    std::uint64_t target = offsetOf(entry);
+    std::uint64_t* link = bucketFor(entry->hash);
+    while (*link != 0 && *link != target) {
+        link = &entryAt(*link)->hash_next;
+    }
+    if (*link == target) *link = entry->hash_next;
+}
+
+void SegmentCache::removeEntry(Entry* entry) {
+    unlinkBucket(entry);
+    unlinkList(entry);
+    --header_->entry_count;
+    freeBlock(offsetOf(entry), entry->tag.size_class);
+}
+
+void SegmentCache::touch(Entry* entry) {
+    if (header_->lru_head != offsetOf(entry)) {
+        unlinkList(entry);
+        linkHead(entry);
+    }
+    entry->accessed_at_ms = LRUCache::nowUnixMs(); // Reset TTL on access
+}
+
+std::string SegmentCache::valueOf(const Entry* entry) const {
+    return std::string(entry->value(), entry->value_len);
+}
+
+bool SegmentCache::putLocked(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                             bool is_recovery, std::uint64_t* cas) {
+    std::uint64_t hash = hashKey(key);
+    std::uint32_t size_class = 0;
+    if (!blockClassFor(key, value, &size_class)) {
+        return false; // Could never fit
+    }
+
+    // Same record format as LRUCache, so either can replay the other's WAL
+    if (!is_recovery) {
+        if (!writeLogEntry(LRUCache::walPutRecord(key, value, expires_at_ms))) {
+            return false;
+        }
+    }
+
+    Entry* entry = findLocked(key, hash);
+    if (entry != nullptr && entry->tag.size_class == size_class && !isExpired(entry)) {
+        // Same block size: overwrite in place
+        std::memcpy(entry->value(), value.data(), value.size());
+        entry->value_len = static_cast<std::uint32_t>(value.size());
+        entry->cas = ++header_->next_cas;
+        if (cas) *cas = entry->cas;
+        entry->expires_at_ms = expires_at_ms;
+        touch(entry);
+        if (!is_recovery) Metrics::add(Metric::CachePuts);
+        return true;
+    }
+    if (entry != nullptr) {
+        removeEntry(entry); // Frees its block for the new one
+    }
+
+    while (header_->entry_count >= header_->capacity && header_->lru_tail != 0) {
+        removeEntry(entryAt(header_->lru_tail));
+        Metrics::add(Metric::CacheEvictions);
+    }
+    std::uint64_t offset = allocateBlock(size_class);
+    while (offset == 0 && header_->lru_tail != 0) {
+        // Keep evicting until buddies merge into a block of this class
+        removeEntry(entryAt(header_->lru_tail));
+        Metrics::add(Metric::CacheEvictions);
+        offset = allocateBlock(size_class);
+    }
+    if (offset == 0) {
+        return false;
+    }
+
+    entry = entryAt(offset);
+    entry->hash = hash;
+    entry->cas = ++header_->next_cas;
+    if (cas) *cas = entry->cas;
+    entry->expires_at_ms = expires_at_ms;
+    entry->accessed_at_ms = LRUCache::nowUnixMs();
+    entry->key_len = static_cast<std::uint32_t>(key.size());
+    entry->value_len = static_cast<std::uint32_t>(value.size());
+    std::memcpy(entry->key(), key.data(), key.size());
+    std::memcpy(entry->value(), value.data(), value.size());
+    std::uint64_t* bucket = bucketFor(hash);
+    entry->hash_next = *bucket;
+    *bucket = offset;
+    linkHead(entry);
+    ++header_->entry_count;
+    if (!is_recovery) Metrics::add(Metric::CachePuts);
+    return true;
+}
+
+bool SegmentCache::removeLocked(const std::string& key, bool is_recovery, bool* existed) {
+    if (existed) *existed = false;
+    if (!is_recovery) Metrics::add(Metric::CacheDeletes);
+    Entry* entry = findLocked(key, hashKey(key));
+    if (entry == nullptr) {
+        return true;
+    }
+    if (existed) *existed = !isExpired(entry);
+    if (!is_recovery && !writeLogEntry(LRUCache::walRemoveRecord(key))) {
+        return false;
+    }
+    removeEntry(entry);
+    return true;
+}
+
+CacheOp::Status SegmentCache::expireLocked(const std::string& key, std::int64_t expires_at_ms, bool is_recovery) {
+    Entry* entry = findLive(key);
+    if (entry == nullptr) {
+        return CacheOp::Status::NotFound;
+    }
+    if (!is_recovery && !writeLogEntry(LRUCache::walExpireRecord(key, expires_at_ms))) {
+        return CacheOp::Status::Failed;
+    }
+    entry->expires_at_ms = expires_at_ms;
+    return CacheOp::Status::Ok;
+}
+
+// --- Public API ---
+std::optional<std::string> SegmentCache::get(const std::string& key) {
+    Guard guard(*this);
+    if (!guard.locked()) return std::nullopt;
+    Entry* entry = findLive(key);
+    if (entry == nullptr) {
+        Metrics::add(Metric::CacheMisses);
+        return std::nullopt;
+    }
+    Metrics::add(Metric::CacheHits);
+    touch(entry);
+    return valueOf(entry);
+}
+
+bool SegmentCache::put(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                       bool* too_large, std::uint64_t* cas) {
+    std::uint32_t size_class = 0;
+    if (!blockClassFor(key, value, &size_class)) {
+        if (too_large) *too_large = true;
+        return false;
+    }
+    if (too_large) *too_large = false;
+    Guard guard(*this);
+    return guard.locked() && putLocked(key, value, expires_at_ms, false, cas);
+}
+
+bool SegmentCache::remove(const std::string& key, bool* existed) {
+    if (existed) *existed = false;
+    Guard guard(*this);
+    return guard.locked() && removeLocked(key, false, existed);
+}
+
+std::optional<CacheEntry> SegmentCache::getWithCas(const std::string& key) {
+    Guard guard(*this);
+    if (!guard.locked()) return std::nullopt;
+    Entry* entry = findLive(key);
+    if (entry == nullptr) {
+        Metrics::add(Metric::CacheMisses);
+        return std::nullopt;
+    }
+    Metrics::add(Metric::CacheHits);
+    touch(entry);
+    CacheEntry result;
+    result.value = std::make_shared<const std::string>(valueOf(entry));
+    result.cas = entry->cas;
+    return result;
+}
+
+CasResult SegmentCache::compareAndSwap(const std::string& key, const std::string& value, std::uint64_t expected_cas,
+                                       std::int64_t expires_at_ms, std::uint64_t* new_cas) {
+    std::uint32_t size_class = 0;
+    if (!blockClassFor(key, value, &size_class)) return CasResult::TooLarge;
+    Guard guard(*this);
+    if (!guard.locked()) return CasResult::Failed;
+    Entry* entry = findLive(key);
+    if (entry == nullptr) {
+        return CasResult::NotFound;
+    }
+    if (entry->cas != expected_cas) {
+        return CasResult::Exists;
+    }
+    // Logged as a plain put: replay only needs the final value
+    return putLocked(key, value, expires_at_ms, false, new_cas) ? CasResult::Stored : CasResult::Failed;
+}
+
+// --- Batched Access ---
+void SegmentCache::applyBatch(const std::vector<CacheOp*>& ops) {
+    Guard guard(*this);
+    defer_wal_flush_ = true;
+    for (CacheOp* op : ops) {
+        if (!guard.locked()) {
+            op->status = CacheOp::Status::Failed;
+            continue;
+        }
+        applyOp(*op);
+    }
+    defer_wal_flush_ = false;
+    if (guard.locked() && wal_stream_) {
+        wal_stream_->flush();
+        Metrics::add(Metric::WalFlushes);
+        if (!wal_stream_->good()) {
+            std::cerr << "ERROR: Failed to flush WAL after batch!" << std::endl;
+            Metrics::add(Metric::WalErrors);
+        }
+    }
+}
+
+// Assumes lock is held. Mirrors LRUCache::applyOp.
+void SegmentCache::applyOp(CacheOp& op) {
+    switch (op.type) {
+        case CacheOp::Type::Get: {
+            Entry* entry = findLive(op.key);
+            op.status = entry ? CacheOp::Status::Ok : CacheOp::Status::NotFound;
+            Metrics::add(entry ? Metric::CacheHits : Metric::CacheMisses);
+            if (entry) {
+                touch(entry);
+                op.result = valueOf(entry);
+            }
+            break;
+        }
+        case CacheOp::Type::Put: {
+            std::uint32_t size_class = 0;
+            if (!blockClassFor(op.key, op.value, &size_class)) {
+                op.status = CacheOp::Status::TooLarge;
+                break;
+            }
+            op.status = putLocked(op.key, op.value, op.expires_at_ms, false) ? CacheOp::Status::Ok
+                                                                             : CacheOp::Status::Failed;
+            break;
+        }
+        case CacheOp::Type::Remove: {
+            bool existed = false;
+            if (!removeLocked(op.key, false, &existed)) {
+                op.status = CacheOp::Status::Failed;
+            } else {
+                op.status = existed ? CacheOp::Status::Ok : CacheOp::Status::NotFound;
+            }
+            break;
+        }
+        case CacheOp::Type::Expire:
+            op.status = expireLocked(op.key, op.expires_at_ms, false);
+            if (op.status == CacheOp::Status::Ok) {
+                op.result = valueOf(findLocked(op.key, hashKey(op.key)));
+            }
+            break;
+        case CacheOp::Type::Incr: {
+            // Missing keys count from 0; the entry keeps its expiry
+            std::int64_t current = 0;
+            std::int64_t expires_at_ms = 0;
+            if (Entry* entry = findLive(op.key)) {
+                const char* text = entry->value();
+                auto parsed = std::from_chars(text, text + entry->value_len, current);
+                if (entry->value_len == 0 || parsed.ec != std::errc() || parsed.ptr != text + entry->value_len) {
+                    op.status = CacheOp::Status::NotInteger;
+                    break;
+                }
+                expires_at_ms = entry->expires_at_ms;
+            }
+            std::int64_t updated = 0;
+            if (__builtin_add_overflow(current, op.delta, &updated)) {
+                op.status = CacheOp::Status::NotInteger;
+                break;
+            }
+            op.result = std::to_string(updated);
+            op.expires_at_ms = expires_at_ms;
+            op.status = putLocked(op.key, op.result, expires_at_ms, false) ? CacheOp::Status::Ok
+                                                                           : CacheOp::Status::Failed;
+            break;
+        }
+    }
+}
+
+// --- Stats ---
+std::size_t SegmentCache::size() {
+    Guard guard(*this);
+    return guard.locked() ? header_->entry_count : 0;
+}
+
+std::size_t SegmentCache::capacity() const {
+    return header_->capacity;
+}
+
+std::size_t SegmentCache::bytesInUse() {
+    Guard guard(*this);
+    return guard.locked() ? header_->bytes_in_use : 0;
+}
+
+void SegmentCache::print() {
+    Guard guard(*this);
+    if (!guard.locked()) return;
+    std::cout << "Shared Segment (" << header_->entry_count << " entries, " << header_->bytes_in_use
+              << " bytes in blocks) (Head -> Tail): [ ";
+    for (Entry* entry = entryAt(header_->lru_head); entry != nullptr; entry = entryAt(entry->next)) {
+        std::cout << "(" << std::string(entry->key(), entry->key_len) << ": " << valueOf(entry) << ") ";
+    }
+    std::cout << "]" << std::endl;
+}
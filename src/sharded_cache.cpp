@@ -0,0 +1,274 @@
+#include "sharded_cache.h"
+#include "metrics.h"
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+
+// --- Constructor / Destructor ---
+ShardedCache::ShardedCache(std::size_t shard_count, std::size_t capacity, int ttl,
+                           const NumaTopology* numa) {
+    if (shard_count == 0) {
+        std::cerr << "Warning: Invalid shard count 0. Setting to 1." << std::endl;
+        shard_count = 1;
+    }
+    std::size_t per_shard = (capacity + shard_count - 1) / shard_count; // Round up
+    shards_.reserve(shard_count);
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        if (numa) {
+            // First-touch the shard's object, index and sentinels on its node
+            int node = numa->nodeId(i);
+            ScopedMemoryPolicy policy(node);
+            shards_.push_back(std::make_unique<LRUCache>(per_shard, ttl));
+            shards_.back()->setNumaNode(node);
+        } else {
+            shards_.push_back(std::make_unique<LRUCache>(per_shard, ttl));
+        }
+    }
+}
+
+ShardedCache::~ShardedCache() {
+    runtime_.reset(); // Stop the core threads before tearing down their shards
+    for (auto& shard : shards_) {
+        shard->setWalStream(nullptr); // Detach before the streams close
+    }
+    if (segment_) segment_->setWalStream(nullptr);
+}
+
+// --- Routing ---
+std::size_t ShardedCache::shardIndex(const std::string& key) const {
+    // Same hash as the shards' own index, which takes buckets from the low
+    // bits, so routing scales the top bits into [0, shards) instead. FNV-1a
+    // barely changes its top bits between similar keys ("user:1",
+    // "user:2"), so they are mixed with the rest by a multiply first.
+    std::uint64_t h = LRUCache::hashKey(key) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>(((h >> 32) * shards_.size()) >> 32);
+}
+
+void ShardedCache::forEachShard(const std::function<void(LRUCache&)>& fn) {
+    for (auto& shard : shards_) {
+        fn(*shard);
+    }
+}
+
+// --- Thread-per-core Mode ---
+void ShardedCache::startThreadPerCore(const std::vector<int>& cpus) {
+    if (runtime_) return; // Already running
+    runtime_ = std::make_unique<CoreRuntime>(shards_.size(), cpus);
+}
+
+// --- Shared Segment Mode ---
+void ShardedCache::attachSegment(std::unique_ptr<SegmentCache> segment) {
+    segment_ = std::move(segment);
+}
+
+// --- Public API ---
+std::optional<std::string> ShardedCache::get(const std::string& key) {
+    if (segment_) return segment_->get(key);
+    if (hot_replicas_ && hot_replicas_->active()) {
+        std::shared_ptr<const std::string> value;
+        if (getReplicated(key, &value)) {
+            if (!value) return std::nullopt;
+            return *value;
+        }
+    }
+    return route(key, [&](LRUCache& shard) { return shard.get(key); });
+}
+
+std::shared_ptr<const std::string> ShardedCache::getShared(const std::string& key) {
+    if (segment_) {
+        std::optional<std::string> value = segment_->get(key);
+        return value ? std::make_shared<const std::string>(std::move(*value)) : nullptr;
+    }
+    if (hot_replicas_ && hot_replicas_->active()) {
+        std::shared_ptr<const std::string> value;
+        if (getReplicated(key, &value)) {
+            return value;
+        }
+    }
+    return route(key, [&](LRUCache& shard) { return shard.getShared(key); });
+}
+
+// Serves a promoted key from this CPU's copy, refilling it from the shard
+// when outdated. False if the key is not promoted.
+bool ShardedCache::getReplicated(const std::string& key, std::shared_ptr<const std::string>* value) {
+    switch (hot_replicas_->get(key, value)) {
+        case HotKeyReplicas::Lookup::NotHot:
+            return false;
+        case HotKeyReplicas::Lookup::Hit:
+            Metrics::add(Metric::CacheHits);
+            Metrics::add(Metric::HotReplicaHits);
+            return true;
+        case HotKeyReplicas::Lookup::Stale:
+            break;
+    }
+    LRUCache::HotRead read = route(key, [&](LRUCache& shard) { return shard.readHot(key); });
+    if (read.value && read.promoted) {
+        hot_replicas_->fill(key, read.version, read.value, read.expires_at_ms);
+    }
+    *value = std::move(read.value);
+    return true;
+}
+
+bool ShardedCache::put(const std::string& key, const std::string& value, std::int64_t expires_at_ms,
+                       bool* too_large, std::uint64_t* cas) {
+    if (segment_) return segment_->put(key, value, expires_at_ms, too_large, cas);
+    return route(key, [&](LRUCache& shard) { return shard.put(key, value, expires_at_ms, too_large, cas); });
+}
+
+bool ShardedCache::remove(const std::string& key, bool* existed) {
+    if (segment_) return segment_->remove(key, existed);
+    return route(key, [&](LRUCache& shard) { return shard.remove(key, existed); });
+}
+
+std::optional<CacheEntry> ShardedCache::getWithCas(const std::string& key) {
+    if (segment_) return segment_->getWithCas(key);
+    return route(key, [&](LRUCache& shard) { return shard.getWithCas(key); });
+}
+
+CasResult ShardedCache::compareAndSwap(const std::string& key, const std::string& value,
+                                       std::uint64_t expected_cas, std::int64_t expires_at_ms,
+                                       std::uint64_t* new_cas) {
+    if (segment_) return segment_->compareAndSwap(key, value, expected_cas, expires_at_ms, new_cas);
+    return route(key, [&](LRUCache& shard) {
+        return shard.compareAndSwap(key, value, expected_cas, expires_at_ms, new_cas);
+    });
+}
+
+bool ShardedCache::applyReplicatedPut(const std::string& key, const std::string& value,
+                                      std::int64_t expires_at_ms) {
+    if (segment_) return segment_->put(key, value, expires_at_ms); // Logged, so a file segment can recover it
+    return route(key, [&](LRUCache& shard) { return shard.applyReplicatedPut(key, value, expires_at_ms); });
+}
+
+bool ShardedCache::applyReplicatedRemove(const std::string& key) {
+    if (segment_) return segment_->remove(key);
+    return route(key, [&](LRUCache& shard) { return shard.applyReplicatedRemove(key); });
+}
+
+// --- Batched Access ---
+void ShardedCache::executeBatch(std::vector<CacheOp>& ops) {
+    if (segment_) {
+        std::vector<CacheOp*> all;
+        all.reserve(ops.size());
+        for (CacheOp& op : ops) all.push_back(&op);
+        segment_->applyBatch(all);
+        return;
+    }
+    std::vector<std::vector<CacheOp*>> groups(shards_.size());
+    for (CacheOp& op : ops) {
+        groups[shardIndex(op.key)].push_back(&op);
+    }
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+        if (groups[i].empty()) continue;
+        LRUCache& owner = *shards_[i];
+        if (runtime_) {
+            runtime_->execute(i, [&] { owner.applyBatch(groups[i]); });
+        } else {
+            owner.applyBatch(groups[i]);
+        }
+    }
+}
+
+// --- WAL ---
+std::string ShardedCache::walSegmentPath(const std::string& wal_file, std::size_t index,
+                                         std::size_t shard_count) {
+    if (shard_count == 1) {
+        return wal_file; // Unsharded layout stays compatible with existing WAL files
+    }
+    return wal_file + "." + std::to_string(index);
+}
+
+bool ShardedCache::loadFromWAL(const std::string& wal_file) {
+    if (segment_) return segment_->loadFromWAL(wal_file);
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        if (!LRUCache::loadFromWAL(walSegmentPath(wal_file, i, shards_.size()), *shards_[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShardedCache::openWal(const std::string& wal_file) {
+    if (segment_) {
+        auto stream = std::make_unique<std::ofstream>(wal_file, std::ios::app);
+        if (!stream->is_open()) {
+            std::cerr << "ERROR: Could not open WAL file '" << wal_file << "' for appending." << std::endl;
+            return false;
+        }
+        segment_->setWalStream(stream.get());
+        wal_streams_.push_back(std::move(stream));
+        return true;
+    }
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        std::string path = walSegmentPath(wal_file, i, shards_.size());
+        auto stream = std::make_unique<std::ofstream>(path, std::ios::app);
+        if (!stream->is_open()) {
+            std::cerr << "ERROR: Could not open WAL segment '" << path << "' for appending." << std::endl;
+            return false;
+        }
+        shards_[i]->setWalStream(stream.get());
+        wal_streams_.push_back(std::move(stream));
+    }
+    return true;
+}
+
+std::size_t ShardedCache::size() {
+    if (segment_) return segment_->size();
+    std::size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->size();
+    }
+    return total;
+}
+
+// Every key lives in one shard, so the shards' lists merge by sorting alone
+std::vector<HotKeyEstimate> ShardedCache::hotKeys(std::size_t limit) {
+    std::vector<HotKeyEstimate> keys;
+    if (segment_) return keys;
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        for (HotKeyEstimate& estimate : shards_[i]->hotKeys(limit)) {
+            estimate.shard = i;
+            keys.push_back(std::move(estimate));
+        }
+    }
+    std::size_t count = std::min(limit, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + count, keys.end(),
+                      [](const HotKeyEstimate& a, const HotKeyEstimate& b) { return a.count > b.count; });
+    keys.resize(count);
+    return keys;
+}
+
+bool ShardedCache::enableHotKeyReplication(std::chrono::seconds interval, double min_rate,
+                                           std::size_t max_keys_per_shard) {
+    if (segment_ || hotKeySampleRate() == 0) {
+        std::cerr << "Warning: Hot-key replication needs hot-key detection and does not work in segment mode."
+                  << std::endl;
+        return false;
+    }
+    hot_replicas_ = std::make_unique<HotKeyReplicas>();
+    for (const auto& shard : shards_) {
+        shard->startHotKeyReplication(hot_replicas_.get(), interval, min_rate, max_keys_per_shard);
+    }
+    return true;
+}
+
+std::size_t ShardedCache::hotKeysReplicated() const {
+    return hot_replicas_ ? hot_replicas_->promotedCount() : 0;
+}
+
+std::uint32_t ShardedCache::hotKeySampleRate() const {
+    return segment_ ? 0 : shards_.front()->hotKeySampleRate();
+}
+
+void ShardedCache::print() const {
+    if (segment_) {
+        segment_->print();
+        return;
+    }
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        if (shards_.size() > 1) {
+            std::cout << "[Shard " << i << "] ";
+        }
+        shards_[i]->print();
+    }
+}
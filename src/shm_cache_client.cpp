@@ -0,0 +1,136 @@
+#include "shm_cache_client.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// --- Constructor / Destructor ---
+ShmCacheClient::ShmCacheClient(std::chrono::microseconds spin) : spin_(spin) {}
+
+ShmCacheClient::~ShmCacheClient() {
+    close();
+}
+
+// --- Connection ---
+bool ShmCacheClient::connect(const std::string& socket_path) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (base_ != nullptr) return true; // Already connected
+
+    sockaddr_un addr{};
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "ERROR: Unix socket path too long: " << socket_path << std::endl;
+        return false;
+    }
+    socket_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (socket_fd_ < 0 || ::connect(socket_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "ERROR: Could not connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if (socket_fd_ >= 0) ::close(socket_fd_);
+        socket_fd_ = -1;
+        return false;
+    }
+
+    // Handshake: ring size as payload, [memfd, request eventfd, response eventfd]
+    std::uint64_t ring_bytes = 0;
+    iovec iov{&ring_bytes, sizeof(ring_bytes)};
+    int fds[3] = {-1, -1, -1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t received = ::recvmsg(socket_fd_, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (received != static_cast<ssize_t>(sizeof(ring_bytes)) || cmsg == nullptr ||
+        cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        std::cerr << "ERROR: Shared-memory handshake with " << socket_path << " failed." << std::endl;
+        ::close(socket_fd_);
+        socket_fd_ = -1;
+        return false;
+    }
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    request_fd_ = fds[1];
+    response_fd_ = fds[2];
+
+    bytes_ = 2 * ShmRing::footprint(ring_bytes);
+    void* base = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    ::close(fds[0]); // The mapping keeps the segment alive
+    if (base == MAP_FAILED) {
+        std::cerr << "ERROR: Could not map shared rings: " << std::strerror(errno) << std::endl;
+        ::close(socket_fd_);
+        ::close(request_fd_);
+        ::close(response_fd_);
+        socket_fd_ = request_fd_ = response_fd_ = -1;
+        return false;
+    }
+    base_ = base;
+    requests_ = ShmRing(base_, ring_bytes, request_fd_);
+    responses_ = ShmRing(static_cast<char*>(base_) + ShmRing::footprint(ring_bytes), ring_bytes, response_fd_);
+    return true;
+}
+
+void ShmCacheClient::close() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (base_ == nullptr) return;
+    ::munmap(base_, bytes_);
+    ::close(socket_fd_); // Server sees the hangup and ends the session
+    ::close(request_fd_);
+    ::close(response_fd_);
+    base_ = nullptr;
+    socket_fd_ = request_fd_ = response_fd_ = -1;
+}
+
+// --- Requests ---
+// Assumes mtx_ is held
+bool ShmCacheClient::call(shm_protocol::Op op, const std::string& key, const std::string& value) {
+    if (base_ == nullptr) return false;
+    std::uint32_t key_len = static_cast<std::uint32_t>(key.size());
+    request_.clear();
+    request_.push_back(static_cast<char>(op));
+    request_.append(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
+    request_ += key;
+    request_ += value;
+    if (request_.size() > requests_.maxMessage() || !requests_.tryWrite(request_.data(), request_.size())) {
+        return false; // Too large (the ring is otherwise empty between calls)
+    }
+    bool corrupt = false;
+    while (!responses_.tryRead(response_, &corrupt)) {
+        if (corrupt) {
+            std::cerr << "ERROR: Malformed response ring from the cache server." << std::endl;
+            return false;
+        }
+        if (!responses_.waitReadable(spin_, socket_fd_)) {
+            std::cerr << "ERROR: Cache server closed the shared-memory session." << std::endl;
+            return false;
+        }
+    }
+    return !response_.empty();
+}
+
+std::optional<std::string> ShmCacheClient::get(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!call(shm_protocol::kGet, key, "") || response_[0] != static_cast<char>(shm_protocol::kOk)) {
+        return std::nullopt;
+    }
+    return response_.substr(1);
+}
+
+bool ShmCacheClient::put(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return call(shm_protocol::kPut, key, value) && response_[0] == static_cast<char>(shm_protocol::kOk);
+}
+
+bool ShmCacheClient::remove(const std::string& key, bool* existed) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!call(shm_protocol::kDelete, key, "") || response_[0] == static_cast<char>(shm_protocol::kError)) {
+        return false;
+    }
+    if (existed) *existed = response_[0] == static_cast<char>(shm_protocol::kOk);
+    return true;
+}
@@ -0,0 +1,138 @@
+#include "shm_ring.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <thread>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+std::size_t alignUp(std::size_t bytes, std::size_t alignment) {
+    return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+// --- Layout ---
+ShmRing::ShmRing(void* base, std::size_t capacity, int event_fd)
+    : control_(static_cast<ShmRingControl*>(base)),
+      data_(static_cast<char*>(base) + alignUp(sizeof(ShmRingControl), 64)),
+      capacity_(capacity),
+      event_fd_(event_fd) {}
+
+std::size_t ShmRing::footprint(std::size_t capacity) {
+    return alignUp(sizeof(ShmRingControl), 64) + alignUp(capacity, 64);
+}
+
+void ShmRing::initialize(void* base) {
+    new (base) ShmRingControl();
+}
+
+// --- Copy Helpers (handle wrap-around) ---
+void ShmRing::copyIn(std::uint64_t position, const char* src, std::size_t len) {
+    std::size_t offset = static_cast<std::size_t>(position % capacity_);
+    std::size_t first = std::min(len, capacity_ - offset);
+    std::memcpy(data_ + offset, src, first);
+    std::memcpy(data_, src + first, len - first);
+}
+
+void ShmRing::copyOut(std::uint64_t position, char* dst, std::size_t len) const {
+    std::size_t offset = static_cast<std::size_t>(position % capacity_);
+    std::size_t first = std::min(len, capacity_ - offset);
+    std::memcpy(dst, data_ + offset, first);
+    std::memcpy(dst + first, data_, len - first);
+}
+
+// --- Producer Side ---
+bool ShmRing::tryWrite(const char* data, std::size_t len) {
+    std::uint64_t tail = control_->tail.load(std::memory_order_relaxed);
+    std::uint64_t head = control_->head.load(std::memory_order_acquire);
+    std::size_t needed = sizeof(std::uint32_t) + len;
+    if (len > maxMessage() || capacity_ - (tail - head) < needed) {
+        return false;
+    }
+    std::uint32_t length = static_cast<std::uint32_t>(len);
+    copyIn(tail, reinterpret_cast<const char*>(&length), sizeof(length));
+    copyIn(tail + sizeof(length), data, len);
+    // Publish, then check for a sleeping consumer. Both are seq_cst and pair
+    // with the consumer's store of consumer_waiting followed by its load of
+    // tail, so at least one side always sees the other.
+    control_->tail.store(tail + needed, std::memory_order_seq_cst);
+    if (control_->consumer_waiting.load(std::memory_order_seq_cst) != 0) {
+        std::uint64_t one = 1;
+        if (::write(event_fd_, &one, sizeof(one)) < 0) {
+            // Counter saturated; the consumer is awake anyway
+        }
+    }
+    return true;
+}
+
+// --- Consumer Side ---
+bool ShmRing::empty() const {
+    return control_->head.load(std::memory_order_relaxed) == control_->tail.load(std::memory_order_seq_cst);
+}
+
+bool ShmRing::tryRead(std::string& message, bool* corrupt) {
+    std::uint64_t head = control_->head.load(std::memory_order_relaxed);
+    std::uint64_t tail = control_->tail.load(std::memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    // The peer can write anything into the shared segment: validate before
+    // allocating or copying, each value read once
+    std::uint64_t used = tail - head;
+    std::uint32_t length = 0;
+    if (used >= sizeof(length) && used <= capacity_) {
+        copyOut(head, reinterpret_cast<char*>(&length), sizeof(length));
+    }
+    if (used < sizeof(length) || used > capacity_ || length > maxMessage() || sizeof(length) + length > used) {
+        if (corrupt) *corrupt = true;
+        return false;
+    }
+    message.resize(length);
+    copyOut(head + sizeof(length), &message[0], length);
+    control_->head.store(head + sizeof(length) + length, std::memory_order_release);
+    return true;
+}
+
+bool ShmRing::waitReadable(std::chrono::nanoseconds spin, int hangup_fd, const std::atomic<bool>* stop) {
+    // Spin first: a reply usually arrives within a few microseconds. Yield
+    // while spinning so an oversubscribed peer still gets the CPU.
+    auto deadline = std::chrono::steady_clock::now() + spin;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!empty()) return true;
+        if (stop && stop->load(std::memory_order_relaxed)) return false;
+        std::this_thread::yield();
+    }
+
+    while (true) {
+        control_->consumer_waiting.store(1, std::memory_order_seq_cst);
+        if (!empty()) {
+            control_->consumer_waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        if (stop && stop->load()) {
+            control_->consumer_waiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        pollfd fds[2];
+        fds[0] = {event_fd_, POLLIN, 0};
+        fds[1] = {hangup_fd, POLLRDHUP, 0};
+        int ready = ::poll(fds, hangup_fd >= 0 ? 2 : 1, -1);
+        control_->consumer_waiting.store(0, std::memory_order_relaxed);
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            std::uint64_t count = 0;
+            if (::read(event_fd_, &count, sizeof(count)) < 0) {
+                // Already drained by a racing wakeup
+            }
+        }
+        if (hangup_fd >= 0 && (fds[1].revents & (POLLRDHUP | POLLHUP | POLLERR))) {
+            return !empty(); // Peer is gone; drain what it left
+        }
+    }
+}
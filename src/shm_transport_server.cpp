@@ -0,0 +1,279 @@
+#include "shm_transport_server.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <iterator>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// --- Constructor / Destructor ---
+ShmTransportServer::ShmTransportServer(ShardedCache& cache, MutationHook on_mutation, std::size_t ring_bytes,
+                                       std::chrono::microseconds spin)
+    : cache_(cache), on_mutation_(std::move(on_mutation)), ring_bytes_(ring_bytes), spin_(spin) {
+    if (ring_bytes_ < 4096) {
+        std::cerr << "Warning: Shared-memory ring size " << ring_bytes_ << " too small. Using 4096." << std::endl;
+        ring_bytes_ = 4096;
+    }
+}
+
+ShmTransportServer::~ShmTransportServer() {
+    stop();
+}
+
+// --- Lifecycle ---
+bool ShmTransportServer::start(const std::string& socket_path) {
+    sockaddr_un addr{};
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[ShmTransport] Invalid unix socket path: " << socket_path << std::endl;
+        return false;
+    }
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "[ShmTransport] socket failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(socket_path.c_str()); // Stale socket from a previous run
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 64) < 0) {
+        std::cerr << "[ShmTransport] bind(" << socket_path << ") failed: " << std::strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socket_path_ = socket_path;
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stopping_ = false;
+    accept_thread_ = std::thread(&ShmTransportServer::acceptLoop, this);
+    std::cout << "[ShmTransport] Listening on " << socket_path << " (" << ring_bytes_ / 1024
+              << " KB rings)" << std::endl;
+    return true;
+}
+
+void ShmTransportServer::stop() {
+    if (listen_fd_ < 0) return;
+    stopping_ = true;
+    std::uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+        // Accept loop still notices stopping_ on its next wakeup
+    }
+    if (accept_thread_.joinable()) accept_thread_.join();
+
+    // Join outside the lock; exiting session threads only signal wake_fd_
+    std::list<std::unique_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mtx_);
+        sessions.swap(sessions_);
+    }
+    for (auto& session : sessions) {
+        // Wake the session thread if it sleeps on the request eventfd
+        if (::write(session->request_fd, &one, sizeof(one)) < 0) {
+            // Thread is spinning and will see stopping_
+        }
+        if (session->thread.joinable()) session->thread.join();
+        closeSession(*session);
+    }
+    ::close(listen_fd_);
+    ::close(wake_fd_);
+    listen_fd_ = -1;
+    wake_fd_ = -1;
+    ::unlink(socket_path_.c_str());
+}
+
+void ShmTransportServer::acceptLoop() {
+    while (!stopping_) {
+        pollfd fds[2];
+        fds[0] = {listen_fd_, POLLIN, 0};
+        fds[1] = {wake_fd_, POLLIN, 0};
+        if (::poll(fds, 2, -1) < 0 && errno != EINTR) {
+            std::cerr << "[ShmTransport] poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (stopping_) break;
+
+        // Reap sessions whose client went away; each signals wake_fd_ as it exits
+        if (fds[1].revents & POLLIN) {
+            std::uint64_t count = 0;
+            if (::read(wake_fd_, &count, sizeof(count)) < 0) {
+                // Already drained
+            }
+            std::list<std::unique_ptr<Session>> finished;
+            {
+                std::lock_guard<std::mutex> lock(sessions_mtx_);
+                for (auto it = sessions_.begin(); it != sessions_.end();) {
+                    auto next = std::next(it);
+                    if ((*it)->finished) {
+                        finished.splice(finished.end(), sessions_, it);
+                    }
+                    it = next;
+                }
+            }
+            for (auto& session : finished) {
+                session->thread.join();
+                closeSession(*session);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int client = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0 && !openSession(client)) {
+                ::close(client);
+            }
+        }
+    }
+}
+
+// --- Session Setup ---
+// Maps the shared segment, creates the eventfds and hands all three fds to
+// the client along with the ring size.
+bool ShmTransportServer::openSession(int client_fd) {
+    auto session = std::make_unique<Session>();
+    session->socket_fd = client_fd;
+    session->bytes = 2 * ShmRing::footprint(ring_bytes_);
+
+    int memfd = ::memfd_create("lru-cache-shm", MFD_CLOEXEC);
+    if (memfd < 0 || ::ftruncate(memfd, static_cast<off_t>(session->bytes)) < 0) {
+        std::cerr << "[ShmTransport] memfd setup failed: " << std::strerror(errno) << std::endl;
+        if (memfd >= 0) ::close(memfd);
+        return false;
+    }
+    void* base = ::mmap(nullptr, session->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "[ShmTransport] mmap failed: " << std::strerror(errno) << std::endl;
+        ::close(memfd);
+        return false;
+    }
+    session->base = base;
+    ShmRing::initialize(base);
+    ShmRing::initialize(static_cast<char*>(base) + ShmRing::footprint(ring_bytes_));
+    session->request_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    session->response_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // Handshake: ring size as payload, fds as ancillary data
+    std::uint64_t ring_bytes = ring_bytes_;
+    iovec iov{&ring_bytes, sizeof(ring_bytes)};
+    int fds[3] = {memfd, session->request_fd, session->response_fd};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    bool sent = session->request_fd >= 0 && session->response_fd >= 0 &&
+                ::sendmsg(client_fd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(ring_bytes));
+    ::close(memfd); // The mapping keeps the segment alive
+    if (!sent) {
+        std::cerr << "[ShmTransport] Handshake failed: " << std::strerror(errno) << std::endl;
+        session->socket_fd = -1; // Caller closes it
+        closeSession(*session);
+        return false;
+    }
+
+    Session& ref = *session;
+    ref.thread = std::thread([this, &ref] {
+        serve(ref);
+        ref.finished = true;
+        std::uint64_t one = 1;
+        if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+            // Counter saturated; the accept loop is already due to reap
+        }
+    });
+    std::lock_guard<std::mutex> lock(sessions_mtx_);
+    sessions_.push_back(std::move(session));
+    return true;
+}
+
+void ShmTransportServer::closeSession(Session& session) {
+    if (session.base) ::munmap(session.base, session.bytes);
+    if (session.socket_fd >= 0) ::close(session.socket_fd);
+    if (session.request_fd >= 0) ::close(session.request_fd);
+    if (session.response_fd >= 0) ::close(session.response_fd);
+    session.base = nullptr;
+    session.socket_fd = session.request_fd = session.response_fd = -1;
+}
+
+// --- Request Loop ---
+void ShmTransportServer::serve(Session& session) {
+    char* base = static_cast<char*>(session.base);
+    ShmRing requests(base, ring_bytes_, session.request_fd);
+    ShmRing responses(base + ShmRing::footprint(ring_bytes_), ring_bytes_, session.response_fd);
+    std::string request;
+    std::string response;
+    while (!stopping_) {
+        bool corrupt = false;
+        if (!requests.tryRead(request, &corrupt)) {
+            if (corrupt) {
+                std::cerr << "[ShmTransport] ERROR: Malformed request ring; closing the session." << std::endl;
+                break;
+            }
+            if (!requests.waitReadable(spin_, session.socket_fd, &stopping_)) {
+                break; // Client disconnected or server stopping
+            }
+            continue;
+        }
+        handleRequest(request, response);
+        if (response.size() > responses.maxMessage()) {
+            response.assign(1, static_cast<char>(shm_protocol::kError)); // Value larger than the ring
+        }
+        // The client reads its reply before sending the next request, so the
+        // ring only fills if it pipelines; wait for it to catch up
+        while (!responses.tryWrite(response.data(), response.size())) {
+            if (stopping_) return;
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ShmTransportServer::handleRequest(const std::string& request, std::string& response) {
+    response.clear();
+    std::uint32_t key_len = 0;
+    if (request.size() < 1 + sizeof(key_len)) {
+        response.push_back(static_cast<char>(shm_protocol::kError));
+        return;
+    }
+    std::memcpy(&key_len, request.data() + 1, sizeof(key_len));
+    std::size_t key_offset = 1 + sizeof(key_len);
+    if (request.size() - key_offset < key_len) {
+        response.push_back(static_cast<char>(shm_protocol::kError));
+        return;
+    }
+    std::string key = request.substr(key_offset, key_len);
+
+    switch (static_cast<std::uint8_t>(request[0])) {
+        case shm_protocol::kGet: {
+            std::optional<std::string> value = cache_.get(key);
+            response.push_back(static_cast<char>(value ? shm_protocol::kOk : shm_protocol::kNotFound));
+            if (value) response += *value;
+            break;
+        }
+        case shm_protocol::kPut: {
+            // Any bytes: the WAL stores them length-prefixed and replication as proto bytes
+            std::string value = request.substr(key_offset + key_len);
+            bool ok = cache_.put(key, value);
+            response.push_back(static_cast<char>(ok ? shm_protocol::kOk : shm_protocol::kError));
+            if (ok && on_mutation_) on_mutation_(true, key, value, 0);
+            break;
+        }
+        case shm_protocol::kDelete: {
+            bool existed = false;
+            bool ok = cache_.remove(key, &existed);
+            response.push_back(static_cast<char>(!ok ? shm_protocol::kError
+                                                     : existed ? shm_protocol::kOk : shm_protocol::kNotFound));
+            if (ok && existed && on_mutation_) on_mutation_(false, key, "", 0);
+            break;
+        }
+        default:
+            response.push_back(static_cast<char>(shm_protocol::kError));
+            break;
+    }
+}
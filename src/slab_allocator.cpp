@@ -0,0 +1,184 @@
+#include "slab_allocator.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+// --- Constructor / Destructor ---
+SlabAllocator::SlabAllocator(std::size_t page_bytes, std::size_t memory_limit_bytes,
+                             double growth_factor, const PageOptions& options, std::size_t min_chunk_bytes)
+    : page_bytes_(page_bytes), page_options_(options) {
+    if (page_bytes_ < 4096) {
+        std::cerr << "Warning: Slab page size " << page_bytes_ << " too small. Using 4096." << std::endl;
+        page_bytes_ = 4096;
+    }
+    if (growth_factor <= 1.0) {
+        std::cerr << "Warning: Invalid slab growth factor " << growth_factor << ". Using 1.25." << std::endl;
+        growth_factor = 1.25;
+    }
+    max_pages_ = std::max<std::size_t>(1, memory_limit_bytes / page_bytes_);
+
+    // Build the size classes: min, min*f, min*f^2, ... (8-byte aligned), capped by one page
+    std::size_t size = std::max<std::size_t>(8, min_chunk_bytes);
+    while (size < page_bytes_ / 2 && classes_.size() < SlabRef::kNoClass - 1) {
+        SlabClass cls;
+        cls.chunk_size = size;
+        cls.chunks_per_page = static_cast<std::uint32_t>(page_bytes_ / size);
+        classes_.push_back(cls);
+        std::size_t next = static_cast<std::size_t>(static_cast<double>(size) * growth_factor);
+        next = (next + 7) & ~static_cast<std::size_t>(7);
+        size = std::max(next, size + 8);
+    }
+    SlabClass largest;
+    largest.chunk_size = page_bytes_; // Last class holds one value per page
+    largest.chunks_per_page = 1;
+    classes_.push_back(largest);
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (auto& extent : extents_) {
+        unmapPages(extent);
+    }
+}
+
+// --- Class Lookup ---
+std::uint16_t SlabAllocator::classFor(std::size_t len) const {
+    // Classes are sorted by chunk size; binary search for the first that fits
+    auto it = std::lower_bound(classes_.begin(), classes_.end(), len,
+                               [](const SlabClass& cls, std::size_t n) { return cls.chunk_size < n; });
+    if (it == classes_.end()) return SlabRef::kNoClass;
+    return static_cast<std::uint16_t>(it - classes_.begin());
+}
+
+// --- Page Management ---
+void SlabAllocator::assignPage(std::uint32_t page, std::uint16_t cls) {
+    Page& p = pages_[page];
+    p.cls = cls;
+    p.used_chunks = 0;
+    p.carved = 0; // Chunks are handed out front to back before free_chunks is used
+    p.free_chunks.clear();
+    p.owners.assign(classes_[cls].chunks_per_page, nullptr);
+    classes_[cls].pages++;
+    linkPartial(page);
+}
+
+void SlabAllocator::linkPartial(std::uint32_t page) {
+    Page& p = pages_[page];
+    SlabClass& slab_class = classes_[p.cls];
+    p.prev_partial = kNoPage;
+    p.next_partial = slab_class.partial_head;
+    if (slab_class.partial_head != kNoPage) pages_[slab_class.partial_head].prev_partial = page;
+    slab_class.partial_head = page;
+}
+
+void SlabAllocator::unlinkPartial(std::uint32_t page) {
+    Page& p = pages_[page];
+    if (p.prev_partial != kNoPage) {
+        pages_[p.prev_partial].next_partial = p.next_partial;
+    } else {
+        classes_[p.cls].partial_head = p.next_partial;
+    }
+    if (p.next_partial != kNoPage) pages_[p.next_partial].prev_partial = p.prev_partial;
+    p.prev_partial = kNoPage;
+    p.next_partial = kNoPage;
+}
+
+bool SlabAllocator::addPage(std::uint16_t cls) {
+    if (pages_.size() >= max_pages_) {
+        return false; // Memory limit reached
+    }
+    if (extents_.empty() || extents_.back().bytes - extent_used_ < page_bytes_) {
+        std::size_t extent_bytes = page_options_.huge_pages ? std::max(page_bytes_, kHugePageBytes) : page_bytes_;
+        MappedPages extent = mapPages(extent_bytes, page_options_);
+        if (extent.base == nullptr) {
+            std::cerr << "ERROR: Failed to map slab extent of " << extent_bytes << " bytes." << std::endl;
+            return false;
+        }
+        extents_.push_back(extent);
+        extent_used_ = 0;
+    }
+    Page page;
+    page.base = extents_.back().base + extent_used_;
+    extent_used_ += page_bytes_;
+    pages_.push_back(page);
+    assignPage(static_cast<std::uint32_t>(pages_.size() - 1), cls);
+    return true;
+}
+
+// --- Allocation ---
+SlabRef SlabAllocator::allocate(const char* data, std::size_t len, void* owner) {
+    SlabRef ref;
+    std::uint16_t cls = classFor(len);
+    if (cls == SlabRef::kNoClass) {
+        return ref;
+    }
+    SlabClass& slab_class = classes_[cls];
+    if (slab_class.partial_head == kNoPage && !addPage(cls)) {
+        return ref; // Caller evicts from this class's LRU tail and retries
+    }
+
+    std::uint32_t page = slab_class.partial_head;
+    Page& p = pages_[page];
+    std::uint32_t chunk;
+    if (!p.free_chunks.empty()) {
+        chunk = p.free_chunks.back();
+        p.free_chunks.pop_back();
+    } else {
+        chunk = p.carved++;
+    }
+    p.owners[chunk] = owner;
+    slab_class.used_chunks++;
+    if (++p.used_chunks == slab_class.chunks_per_page) {
+        unlinkPartial(page); // Full pages leave the list until a chunk is released
+    }
+
+    std::memcpy(p.base + chunk * slab_class.chunk_size, data, len);
+    ref.cls = cls;
+    ref.page = page;
+    ref.chunk = chunk;
+    ref.length = static_cast<std::uint32_t>(len);
+    return ref;
+}
+
+void SlabAllocator::release(const SlabRef& ref) {
+    if (!ref.valid()) return;
+    SlabClass& slab_class = classes_[ref.cls];
+    Page& p = pages_[ref.page];
+    if (p.used_chunks == slab_class.chunks_per_page) {
+        linkPartial(ref.page);
+    }
+    p.free_chunks.push_back(ref.chunk);
+    p.owners[ref.chunk] = nullptr;
+    slab_class.used_chunks--;
+    p.used_chunks--;
+}
+
+const char* SlabAllocator::data(const SlabRef& ref) const {
+    return pages_[ref.page].base + ref.chunk * classes_[ref.cls].chunk_size;
+}
+
+std::string SlabAllocator::read(const SlabRef& ref) const {
+    if (!ref.valid()) return std::string();
+    return std::string(data(ref), ref.length);
+}
+
+// --- Rebalancing Support ---
+std::uint32_t SlabAllocator::leastUsedPage(std::uint16_t cls) const {
+    std::uint32_t best = UINT32_MAX;
+    for (std::uint32_t id = 0; id < pages_.size(); ++id) {
+        if (pages_[id].cls != cls) continue;
+        if (best == UINT32_MAX || pages_[id].used_chunks < pages_[best].used_chunks) {
+            best = id;
+        }
+    }
+    return best;
+}
+
+bool SlabAllocator::movePage(std::uint32_t page, std::uint16_t to_cls) {
+    if (page >= pages_.size() || pages_[page].used_chunks != 0) {
+        return false;
+    }
+    unlinkPartial(page); // An empty page is always on its class's list
+    classes_[pages_[page].cls].pages--;
+    assignPage(page, to_cls);
+    return true;
+}
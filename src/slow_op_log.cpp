@@ -0,0 +1,189 @@
+#include "slow_op_log.h"
+#include "lru_cache.h"
+#include "metrics.h"
+#include "request_trace.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+constexpr std::size_t kMaxPendingWrites = 4096; // Entries waiting for the file; more are left out of it
+constexpr std::chrono::seconds kFileFlushInterval{1};
+
+// Ring of recent slow ops and the entries not yet in the file
+struct SlowOpState {
+    std::mutex mtx;
+    std::vector<SlowOp> ring; // ring[(sequence - 1) % capacity]
+    std::size_t capacity = 0;
+    std::uint64_t sequence = 0;
+    std::function<std::size_t()> queue_depth;
+
+    std::vector<SlowOp> pending;
+    std::condition_variable cv;
+    bool writing = false;
+    bool stopping = false;
+    std::thread writer;
+    std::ofstream file; // Touched only by the writer thread, or by start/stop while none runs
+};
+
+SlowOpState& state() {
+    static SlowOpState* instance = new SlowOpState; // Never destroyed: request threads may outlive statics
+    return *instance;
+}
+
+// One line per op, e.g.
+// 2026-10-18T10:33:01.123Z Put key_hash=0x1f... shard=3 value_bytes=120 total_us=15230.4 ...
+std::string formatLine(const SlowOp& op) {
+    std::time_t seconds = static_cast<std::time_t>(op.start_unix_ms / 1000);
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+    char buffer[96];
+    std::size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(buffer + length, sizeof(buffer) - length, ".%03dZ %s key_hash=0x%016llx",
+                  static_cast<int>(op.start_unix_ms % 1000), op.op.c_str(),
+                  static_cast<unsigned long long>(op.key_hash));
+    std::string line = buffer;
+    if (op.shard >= 0) line += " shard=" + std::to_string(op.shard);
+    auto micros = [](std::uint64_t ns) {
+        char value[32];
+        std::snprintf(value, sizeof(value), "%.1f", static_cast<double>(ns) / 1000);
+        return std::string(value);
+    };
+    line += " value_bytes=" + std::to_string(op.value_bytes) + " total_us=" + micros(op.total_ns);
+    for (const auto& phase : op.phases) {
+        line += " ";
+        line += phase.first;
+        line += "_us=" + micros(phase.second);
+    }
+    line += " queue_depth=" + std::to_string(op.queue_depth) + "\n";
+    return line;
+}
+
+void writerLoop() {
+    SlowOpState& s = state();
+    std::unique_lock<std::mutex> lock(s.mtx);
+    for (;;) {
+        s.cv.wait_for(lock, kFileFlushInterval, [&s] { return s.stopping; });
+        std::vector<SlowOp> batch;
+        batch.swap(s.pending);
+        bool stopping = s.stopping;
+        lock.unlock();
+        for (const SlowOp& op : batch) {
+            s.file << formatLine(op);
+        }
+        s.file.flush();
+        lock.lock();
+        if (stopping) {
+            return;
+        }
+    }
+}
+} // namespace
+
+std::atomic<bool> SlowOpLog::enabled_{false};
+std::atomic<std::int64_t> SlowOpLog::threshold_ns_{0};
+
+bool SlowOpLog::start(const SlowOpConfig& config) {
+    if (config.threshold.count() <= 0) {
+        return false;
+    }
+    SlowOpState& s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    if (enabled() || s.writing) {
+        return false;
+    }
+    if (!config.path.empty()) {
+        s.file.open(config.path, std::ios::out | std::ios::app);
+        if (!s.file.is_open()) {
+            std::cerr << "ERROR: Could not open slow-op file " << config.path << std::endl;
+            return false;
+        }
+        s.writing = true;
+        s.stopping = false;
+        s.writer = std::thread(writerLoop);
+    }
+    s.capacity = std::max<std::size_t>(config.capacity, 1);
+    s.ring.clear();
+    s.ring.reserve(s.capacity);
+    s.sequence = 0;
+    s.queue_depth = config.queue_depth;
+
+    threshold_ns_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(config.threshold).count(),
+                        std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void SlowOpLog::stop() {
+    enabled_.store(false, std::memory_order_relaxed);
+    SlowOpState& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.queue_depth = nullptr; // Its owner may be going away
+        if (!s.writing) {
+            return;
+        }
+        s.stopping = true;
+    }
+    s.cv.notify_all();
+    s.writer.join();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    s.file.close();
+    s.writing = false;
+}
+
+void SlowOpLog::record(const RequestTrace& trace, std::chrono::steady_clock::duration total) {
+    SlowOp op;
+    op.op = trace.name();
+    op.key_hash = LRUCache::hashKey(trace.key());
+    op.shard = trace.arg("shard", -1);
+    op.value_bytes = static_cast<std::uint64_t>(std::max<std::int64_t>(trace.arg("value_bytes", 0), 0));
+    op.total_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(total).count());
+    op.start_unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           (std::chrono::system_clock::now() - total).time_since_epoch()).count();
+    op.phases.reserve(trace.spanCount());
+    for (std::size_t i = 0; i < trace.spanCount(); ++i) {
+        const TraceSpan& span = trace.span(i);
+        op.phases.emplace_back(span.name, static_cast<std::uint64_t>(
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(span.end - span.start).count()));
+    }
+    Metrics::add(Metric::SlowOps);
+
+    SlowOpState& s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    if (s.queue_depth) {
+        op.queue_depth = s.queue_depth();
+    }
+    op.sequence = ++s.sequence;
+    if (s.writing && s.pending.size() < kMaxPendingWrites) {
+        s.pending.push_back(op);
+    }
+    if (s.ring.size() < s.capacity) {
+        s.ring.push_back(std::move(op));
+    } else {
+        s.ring[(op.sequence - 1) % s.capacity] = std::move(op);
+    }
+}
+
+std::vector<SlowOp> SlowOpLog::recent(std::size_t limit) {
+    SlowOpState& s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    std::size_t count = limit == 0 ? s.ring.size() : std::min(limit, s.ring.size());
+    std::vector<SlowOp> ops;
+    ops.reserve(count);
+    for (std::uint64_t sequence = s.sequence; ops.size() < count; --sequence) {
+        ops.push_back(s.ring[(sequence - 1) % s.capacity]);
+    }
+    return ops;
+}
+
+std::uint64_t SlowOpLog::total() {
+    SlowOpState& s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    return s.sequence;
+}
@@ -0,0 +1,52 @@
+#include "symbolizer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+std::string functionName(const void* address, std::size_t* offset) {
+    Dl_info info;
+    if (dladdr(address, &info) == 0 || info.dli_sname == nullptr) {
+        return std::string();
+    }
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = (status == 0 && demangled) ? demangled : info.dli_sname;
+    std::free(demangled);
+
+    // Drop the parameter list (and a trailing const) to keep names readable
+    const std::string const_suffix = " const";
+    if (name.size() > const_suffix.size() &&
+        name.compare(name.size() - const_suffix.size(), const_suffix.size(), const_suffix) == 0) {
+        name.resize(name.size() - const_suffix.size());
+    }
+    if (!name.empty() && name.back() == ')') {
+        int depth = 0;
+        for (std::size_t i = name.size(); i-- > 0;) {
+            if (name[i] == ')') {
+                ++depth;
+            } else if (name[i] == '(' && --depth == 0) {
+                name.resize(i);
+                break;
+            }
+        }
+    }
+    if (offset) {
+        *offset = static_cast<std::size_t>(static_cast<const char*>(address) - static_cast<const char*>(info.dli_saddr));
+    }
+    return name;
+}
+
+std::string moduleOffset(const void* address) {
+    char buffer[32];
+    Dl_info info;
+    if (dladdr(address, &info) == 0 || info.dli_fname == nullptr) {
+        std::snprintf(buffer, sizeof(buffer), "%p", address);
+        return buffer;
+    }
+    const char* slash = std::strrchr(info.dli_fname, '/');
+    std::snprintf(buffer, sizeof(buffer), "+0x%zx",
+                  static_cast<std::size_t>(static_cast<const char*>(address) - static_cast<const char*>(info.dli_fbase)));
+    return std::string(slash ? slash + 1 : info.dli_fname) + buffer;
+}
@@ -0,0 +1,46 @@
+#include "value_codec.h"
+#include <iostream>
+#include <zlib.h>
+
+namespace {
+// DEFLATE through zlib's one-shot API; holds no state between calls.
+class ZlibCodec : public ValueCodec {
+public:
+    explicit ZlibCodec(int level) : level_(level < 0 ? Z_BEST_SPEED : level) {}
+
+    const char* name() const override { return "zlib"; }
+
+    bool compress(const std::string& in, std::string& out) const override {
+        uLongf length = compressBound(static_cast<uLong>(in.size()));
+        out.resize(length);
+        int rc = compress2(reinterpret_cast<Bytef*>(&out[0]), &length,
+                           reinterpret_cast<const Bytef*>(in.data()), static_cast<uLong>(in.size()), level_);
+        if (rc != Z_OK) {
+            return false;
+        }
+        out.resize(length);
+        return true;
+    }
+
+    bool decompress(const std::string& in, std::size_t raw_length, std::string& out) const override {
+        out.resize(raw_length);
+        uLongf length = static_cast<uLongf>(raw_length);
+        int rc = uncompress(reinterpret_cast<Bytef*>(&out[0]), &length,
+                            reinterpret_cast<const Bytef*>(in.data()), static_cast<uLong>(in.size()));
+        return rc == Z_OK && length == raw_length;
+    }
+
+private:
+    int level_;
+};
+} // namespace
+
+std::unique_ptr<ValueCodec> makeValueCodec(const std::string& name, int level) {
+    if (name == "zlib") {
+        return std::make_unique<ZlibCodec>(level);
+    }
+    if (!name.empty() && name != "none") {
+        std::cerr << "Warning: Unknown compression codec '" << name << "'." << std::endl;
+    }
+    return nullptr;
+}
@@ -0,0 +1,36 @@
+#include "value_table.h"
+
+// --- References ---
+std::shared_ptr<const std::string> ValueTable::acquire(std::shared_ptr<const std::string> value) {
+    auto it = values_.find(std::string_view(*value));
+    if (it == values_.end()) {
+        std::string_view key(*value);
+        unique_bytes_ += value->size();
+        it = values_.emplace(key, Entry{std::move(value), 0}).first;
+    }
+    it->second.refs++;
+    referenced_bytes_ += it->second.value->size();
+    return it->second.value;
+}
+
+std::shared_ptr<const std::string> ValueTable::acquire(std::string_view value) {
+    auto it = values_.find(value);
+    if (it == values_.end()) {
+        return acquire(std::make_shared<const std::string>(value));
+    }
+    it->second.refs++;
+    referenced_bytes_ += value.size();
+    return it->second.value;
+}
+
+void ValueTable::release(const std::string& value) {
+    auto it = values_.find(std::string_view(value));
+    if (it == values_.end()) {
+        return;
+    }
+    referenced_bytes_ -= value.size();
+    if (--it->second.refs == 0) {
+        unique_bytes_ -= value.size();
+        values_.erase(it); // Handles still held by readers keep the bytes alive
+    }
+}
@@ -0,0 +1,128 @@
+// tests/wal_replay_test.cpp
+// Writes keys and values holding the WAL's own separators (',', '\n') and
+// NUL bytes through a cache, replays the log into a fresh cache and checks
+// that every record comes back unchanged and that no value could inject a
+// record of its own. Also replays a log in the pre-length-prefix line format
+// and one whose last record was cut short by a crash.
+//
+// Usage: wal_replay_test [scratch_dir]
+#include "lru_cache.h"
+#include "segment_cache.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+static const std::vector<std::pair<std::string, std::string>>& hostileEntries() {
+    static const std::vector<std::pair<std::string, std::string>> entries = {
+        {"comma,key", "value,with,commas"},
+        {"newline\nkey", "line one\nline two\n"},
+        {std::string("nul\0key", 7), std::string("\0\0value\0", 8)},
+        {"injector", "x\nDEL2,6,0,0,victim\nPUT2,6,4,0,forgedevil"},
+        {"legacy-injector", "x\nDEL,victim\nPUT,forged,evil"},
+        {"victim", "must survive"},
+        {"empty", ""},
+    };
+    return entries;
+}
+
+static void checkReplayed(LRUCache& cache, const std::string& label) {
+    for (const auto& entry : hostileEntries()) {
+        std::optional<std::string> value = cache.get(entry.first);
+        check(value && *value == entry.second, label + ": value of a key with separator bytes");
+    }
+    check(!cache.get("forged"), label + ": a value injected a PUT record");
+    check(cache.get("expiring") && cache.get("removed,key") == std::nullopt, label + ": EXP and DEL records");
+}
+
+static void writeLog(const std::string& path) {
+    std::remove(path.c_str());
+    std::ofstream wal(path, std::ios::app);
+    LRUCache cache(100, /*ttl=*/0);
+    cache.setWalStream(&wal);
+    for (const auto& entry : hostileEntries()) {
+        cache.put(entry.first, entry.second);
+    }
+    cache.put("expiring", "soon", LRUCache::nowUnixMs() + 3600 * 1000);
+    std::vector<CacheOp> ops(1);
+    ops[0].type = CacheOp::Type::Expire;
+    ops[0].key = "expiring";
+    ops[0].expires_at_ms = LRUCache::nowUnixMs() + 7200 * 1000;
+    std::vector<CacheOp*> batch{&ops[0]};
+    cache.applyBatch(batch);
+    cache.put("removed,key", "gone\n");
+    cache.remove("removed,key");
+    cache.setWalStream(nullptr);
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+    std::string path = dir + "/wal_replay_test.wal";
+
+    writeLog(path);
+    {
+        LRUCache replayed(100, 0);
+        check(LRUCache::loadFromWAL(path, replayed), "replay into LRUCache");
+        checkReplayed(replayed, "LRUCache");
+    }
+    {
+        // The segment cache writes and reads the same records
+        std::unique_ptr<SegmentCache> segment =
+            SegmentCache::openFile(dir + "/wal_replay_test.seg", 4 * 1024 * 1024, 100, 0, nullptr);
+        check(segment && segment->loadFromWAL(path), "replay into SegmentCache");
+        if (segment) {
+            for (const auto& entry : hostileEntries()) {
+                std::optional<std::string> value = segment->get(entry.first);
+                check(value && *value == entry.second, "SegmentCache: value of a key with separator bytes");
+            }
+            check(!segment->get("forged"), "SegmentCache: a value injected a PUT record");
+        }
+        std::remove((dir + "/wal_replay_test.seg").c_str());
+    }
+
+    // A crash mid-append leaves a partial last record; the rest still loads
+    {
+        std::ofstream wal(path, std::ios::app);
+        wal << LRUCache::walPutRecord("torn", "0123456789", 0).substr(0, 20);
+    }
+    {
+        LRUCache replayed(100, 0);
+        check(LRUCache::loadFromWAL(path, replayed), "replay of a torn log");
+        checkReplayed(replayed, "torn log");
+        check(!replayed.get("torn"), "torn record applied");
+    }
+
+    // Logs written before the length-prefixed format
+    {
+        std::ofstream legacy(path, std::ios::trunc);
+        legacy << "PUT,old,value\n\nPUTX,deadline," << LRUCache::nowUnixMs() + 3600 * 1000
+               << ",v\nPUT,gone,v\nDEL,gone\n" << LRUCache::walPutRecord("mixed", "a,b\nc", 0) << "\n";
+    }
+    {
+        LRUCache replayed(100, 0);
+        check(LRUCache::loadFromWAL(path, replayed), "replay of a legacy log");
+        check(replayed.get("old") == std::optional<std::string>("value"), "legacy PUT");
+        check(replayed.get("deadline") == std::optional<std::string>("v"), "legacy PUTX");
+        check(!replayed.get("gone"), "legacy DEL");
+        check(replayed.get("mixed") == std::optional<std::string>("a,b\nc"), "new record after legacy lines");
+    }
+    std::remove(path.c_str());
+
+    if (failures != 0) {
+        std::cerr << failures << " check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "WAL replay test passed." << std::endl;
+    return 0;
+}